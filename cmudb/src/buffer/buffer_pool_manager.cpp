@@ -1,38 +1,358 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+
 #include "buffer/buffer_pool_manager.h"
 
 namespace cmudb {
 
+    static inline uint64_t ElapsedNs(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+    }
+
 /*
  * BufferPoolManager Constructor
  * When log_manager is nullptr, logging is disabled (for test purpose)
- * WARNING: Do Not Edit This Function
+ * num_instances: number of shards, frames are split evenly between them
+ * replacer_type: replacement policy of every shard
  */
     BufferPoolManager::BufferPoolManager(size_t pool_size,
                                          DiskManager *disk_manager,
-                                         LogManager *log_manager)
+                                         LogManager *log_manager,
+                                         size_t num_instances,
+                                         ReplacerType replacer_type)
             : pool_size_(pool_size), disk_manager_(disk_manager),
-              log_manager_(log_manager) {
-        // a consecutive memory space for buffer pool
+              log_manager_(log_manager), num_instances_(num_instances),
+              replacer_type_(replacer_type) {
+        assert(num_instances_ > 0 && num_instances_ <= pool_size_);
+        // a consecutive memory space for buffer pool, pages are sized by the
+        // disk manager and aligned for direct I/O
+        page_size_ = disk_manager_->GetPageSize();
+        page_data_ = DiskManager::AllocateAligned(pool_size_ * page_size_);
         pages_ = new Page[pool_size_];
-        page_table_ = new ExtendibleHash<page_id_t, Page *>(BUCKET_SIZE);
-        replacer_ = new LRUReplacer<Page *>;
-        free_list_ = new std::list<Page *>;
-
-        // put all the pages into free list
         for (size_t i = 0; i < pool_size_; ++i) {
-            free_list_->push_back(&pages_[i]);
+            pages_[i].data_ = page_data_ + i * page_size_;
+            pages_[i].page_size_ = page_size_;
+        }
+        shards_ = new Shard[num_instances_];
+
+        Page *next = pages_;
+        for (size_t i = 0; i < num_instances_; ++i) {
+            Shard &shard = shards_[i];
+            shard.pages_ = next;
+            shard.size_ = pool_size_ / num_instances_ +
+                          (i < pool_size_ % num_instances_ ? 1 : 0);
+            shard.page_table_ = new PageTable(shard.pages_, shard.size_);
+            shard.replacer_ = MakeReplacer(shard);
+            shard.free_list_ = new std::list<Page *>;
+
+            // put all the pages of this shard into its free list
+            for (size_t j = 0; j < shard.size_; ++j) {
+                shard.pages_[j].pin_count_ = -1;
+                shard.free_list_->push_back(&shard.pages_[j]);
+            }
+            next += shard.size_;
         }
     }
 
 /*
  * BufferPoolManager Deconstructor
- * WARNING: Do Not Edit This Function
  */
     BufferPoolManager::~BufferPoolManager() {
+        StopPageCleaner();
+        // waits for the prefetches and the warm-up in flight, the disk manager
+        // must outlive the pool
+        delete io_workers_;
+        for (size_t i = 0; i < num_instances_; ++i) {
+            delete shards_[i].page_table_;
+            delete shards_[i].replacer_;
+            delete shards_[i].free_list_;
+        }
+        delete[] shards_;
         delete[] pages_;
-        delete page_table_;
-        delete replacer_;
-        delete free_list_;
+        DiskManager::FreeAligned(page_data_);
+    }
+
+/*
+ * Build the replacer of one shard. Replacers are sized to the shard and index
+ * frames relative to its first page.
+ */
+    Replacer<Page *> *BufferPoolManager::MakeReplacer(const Shard &shard) const {
+        switch (replacer_type_) {
+            case ReplacerType::CLOCK:
+                return new ClockReplacer<Page *>(shard.size_, shard.pages_);
+            case ReplacerType::LRU_K:
+                return new LRUKReplacer<Page *>(shard.size_, shard.pages_,
+                                                LRU_K_REFERENCES,
+                                                LRU_K_CORRELATED_PERIOD);
+            case ReplacerType::LRU:
+            default:
+                return new LRUReplacer<Page *>(shard.size_, shard.pages_);
+        }
+    }
+
+/*
+ * Find a frame to hold a new page inside the given shard, always from the
+ * free list first, then from the replacer. Frames that were pinned after
+ * they entered the replacer are dropped from it, their last unpin puts them
+ * back. The chosen frame is claimed by moving its pin count from 0 to -1,
+ * if it is dirty it is written back and its old entry is removed from the
+ * page table. The replacer is told to forget the frame, so a history based
+ * policy does not carry the old page's references over to the new one.
+ * Caller must hold shard.latch_
+ * @return: nullptr if every frame of the shard is pinned
+ */
+    Page *BufferPoolManager::GetVictimPage(Shard &shard) {
+        Page *page = nullptr;
+        if (shard.free_list_->empty()) {
+            while (shard.replacer_->Victim(page)) {
+                int unpinned = 0;
+                if (page->pin_count_.compare_exchange_strong(unpinned, -1)) break;
+                page = nullptr;
+            }
+        } else {
+            page = shard.free_list_->front();
+            shard.free_list_->pop_front();
+        }
+        if (!page) return nullptr;
+        shard.replacer_->Erase(page);
+        page->buffer_ring_ = nullptr;
+        EvictPage(shard, page);
+        return page;
+    }
+
+/*
+ * Detach a claimed frame from the page it holds: wait for a page cleaner
+ * write of the frame to finish, write the page back if it is still dirty
+ * and remove it from the page table. A dirty page is written together with
+ * the dirty unpinned pages right after and before it, up to
+ * EVICTION_WRITE_RUN pages, which leaves those clean for later evictions.
+ * Caller must hold shard.latch_
+ */
+    void BufferPoolManager::EvictPage(Shard &shard, Page *page) {
+        page_id_t page_id = page->GetPageId();
+        if (page_id == INVALID_PAGE_ID) return;
+        stats_.Add(BufferPoolCounter::EVICTION);
+        // nobody else latches a frame that is not pinned
+        page->WLatch();
+        page->WUnlatch();
+        if (page->is_dirty_) {
+            // the victim sits in the middle, neighbours grow the run both ways
+            Page *run[2 * EVICTION_WRITE_RUN - 1];
+            size_t victim = EVICTION_WRITE_RUN - 1;
+            size_t first = victim, end = victim + 1;
+            run[victim] = page;
+            while (end - first < EVICTION_WRITE_RUN) {
+                Page *next = TryLatchDirtyPage(page_id + static_cast<page_id_t>(end - victim));
+                if (!next) break;
+                run[end++] = next;
+            }
+            while (end - first < EVICTION_WRITE_RUN &&
+                   page_id > static_cast<page_id_t>(victim - first)) {
+                Page *prev = TryLatchDirtyPage(page_id - static_cast<page_id_t>(victim - first + 1));
+                if (!prev) break;
+                run[--first] = prev;
+            }
+            WriteRun(run + first, end - first);
+            for (size_t i = first; i < end; ++i) {
+                if (i != victim) run[i]->RUnlatch();
+            }
+            stats_.Add(BufferPoolCounter::FOREGROUND_WRITE, end - first);
+        }
+        // 移除的 是 page原来的id
+        shard.page_table_->Remove(page_id);
+    }
+
+/*
+ * Read latch the frame of a resident, dirty and unpinned page, to write it
+ * without pinning it like the page cleaner does. Never waits for the latch.
+ * @return: nullptr if the page is not such a page or its latch is taken
+ */
+    Page *BufferPoolManager::TryLatchDirtyPage(page_id_t page_id) {
+        Page *page = nullptr;
+        if (!GetShard(page_id).page_table_->Find(page_id, page)) return nullptr;
+        if (page->pin_count_ != 0 || !page->is_dirty_ || !page->TryRLatch()) return nullptr;
+        // the frame may have been claimed for another page in between
+        if (page->pin_count_ >= 0 && page->page_id_ == page_id && page->is_dirty_) return page;
+        page->RUnlatch();
+        return nullptr;
+    }
+
+/*
+ * Write pages with consecutive ids in one vectored write. The frames are
+ * latched or claimed by the caller; they are marked clean before the write,
+ * a writer that modifies them from now on dirties them again. If the write
+ * fails they are dirty again, otherwise they have no recovery lsn any more.
+ */
+    bool BufferPoolManager::WriteRun(Page *const *pages, size_t num_pages) {
+        std::vector<const char *> data(num_pages);
+        lsn_t lsn = INVALID_LSN;
+        for (size_t i = 0; i < num_pages; ++i) {
+            pages[i]->is_dirty_ = false;
+            data[i] = pages[i]->data_;
+            lsn = std::max(lsn, pages[i]->GetLSN());
+        }
+        FlushLog(lsn);
+        bool written = disk_manager_->WritePages(pages[0]->GetPageId(), num_pages, data.data());
+        for (size_t i = 0; i < num_pages; ++i) {
+            if (written) {
+                pages[i]->rec_lsn_ = INVALID_LSN;
+            } else {
+                pages[i]->is_dirty_ = true;
+            }
+        }
+        stats_.Add(BufferPoolCounter::WRITE_RUN);
+        return written;
+    }
+
+/*
+ * Write ahead rule: the log records of a page reach the disk before the
+ * page does. Forces the log up to lsn if it is not there yet.
+ */
+    void BufferPoolManager::FlushLog(lsn_t lsn) {
+        if (ENABLE_LOGGING && log_manager_ != nullptr &&
+            lsn > log_manager_->GetPersistentLSN()) {
+            log_manager_->Flush(lsn);
+        }
+    }
+
+/*
+ * Shard whose slice of the pool contains the frame
+ */
+    BufferPoolManager::Shard &BufferPoolManager::GetFrameShard(const Page *page) {
+        for (size_t i = 0; i + 1 < num_instances_; ++i) {
+            if (OwnsFrame(shards_[i], page)) return shards_[i];
+        }
+        return shards_[num_instances_ - 1];
+    }
+
+/*
+ * Find a frame for a page read through a buffer ring. Once the ring holds
+ * its share of the shard, its oldest unpinned frame there is recycled;
+ * until then, or if all of them are pinned, a frame is taken the usual way
+ * and adopted by the ring, which may push the ring's oldest frame back to
+ * the replacer. A ring never takes more than half of a shard.
+ * Caller must hold shard.latch_
+ * @return: nullptr if every frame of the shard is pinned
+ */
+    Page *BufferPoolManager::GetRingVictimPage(Shard &shard, BufferRing &buffer_ring) {
+        size_t share = std::min(std::max<size_t>(1, buffer_ring.size_ / num_instances_),
+                                shard.size_ / 2);
+        if (share == 0) return GetVictimPage(shard);
+
+        std::lock_guard<std::mutex> guard(buffer_ring.latch_);
+        auto &frames = buffer_ring.frames_;
+        size_t owned = 0;
+        for (Page *frame : frames) {
+            if (frame->buffer_ring_ == &buffer_ring && OwnsFrame(shard, frame)) ++owned;
+        }
+        if (owned >= share) {
+            for (auto it = frames.begin(); it != frames.end(); ++it) {
+                Page *page = *it;
+                if (page->buffer_ring_ != &buffer_ring || !OwnsFrame(shard, page)) continue;
+                int unpinned = 0;
+                if (!page->pin_count_.compare_exchange_strong(unpinned, -1)) continue;
+                // most recently loaded now
+                frames.erase(it);
+                frames.push_back(page);
+                EvictPage(shard, page);
+                return page;
+            }
+        }
+
+        Page *page = GetVictimPage(shard);
+        if (!page) return nullptr;
+        frames.erase(std::remove_if(frames.begin(), frames.end(),
+                                    [&buffer_ring](Page *frame) {
+                                        return frame->buffer_ring_ != &buffer_ring;
+                                    }),
+                     frames.end());
+        if (frames.size() >= buffer_ring.size_) {
+            ReleaseRingFrame(buffer_ring, frames.front());
+            frames.erase(frames.begin());
+        }
+        page->buffer_ring_ = &buffer_ring;
+        frames.push_back(page);
+        return page;
+    }
+
+/*
+ * Hand a frame of the ring back to the replacer of its shard. Ring frames
+ * are never in a replacer or free list, so nobody else can change their
+ * owner and no latch is needed.
+ */
+    void BufferPoolManager::ReleaseRingFrame(BufferRing &buffer_ring, Page *page) {
+        BufferRing *owner = &buffer_ring;
+        if (page->buffer_ring_.compare_exchange_strong(owner, nullptr)) {
+            GetFrameShard(page).replacer_->Insert(page);
+        }
+    }
+
+/*
+ * Called when a ring is destroyed
+ */
+    void BufferPoolManager::ReleaseBufferRing(BufferRing &buffer_ring) {
+        std::lock_guard<std::mutex> guard(buffer_ring.latch_);
+        for (Page *page : buffer_ring.frames_) {
+            ReleaseRingFrame(buffer_ring, page);
+        }
+        buffer_ring.frames_.clear();
+    }
+
+/*
+ * Latch free pin of a resident page. The frame found in the page table is
+ * only trusted once it is pinned and still holds page_id.
+ * @return: nullptr if the page has to be looked up under the shard latch
+ */
+    Page *BufferPoolManager::TryPin(Shard &shard, page_id_t page_id) {
+        Page *page = nullptr;
+        if (!shard.page_table_->Find(page_id, page)) return nullptr;
+        int pin_count = page->pin_count_;
+        while (pin_count >= 0) {
+            if (page->pin_count_.compare_exchange_weak(pin_count, pin_count + 1)) break;
+        }
+        if (pin_count < 0) return nullptr;
+        if (page->page_id_ != page_id) {
+            // the frame was replaced under our feet
+            Unpin(shard, page);
+            return nullptr;
+        }
+        return page;
+    }
+
+/*
+ * Drop one pin of the frame, the last pin puts it back to the replacer
+ * unless the frame belongs to a buffer ring
+ * @return: false if the frame was not pinned
+ */
+    bool BufferPoolManager::Unpin(Shard &shard, Page *page) {
+        int pin_count = page->pin_count_;
+        while (pin_count > 0) {
+            if (page->pin_count_.compare_exchange_weak(pin_count, pin_count - 1)) break;
+        }
+        if (pin_count <= 0) return false;
+        if (pin_count == 1 && page->buffer_ring_ == nullptr) shard.replacer_->Insert(page);
+        return true;
+    }
+
+/*
+ * Look page_id up in the page table of its shard. A frame that is in the
+ * page table but claimed (pin count -1) is being read by a prefetch, which
+ * is waited for; outside of that, frames in the page table are never
+ * claimed outside the latch.
+ * Caller holds shard.latch_ through lock
+ * @return: the frame of the page, nullptr if the page is not resident
+ */
+    Page *BufferPoolManager::FindLoaded(Shard &shard, page_id_t page_id,
+                                        std::unique_lock<std::mutex> &lock) {
+        Page *page = nullptr;
+        while (shard.page_table_->Find(page_id, page) && page->pin_count_ < 0) {
+            shard.loaded_cv_.wait(lock);
+            page = nullptr;
+        }
+        return page;
     }
 
 /**
@@ -45,34 +365,41 @@ namespace cmudb {
  * entry for the new page.
  * 4. Update page metadata, read page content from disk file and return page
  * pointer
+ * Step 1.1 runs without any latch, everything else under the latch of the
+ * shard the page id hashes to. A page that is being prefetched is waited
+ * for instead of being read a second time.
+ * With a buffer_ring, step 1.2 recycles the frames of the ring instead.
  */
-    Page *BufferPoolManager::FetchPage(page_id_t page_id) {
-        std::lock_guard<std::mutex> guard(latch_);
-        Page *page = nullptr;
-        if (page_table_->Find(page_id, page)) {
-            ++page->pin_count_;
-            replacer_->Erase(page);
+    Page *BufferPoolManager::FetchPage(page_id_t page_id, BufferRing *buffer_ring) {
+        auto start = std::chrono::steady_clock::now();
+        Shard &shard = GetShard(page_id);
+        Page *page = TryPin(shard, page_id);
+        if (page) {
+            RecordHit(page, start);
             return page;
         }
-        if (free_list_->empty()) {
-            if (!replacer_->Size()) return nullptr;
-            replacer_->Victim(page);
-        } else {
-            page = free_list_->front();
-            free_list_->pop_front();
+
+        std::unique_lock<std::mutex> lock = LockShard(shard);
+        page = FindLoaded(shard, page_id, lock);
+        if (page) {
+            ++page->pin_count_;
+            RecordHit(page, start);
+            return page;
         }
+        page = buffer_ring ? GetRingVictimPage(shard, *buffer_ring)
+                           : GetVictimPage(shard);
         if (!page) return nullptr;
-        if (page->is_dirty_) disk_manager_->WritePage(page->GetPageId(), page->data_);
 
-        // HashTable remove
-        // 移除的 是 page原来的id
-        page_table_->Remove(page->GetPageId());
-        page_table_->Insert(page_id, page);
         // Update Metadata
+        page->page_id_ = page_id;
+        page->is_dirty_ = false;
+        page->rec_lsn_ = INVALID_LSN;
+        page->access_count_ = 1;
         disk_manager_->ReadPage(page_id, page->data_);
         page->pin_count_ = 1;
-        page->is_dirty_ = false;
-        page->page_id_ = page_id;
+        shard.page_table_->Insert(page_id, page);
+        stats_.Add(BufferPoolCounter::FETCH_MISS);
+        stats_.RecordLatency(BufferPoolLatency::FETCH_MISS, ElapsedNs(start));
         return page;
     }
 
@@ -81,18 +408,21 @@ namespace cmudb {
  * if pin_count>0, decrement it and if it becomes zero, put it back to
  * replacer if pin_count<=0 before this call, return false. is_dirty: set the
  * dirty flag of this page
+ * The caller holds a pin, so the frame cannot be replaced and no latch is
+ * needed.
  */
     bool BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty) {
-        std::lock_guard<std::mutex> guard(latch_);
+        Shard &shard = GetShard(page_id);
         Page *page = nullptr;
-        if (!page_table_->Find(page_id, page)) return false;
-
-        page->is_dirty_ |= is_dirty;
+        if (!shard.page_table_->Find(page_id, page)) {
+            std::lock_guard<std::mutex> guard(shard.latch_);
+            if (!shard.page_table_->Find(page_id, page)) return false;
+        }
 
-        if (page->pin_count_ <= 0) return false;
+        // mark dirty before the pin is dropped, so an eviction sees it
+        if (is_dirty) page->is_dirty_ = true;
 
-        if (!--page->pin_count_) replacer_->Insert(page);
-        return true;
+        return Unpin(shard, page);
     }
 
 /*
@@ -102,15 +432,108 @@ namespace cmudb {
  * NOTE: make sure page_id != INVALID_PAGE_ID
  */
     bool BufferPoolManager::FlushPage(page_id_t page_id) {
-        std::lock_guard<std::mutex> guard(latch_);
+        if (page_id == INVALID_PAGE_ID) return false;
+        Shard &shard = GetShard(page_id);
         Page *page = nullptr;
-        page_table_->Find(page_id, page);
-        if (!page || page->page_id_ == INVALID_PAGE_ID) return false;
-        if (page->is_dirty_) disk_manager_->WritePage(page_id, page->data_);
-        page->is_dirty_ = false;
+        {
+            std::lock_guard<std::mutex> guard(shard.latch_);
+            shard.page_table_->Find(page_id, page);
+            if (!page || page->pin_count_ < 0 || page->page_id_ != page_id) return false;
+            ++page->pin_count_;
+        }
+        // the page is written as of a change, not in the middle of one
+        page->RLatch();
+        if (page->is_dirty_) {
+            page->is_dirty_ = false;
+            FlushLog(page->GetLSN());
+            disk_manager_->WritePage(page_id, page->data_);
+            page->rec_lsn_ = INVALID_LSN;
+            stats_.Add(BufferPoolCounter::FLUSH_WRITE);
+        }
+        page->RUnlatch();
+        Unpin(shard, page);
         return true;
     }
 
+/*
+ * Write back every dirty page of the pool, or only those changed first
+ * before rec_lsn if one is given. The dirty frames are pinned under
+ * the latch of their shard, so that they stay resident, and sorted by page
+ * id. Runs of consecutive page ids are then written with one vectored write
+ * each, under the read latch of every page of the run. A run ends where the
+ * next page's latch is taken, that page starts the next run once it could
+ * be latched.
+ * @return: number of pages written
+ */
+    size_t BufferPoolManager::FlushAllPages(lsn_t rec_lsn) {
+        std::vector<Page *> dirty;
+        for (size_t i = 0; i < num_instances_; ++i) {
+            Shard &shard = shards_[i];
+            std::lock_guard<std::mutex> guard(shard.latch_);
+            for (size_t j = 0; j < shard.size_; ++j) {
+                Page *page = &shard.pages_[j];
+                if (page->pin_count_ < 0 || page->page_id_ == INVALID_PAGE_ID ||
+                    !page->is_dirty_) continue;
+                if (rec_lsn != INVALID_LSN &&
+                    (page->rec_lsn_ == INVALID_LSN || page->rec_lsn_ >= rec_lsn)) continue;
+                // frames in the page table are never claimed outside the latch
+                ++page->pin_count_;
+                dirty.push_back(page);
+            }
+        }
+        std::sort(dirty.begin(), dirty.end(), [](const Page *a, const Page *b) {
+            return a->page_id_ < b->page_id_;
+        });
+
+        size_t num_written = 0;
+        size_t first = 0;
+        while (first < dirty.size()) {
+            dirty[first]->RLatch();
+            size_t end = first + 1;
+            while (end < dirty.size() &&
+                   dirty[end]->page_id_ == dirty[end - 1]->page_id_ + 1 &&
+                   dirty[end]->TryRLatch()) {
+                ++end;
+            }
+            if (WriteRun(dirty.data() + first, end - first)) num_written += end - first;
+            for (size_t i = first; i < end; ++i) {
+                Page *page = dirty[i];
+                page->RUnlatch();
+                Unpin(GetShard(page->page_id_), page);
+            }
+            first = end;
+        }
+        stats_.Add(BufferPoolCounter::FLUSH_WRITE, num_written);
+        return num_written;
+    }
+
+/*
+ * The dirty page table of a fuzzy checkpoint: every page with changes that
+ * are not on disk and the lsn of the oldest one. The resident pages are
+ * pinned and read latched one at a time, so a change that is being made
+ * shows up once it is done.
+ */
+    void BufferPoolManager::GetDirtyPageTable(
+            std::vector<std::pair<page_id_t, lsn_t>> &dirty_pages) {
+        dirty_pages.clear();
+        for (size_t i = 0; i < num_instances_; ++i) {
+            Shard &shard = shards_[i];
+            for (size_t j = 0; j < shard.size_; ++j) {
+                Page *page = &shard.pages_[j];
+                {
+                    std::lock_guard<std::mutex> guard(shard.latch_);
+                    if (page->pin_count_ < 0 || page->page_id_ == INVALID_PAGE_ID) continue;
+                    ++page->pin_count_;
+                }
+                page->RLatch();
+                lsn_t rec_lsn = page->rec_lsn_;
+                page->RUnlatch();
+                if (rec_lsn != INVALID_LSN) dirty_pages.emplace_back(page->page_id_, rec_lsn);
+                Unpin(shard, page);
+            }
+        }
+    }
+
 /**
  * User should call this method for deleting a page. This routine will call
  * disk manager to deallocate the page. First, if page is found within page
@@ -120,17 +543,20 @@ namespace cmudb {
  * the page is found within page table, but pin_count != 0, return false
  */
     bool BufferPoolManager::DeletePage(page_id_t page_id) {
-        std::lock_guard<std::mutex> guard(latch_);
-        Page *page = nullptr;
-        page_table_->Find(page_id, page);
+        Shard &shard = GetShard(page_id);
+        std::unique_lock<std::mutex> lock(shard.latch_);
+        Page *page = FindLoaded(shard, page_id, lock);
         if (page) {
-            if (page->pin_count_ > 0) return false;
-            replacer_->Erase(page);
-            page_table_->Remove(page_id);
+            int unpinned = 0;
+            if (!page->pin_count_.compare_exchange_strong(unpinned, -1)) return false;
+            shard.replacer_->Erase(page);
+            shard.page_table_->Remove(page_id);
+            page->buffer_ring_ = nullptr;
             page->is_dirty_ = false;
+            page->rec_lsn_ = INVALID_LSN;
             page->ResetMemory();
             page->page_id_ = INVALID_PAGE_ID;
-            free_list_->push_back(page);
+            shard.free_list_->push_back(page);
         }
         disk_manager_->DeallocatePage(page_id);
         return true;
@@ -143,27 +569,500 @@ namespace cmudb {
  * from free list or lru replacer(NOTE: always choose from free list first),
  * update new page's metadata, zero out memory and add corresponding entry
  * into page table. return nullptr if all the pages in pool are pinned
+ * The shard is only known once the page id is allocated. If that shard has
+ * no frame left, another id is allocated, until one lands in a shard with a
+ * frame or every shard turned out to be full; the ids that did not get a
+ * frame are handed back to the disk manager afterwards, so that it does not
+ * hand the same id out again meanwhile.
+ * hint: a page the new one is related to, the disk manager places the new
+ * page close to it if it can
  */
-    Page *BufferPoolManager::NewPage(page_id_t &page_id) {
-        std::lock_guard<std::mutex> guard(latch_);
+    Page *BufferPoolManager::NewPage(page_id_t &page_id, page_id_t hint) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<page_id_t> rejected;
+        std::vector<bool> is_full(num_instances_, false);
+        size_t num_full = 0;
         Page *page = nullptr;
-        if (free_list_->empty()) {
-            if (!replacer_->Size()) return nullptr;
-            replacer_->Victim(page);
-        } else {
-            page = free_list_->front();
-            free_list_->pop_front();
+        // consecutive ids cover every shard, the bound only matters when the
+        // free pages all hash to full shards
+        while (num_full < num_instances_ && rejected.size() < 2 * num_instances_) {
+            page_id_t new_page_id = disk_manager_->AllocatePage(hint);
+            if (new_page_id == INVALID_PAGE_ID) break;
+            size_t shard_index = static_cast<size_t>(new_page_id) % num_instances_;
+            if (!is_full[shard_index]) {
+                Shard &shard = shards_[shard_index];
+                std::unique_lock<std::mutex> lock = LockShard(shard);
+                page = GetVictimPage(shard);
+                if (page) {
+                    page_id = new_page_id;
+                    page->page_id_ = page_id;
+                    page->ResetMemory();
+                    page->is_dirty_ = false;
+                    page->rec_lsn_ = INVALID_LSN;
+                    page->access_count_ = 1;
+                    page->pin_count_ = 1;
+                    shard.page_table_->Insert(page_id, page);
+                    break;
+                }
+                is_full[shard_index] = true;
+                ++num_full;
+            }
+            rejected.push_back(new_page_id);
+        }
+        for (page_id_t rejected_page_id : rejected) {
+            disk_manager_->DeallocatePage(rejected_page_id);
         }
         if (!page) return nullptr;
-        page_id = disk_manager_->AllocatePage();
-        if (page->is_dirty_) disk_manager_->WritePage(page->GetPageId(), page->data_);
-        page_table_->Remove(page->GetPageId());
-        page_table_->Insert(page_id, page);
+        stats_.Add(BufferPoolCounter::NEW_PAGE);
+        stats_.RecordLatency(BufferPoolLatency::NEW_PAGE, ElapsedNs(start));
+        return page;
+    }
+
+/*
+ * Take the latch of a shard, counting the time spent waiting for it
+ */
+    std::unique_lock<std::mutex> BufferPoolManager::LockShard(Shard &shard) {
+        std::unique_lock<std::mutex> lock(shard.latch_, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            auto start = std::chrono::steady_clock::now();
+            lock.lock();
+            stats_.Add(BufferPoolCounter::LATCH_WAIT_NS, ElapsedNs(start));
+        }
+        return lock;
+    }
+
+    void BufferPoolManager::RecordHit(Page *page,
+                                      std::chrono::steady_clock::time_point start) {
+        page->access_count_.fetch_add(1, std::memory_order_relaxed);
+        stats_.Add(BufferPoolCounter::FETCH_HIT);
+        stats_.RecordLatency(BufferPoolLatency::FETCH_HIT, ElapsedNs(start));
+    }
+
+/*
+ * Copy the bookkeeping of every frame, without any latch: a frame that is
+ * being replaced may show a mix of its old and new state
+ */
+    void BufferPoolManager::GetFrameStats(std::vector<FrameStats> &frames) const {
+        frames.resize(pool_size_);
+        for (size_t i = 0; i < pool_size_; ++i) {
+            const Page &page = pages_[i];
+            frames[i].page_id_ = page.page_id_;
+            frames[i].pin_count_ = std::max(0, page.pin_count_.load());
+            frames[i].is_dirty_ = page.is_dirty_;
+            frames[i].access_count_ = page.access_count_;
+        }
+    }
+
+/*
+ * Start the page cleaner thread. Every interval it walks the shards, looks at
+ * the frames the replacer of each shard would victimize next and writes the
+ * dirty ones back, at most max_writes pages per round.
+ */
+    void BufferPoolManager::RunPageCleaner(size_t clean_target, size_t max_writes,
+                                           std::chrono::milliseconds interval) {
+        std::lock_guard<std::mutex> guard(cleaner_latch_);
+        if (cleaner_running_) return;
+        cleaner_running_ = true;
+        // spread the target over the shards
+        size_t shard_target = (clean_target + num_instances_ - 1) / num_instances_;
+        cleaner_candidates_.resize(shard_target);
+        cleaner_page_ids_.resize(shard_target);
+        page_cleaner_ = new std::thread([this, shard_target, max_writes, interval] {
+            size_t next_shard = 0;
+            std::unique_lock<std::mutex> lock(cleaner_latch_);
+            while (cleaner_running_) {
+                lock.unlock();
+                // start from another shard every round, so that a small budget
+                // is not always spent on the same one
+                size_t budget = max_writes;
+                for (size_t i = 0; i < num_instances_ && budget > 0; ++i) {
+                    Shard &shard = shards_[(next_shard + i) % num_instances_];
+                    budget -= CleanShard(shard, shard_target, budget);
+                }
+                next_shard = (next_shard + 1) % num_instances_;
+                lock.lock();
+                cleaner_cv_.wait_for(lock, interval, [this] { return !cleaner_running_; });
+            }
+        });
+    }
+
+/*
+ * Stop and join the page cleaner thread
+ */
+    void BufferPoolManager::StopPageCleaner() {
+        {
+            std::lock_guard<std::mutex> guard(cleaner_latch_);
+            if (!cleaner_running_) return;
+            cleaner_running_ = false;
+        }
+        cleaner_cv_.notify_all();
+        page_cleaner_->join();
+        delete page_cleaner_;
+        page_cleaner_ = nullptr;
+    }
+
+/*
+ * Write back the dirty unpinned frames among the next clean_target victims
+ * of the shard. Free frames count as clean. The candidates are picked under
+ * the shard latch and written without it, as one batch of asynchronous
+ * writes. Every page stays read latched until its write completes, so that
+ * an eviction waits for it; a page whose latch is taken is skipped rather
+ * than waited for while holding the others, and so is a frame that has
+ * been reused for another page in between.
+ * @return: number of pages written
+ */
+    size_t BufferPoolManager::CleanShard(Shard &shard, size_t clean_target,
+                                         size_t max_writes) {
+        Page **candidates = cleaner_candidates_.data();
+        page_id_t *page_ids = cleaner_page_ids_.data();
+        size_t num_dirty = 0;
+        {
+            std::lock_guard<std::mutex> guard(shard.latch_);
+            size_t num_free = shard.free_list_->size();
+            if (num_free >= clean_target) return 0;
+            size_t num_candidates =
+                    shard.replacer_->PeekVictims(candidates, clean_target - num_free);
+            for (size_t i = 0; i < num_candidates; ++i) {
+                Page *page = candidates[i];
+                if (page->pin_count_ != 0 || !page->is_dirty_) continue;
+                candidates[num_dirty] = page;
+                page_ids[num_dirty] = page->GetPageId();
+                if (++num_dirty == max_writes) break;
+            }
+        }
+
+        size_t num_written = 0;
+        lsn_t lsn = INVALID_LSN;
+        for (size_t i = 0; i < num_dirty; ++i) {
+            Page *page = candidates[i];
+            if (!page->TryRLatch()) continue;
+            if (page->GetPageId() == page_ids[i] && page->is_dirty_) {
+                // a writer that modifies the page from now on dirties it again
+                page->is_dirty_ = false;
+                lsn = std::max(lsn, page->GetLSN());
+                page_ids[num_written] = page_ids[i];
+                candidates[num_written++] = page;
+            } else {
+                page->RUnlatch();
+            }
+        }
+        FlushLog(lsn);
+        std::vector<std::future<bool>> &writes = cleaner_writes_;
+        writes.clear();
+        for (size_t i = 0; i < num_written; ++i) {
+            writes.push_back(disk_manager_->WritePageAsync(page_ids[i], candidates[i]->data_, false));
+        }
+        disk_manager_->SubmitAsyncIO();
+        for (size_t i = 0; i < num_written; ++i) {
+            if (writes[i].get()) {
+                candidates[i]->rec_lsn_ = INVALID_LSN;
+            } else {
+                candidates[i]->is_dirty_ = true;
+            }
+            candidates[i]->RUnlatch();
+        }
+        stats_.Add(BufferPoolCounter::CLEANER_WRITE, num_written);
+        return num_written;
+    }
 
+    ThreadPool &BufferPoolManager::GetIOWorkers() {
+        std::call_once(io_workers_started_,
+                       [this] { io_workers_ = new ThreadPool(PREFETCH_WORKERS); });
+        return *io_workers_;
+    }
+
+/*
+ * Schedule an asynchronous read of page_id
+ */
+    void BufferPoolManager::Prefetch(page_id_t page_id) {
+        if (page_id == INVALID_PAGE_ID) return;
+        GetIOWorkers().Submit([this, page_id] { PrefetchPage(page_id, nullptr, nullptr); });
+    }
+
+/*
+ * Schedule asynchronous reads of page_ids. A single worker claims a frame for
+ * every page and submits the reads as one batch, so they are all in flight
+ * at once.
+ */
+    void BufferPoolManager::PrefetchBatch(const std::vector<page_id_t> &page_ids) {
+        if (page_ids.empty()) return;
+        GetIOWorkers().Submit([this, page_ids] {
+            std::vector<std::pair<page_id_t, Page *>> frames;
+            std::vector<std::future<bool>> reads;
+            for (page_id_t page_id : page_ids) {
+                if (page_id == INVALID_PAGE_ID) continue;
+                Shard &shard = GetShard(page_id);
+                Page *page;
+                {
+                    std::lock_guard<std::mutex> guard(shard.latch_);
+                    page = ClaimPrefetchFrame(shard, page_id, nullptr);
+                }
+                if (!page) continue;
+                frames.emplace_back(page_id, page);
+                reads.push_back(disk_manager_->ReadPageAsync(page_id, page->data_, false));
+            }
+            disk_manager_->SubmitAsyncIO();
+            for (size_t i = 0; i < frames.size(); ++i) {
+                InstallPrefetchedPage(GetShard(frames[i].first), frames[i].first,
+                                      frames[i].second, reads[i].get());
+            }
+        });
+    }
+
+/*
+ * Schedule an asynchronous read of count pages, starting at page_id and
+ * following next_page from one page to the next. The pages are read one
+ * after the other by a single worker, since every read tells the next id.
+ * With a buffer_ring, the pages are read into the frames of the ring.
+ */
+    void BufferPoolManager::PrefetchChain(page_id_t page_id, size_t count,
+                                          NextPageFn next_page,
+                                          std::shared_ptr<BufferRing> buffer_ring) {
+        if (page_id == INVALID_PAGE_ID || count == 0) return;
+        GetIOWorkers().Submit([this, page_id, count, next_page, buffer_ring] {
+            page_id_t cur = page_id;
+            for (size_t i = 0; i < count && cur != INVALID_PAGE_ID; ++i) {
+                cur = PrefetchPage(cur, buffer_ring.get(), i + 1 < count ? next_page : nullptr);
+            }
+        });
+    }
+
+/*
+ * Make page_id resident without leaving it pinned. A frame is claimed and
+ * entered into the page table under the shard latch, filled without it and
+ * published under it again, see ClaimPrefetchFrame.
+ * @return: the id next_page reads from the page, INVALID_PAGE_ID without
+ * next_page or if no frame was available
+ */
+    page_id_t BufferPoolManager::PrefetchPage(page_id_t page_id, BufferRing *buffer_ring,
+                                              NextPageFn next_page) {
+        Shard &shard = GetShard(page_id);
+        Page *page = TryPin(shard, page_id);
+        if (!page) {
+            std::unique_lock<std::mutex> lock(shard.latch_);
+            page = FindLoaded(shard, page_id, lock);
+            if (page) {
+                ++page->pin_count_;
+            } else {
+                page = ClaimPrefetchFrame(shard, page_id, buffer_ring);
+                lock.unlock();
+                if (!page) return INVALID_PAGE_ID;
+
+                disk_manager_->ReadPage(page_id, page->data_);
+                page_id_t next_page_id = next_page ? next_page(page->data_) : INVALID_PAGE_ID;
+                InstallPrefetchedPage(shard, page_id, page, true);
+                return next_page_id;
+            }
+        }
+
+        // already resident
+        page_id_t next_page_id = INVALID_PAGE_ID;
+        if (next_page) {
+            page->RLatch();
+            next_page_id = next_page(page->data_);
+            page->RUnlatch();
+        }
+        Unpin(shard, page);
+        return next_page_id;
+    }
+
+/*
+ * Claim a frame to read page_id into and enter it into the page table right
+ * away, still claimed (pin count -1): nobody can pin the page until
+ * InstallPrefetchedPage, and a FetchPage of it waits for the read rather
+ * than reading a copy of its own, which could be changed and written back
+ * before this older one is published.
+ * Caller must hold shard.latch_
+ * @return: nullptr if the page is resident or no frame was available
+ */
+    Page *BufferPoolManager::ClaimPrefetchFrame(Shard &shard, page_id_t page_id,
+                                                BufferRing *buffer_ring) {
+        Page *page = nullptr;
+        if (shard.page_table_->Find(page_id, page)) return nullptr;
+        page = buffer_ring ? GetRingVictimPage(shard, *buffer_ring)
+                           : GetVictimPage(shard);
+        if (!page) return nullptr;
         page->page_id_ = page_id;
-        page->ResetMemory();
         page->is_dirty_ = false;
-        page->pin_count_ = 1;
+        page->rec_lsn_ = INVALID_LSN;
+        page->access_count_ = 0;
+        shard.page_table_->Insert(page_id, page);
         return page;
     }
+
+/*
+ * Publish a frame claimed by ClaimPrefetchFrame once page_id has been read
+ * into it, unpinned, and wake up the fetches waiting for it. If the read
+ * failed the page leaves the page table again and the frame goes back to
+ * the free list.
+ */
+    void BufferPoolManager::InstallPrefetchedPage(Shard &shard, page_id_t page_id,
+                                                  Page *page, bool read_ok) {
+        {
+            std::lock_guard<std::mutex> guard(shard.latch_);
+            if (!read_ok) {
+                shard.page_table_->Remove(page_id);
+                page->page_id_ = INVALID_PAGE_ID;
+                page->buffer_ring_ = nullptr;
+                page->ResetMemory();
+                shard.free_list_->push_back(page);
+            } else {
+                page->pin_count_ = 0;
+                if (page->buffer_ring_ == nullptr) shard.replacer_->Insert(page);
+                stats_.Add(BufferPoolCounter::PREFETCH);
+            }
+        }
+        shard.loaded_cv_.notify_all();
+    }
+
+// first word of a file written by SaveResidentPages
+#define RESIDENT_PAGES_MAGIC 0x4d524157
+
+/*
+ * Write the ids of the resident pages of every shard to file_name, hottest
+ * first. Within a shard, pages the replacer cannot rank (pinned) come first,
+ * then the replacer's victim order backwards. Shards are interleaved rank by
+ * rank. Frames of buffer rings are left out.
+ * @return: false if the file could not be written
+ */
+    bool BufferPoolManager::SaveResidentPages(const std::string &file_name) {
+        std::vector<std::vector<page_id_t>> ranked(num_instances_);
+        size_t max_rank = 0;
+        for (size_t i = 0; i < num_instances_; ++i) {
+            Shard &shard = shards_[i];
+            std::vector<Page *> victims(shard.size_);
+            std::vector<bool> is_ranked(shard.size_, false);
+            std::lock_guard<std::mutex> guard(shard.latch_);
+            size_t num_victims = shard.replacer_->PeekVictims(victims.data(), shard.size_);
+            for (size_t j = 0; j < num_victims; ++j) {
+                is_ranked[victims[j] - shard.pages_] = true;
+            }
+            auto is_resident = [](Page *page) {
+                return page->page_id_ != INVALID_PAGE_ID && page->pin_count_ >= 0 &&
+                       page->buffer_ring_ == nullptr;
+            };
+            for (size_t j = 0; j < shard.size_; ++j) {
+                if (!is_ranked[j] && is_resident(&shard.pages_[j])) {
+                    ranked[i].push_back(shard.pages_[j].page_id_);
+                }
+            }
+            for (size_t j = num_victims; j > 0; --j) {
+                if (is_resident(victims[j - 1])) ranked[i].push_back(victims[j - 1]->page_id_);
+            }
+            max_rank = std::max(max_rank, ranked[i].size());
+        }
+
+        std::vector<page_id_t> page_ids;
+        for (size_t rank = 0; rank < max_rank; ++rank) {
+            for (size_t i = 0; i < num_instances_; ++i) {
+                if (rank < ranked[i].size()) page_ids.push_back(ranked[i][rank]);
+            }
+        }
+
+        std::ofstream out(file_name, std::ios::binary | std::ios::trunc);
+        uint32_t header[2] = {RESIDENT_PAGES_MAGIC, static_cast<uint32_t>(page_ids.size())};
+        out.write(reinterpret_cast<const char *>(header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(page_ids.data()),
+                  page_ids.size() * sizeof(page_id_t));
+        return out.good();
+    }
+
+/*
+ * Read a file written by SaveResidentPages and load its pages in the
+ * background, at most as many as the pool holds. A missing or malformed
+ * file loads nothing.
+ */
+    std::future<size_t> BufferPoolManager::LoadResidentPages(const std::string &file_name) {
+        auto loaded = std::make_shared<std::promise<size_t>>();
+        std::future<size_t> result = loaded->get_future();
+
+        std::ifstream in(file_name, std::ios::binary);
+        uint32_t header[2] = {0, 0};
+        in.read(reinterpret_cast<char *>(header), sizeof(header));
+        if (!in || header[0] != RESIDENT_PAGES_MAGIC) {
+            loaded->set_value(0);
+            return result;
+        }
+        std::vector<page_id_t> page_ids(std::min<size_t>(header[1], pool_size_));
+        in.read(reinterpret_cast<char *>(page_ids.data()),
+                page_ids.size() * sizeof(page_id_t));
+        if (!in) {
+            loaded->set_value(0);
+            return result;
+        }
+
+        GetIOWorkers().Submit([this, page_ids, loaded] { loaded->set_value(WarmUp(page_ids)); });
+        return result;
+    }
+
+/*
+ * Read page_ids (hottest first) in ascending runs of consecutive pages into
+ * claimed free frames, published (and counted) like prefetched pages, then
+ * hand the pages that nobody fetched meanwhile to the replacers again,
+ * coldest first, so that they get the order they were saved in.
+ * Pages past the end of the file are skipped: they were never written.
+ * @return: number of pages loaded
+ */
+    size_t BufferPoolManager::WarmUp(const std::vector<page_id_t> &page_ids) {
+        std::vector<page_id_t> sorted(page_ids);
+        std::sort(sorted.begin(), sorted.end());
+        sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+        page_id_t num_pages = static_cast<page_id_t>(disk_manager_->GetNumPages());
+        std::vector<char> buffer(WARM_UP_READ_PAGES * page_size_);
+
+        size_t num_loaded = 0;
+        for (size_t i = 0; i < sorted.size();) {
+            if (sorted[i] < 0 || sorted[i] >= num_pages) {
+                ++i;
+                continue;
+            }
+            size_t run = 1;
+            while (i + run < sorted.size() && run < WARM_UP_READ_PAGES &&
+                   sorted[i + run] == sorted[i] + static_cast<page_id_t>(run) &&
+                   sorted[i + run] < num_pages) {
+                ++run;
+            }
+            std::vector<Page *> frames(run);
+            bool claimed = false;
+            for (size_t j = 0; j < run; ++j) {
+                frames[j] = ClaimWarmFrame(sorted[i + j]);
+                claimed = claimed || frames[j] != nullptr;
+            }
+            if (claimed) disk_manager_->ReadPages(sorted[i], run, buffer.data());
+            for (size_t j = 0; j < run; ++j) {
+                if (!frames[j]) continue;
+                memcpy(frames[j]->data_, buffer.data() + j * page_size_, page_size_);
+                InstallPrefetchedPage(GetShard(sorted[i + j]), sorted[i + j], frames[j], true);
+                ++num_loaded;
+            }
+            i += run;
+        }
+
+        for (auto it = page_ids.rbegin(); it != page_ids.rend(); ++it) {
+            Shard &shard = GetShard(*it);
+            std::lock_guard<std::mutex> guard(shard.latch_);
+            Page *page = nullptr;
+            if (!shard.page_table_->Find(*it, page)) continue;
+            if (page->pin_count_ != 0 || page->access_count_ != 0 ||
+                page->buffer_ring_ != nullptr) continue;
+            shard.replacer_->Erase(page);
+            shard.replacer_->Insert(page);
+        }
+        return num_loaded;
+    }
+
+/*
+ * Claim a free frame of the shard of page_id for the warm-up, entered into
+ * the page table the way ClaimPrefetchFrame does: a fetch of the page
+ * during the read waits for it, and the page cannot be fetched, changed and
+ * evicted meanwhile only to be replaced by the older copy read here.
+ * @return: nullptr if the page is resident or the shard has no free frame
+ */
+    Page *BufferPoolManager::ClaimWarmFrame(page_id_t page_id) {
+        Shard &shard = GetShard(page_id);
+        std::lock_guard<std::mutex> guard(shard.latch_);
+        if (shard.free_list_->empty()) return nullptr;
+        return ClaimPrefetchFrame(shard, page_id, nullptr);
+    }
+
 } // namespace cmudb
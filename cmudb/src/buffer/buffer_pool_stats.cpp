@@ -0,0 +1,144 @@
+/**
+ * buffer_pool_stats.cpp
+ */
+#include "buffer/buffer_pool_stats.h"
+
+namespace cmudb {
+
+uint64_t LatencyHistogram::Count() const {
+  uint64_t count = 0;
+  for (size_t i = 0; i < STATS_HISTOGRAM_BUCKETS; ++i) {
+    count += buckets_[i];
+  }
+  return count;
+}
+
+uint64_t LatencyHistogram::Percentile(double p) const {
+  uint64_t count = Count();
+  if (count == 0)
+    return 0;
+  // rank of the percentile among the recorded latencies, 1 based
+  uint64_t rank = static_cast<uint64_t>(p * count + 0.5);
+  if (rank == 0)
+    rank = 1;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < STATS_HISTOGRAM_BUCKETS; ++i) {
+    seen += buckets_[i];
+    if (seen >= rank)
+      return BucketUpperBound(i);
+  }
+  return Max();
+}
+
+uint64_t LatencyHistogram::Max() const {
+  for (size_t i = STATS_HISTOGRAM_BUCKETS; i > 0; --i) {
+    if (buckets_[i - 1] != 0)
+      return BucketUpperBound(i - 1);
+  }
+  return 0;
+}
+
+BufferPoolStats::BufferPoolStats() { Reset(); }
+
+/*
+ * Threads are spread over the stripes round robin, in the order they first
+ * touch any pool
+ */
+BufferPoolStats::Stripe &BufferPoolStats::GetStripe() {
+  static std::atomic<size_t> next_stripe{0};
+  thread_local size_t stripe =
+      next_stripe.fetch_add(1, std::memory_order_relaxed) %
+      BUFFER_POOL_STATS_STRIPES;
+  return stripes_[stripe];
+}
+
+void BufferPoolStats::RecordLatency(BufferPoolLatency latency, uint64_t ns) {
+  // bit length of ns, the last bucket also takes everything above it
+  size_t bucket = ns == 0 ? 0 : 64 - __builtin_clzll(ns);
+  if (bucket >= STATS_HISTOGRAM_BUCKETS)
+    bucket = STATS_HISTOGRAM_BUCKETS - 1;
+  GetStripe()
+      .buckets_[static_cast<size_t>(latency)][bucket]
+      .fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t BufferPoolStats::Get(BufferPoolCounter counter) const {
+  uint64_t value = 0;
+  for (const Stripe &stripe : stripes_) {
+    value += stripe.counters_[static_cast<size_t>(counter)].load(
+        std::memory_order_relaxed);
+  }
+  return value;
+}
+
+BufferPoolStatsSnapshot BufferPoolStats::Snapshot() const {
+  BufferPoolStatsSnapshot snapshot;
+  for (const Stripe &stripe : stripes_) {
+    for (size_t i = 0; i < NUM_POOL_COUNTERS; ++i) {
+      snapshot.counters_[i] +=
+          stripe.counters_[i].load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < NUM_POOL_LATENCIES; ++i) {
+      for (size_t j = 0; j < STATS_HISTOGRAM_BUCKETS; ++j) {
+        snapshot.latencies_[i].buckets_[j] +=
+            stripe.buckets_[i][j].load(std::memory_order_relaxed);
+      }
+    }
+  }
+  return snapshot;
+}
+
+void BufferPoolStats::Reset() {
+  for (Stripe &stripe : stripes_) {
+    for (size_t i = 0; i < NUM_POOL_COUNTERS; ++i) {
+      stripe.counters_[i].store(0, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < NUM_POOL_LATENCIES; ++i) {
+      for (size_t j = 0; j < STATS_HISTOGRAM_BUCKETS; ++j) {
+        stripe.buckets_[i][j].store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+}
+
+const char *BufferPoolStats::GetName(BufferPoolCounter counter) {
+  switch (counter) {
+  case BufferPoolCounter::FETCH_HIT:
+    return "fetch_hits";
+  case BufferPoolCounter::FETCH_MISS:
+    return "fetch_misses";
+  case BufferPoolCounter::NEW_PAGE:
+    return "new_pages";
+  case BufferPoolCounter::EVICTION:
+    return "evictions";
+  case BufferPoolCounter::FOREGROUND_WRITE:
+    return "foreground_writes";
+  case BufferPoolCounter::CLEANER_WRITE:
+    return "cleaner_writes";
+  case BufferPoolCounter::FLUSH_WRITE:
+    return "flush_writes";
+  case BufferPoolCounter::WRITE_RUN:
+    return "write_runs";
+  case BufferPoolCounter::PREFETCH:
+    return "prefetches";
+  case BufferPoolCounter::LATCH_WAIT_NS:
+    return "latch_wait_ns";
+  default:
+    return "unknown";
+  }
+}
+
+const char *BufferPoolStats::GetName(BufferPoolLatency latency) {
+  switch (latency) {
+  case BufferPoolLatency::FETCH_HIT:
+    return "fetch_hit";
+  case BufferPoolLatency::FETCH_MISS:
+    return "fetch_miss";
+  case BufferPoolLatency::NEW_PAGE:
+    return "new_page";
+  default:
+    return "unknown";
+  }
+}
+
+} // namespace cmudb
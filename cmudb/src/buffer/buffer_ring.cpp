@@ -0,0 +1,16 @@
+/**
+ * buffer_ring.cpp
+ */
+#include "buffer/buffer_ring.h"
+#include "buffer/buffer_pool_manager.h"
+
+namespace cmudb {
+
+BufferRing::BufferRing(BufferPoolManager *buffer_pool_manager, size_t size)
+    : buffer_pool_manager_(buffer_pool_manager), size_(size) {
+  frames_.reserve(size_);
+}
+
+BufferRing::~BufferRing() { buffer_pool_manager_->ReleaseBufferRing(*this); }
+
+} // namespace cmudb
@@ -0,0 +1,104 @@
+/**
+ * CLOCK implementation
+ */
+#include <cassert>
+
+#include "buffer/clock_replacer.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+template <typename T>
+ClockReplacer<T>::ClockReplacer(size_t num_frames, T base)
+    : num_frames_(num_frames), base_(base), hand_(0), size_(0) {
+  in_replacer_ = new bool[num_frames_]();
+  ref_ = new bool[num_frames_]();
+}
+
+template <typename T> ClockReplacer<T>::~ClockReplacer() {
+  delete[] in_replacer_;
+  delete[] ref_;
+}
+
+/*
+ * Insert value into the clock, or give it a second chance if it is already
+ * there
+ */
+template <typename T> void ClockReplacer<T>::Insert(const T &value) {
+  size_t slot = SlotOf(value);
+  assert(slot < num_frames_);
+  std::lock_guard<std::mutex> guard(latch_);
+  if (!in_replacer_[slot]) {
+    in_replacer_[slot] = true;
+    ++size_;
+  }
+  ref_[slot] = true;
+}
+
+/*
+ * Advance the hand until it meets a frame whose reference bit is clear,
+ * clearing the bits it passes. Two rounds are always enough.
+ * If the clock is empty, return false
+ */
+template <typename T> bool ClockReplacer<T>::Victim(T &value) {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (size_ == 0) return false;
+  while (true) {
+    size_t slot = hand_;
+    hand_ = hand_ + 1 == num_frames_ ? 0 : hand_ + 1;
+    if (!in_replacer_[slot]) continue;
+    if (ref_[slot]) {
+      ref_[slot] = false;
+      continue;
+    }
+    in_replacer_[slot] = false;
+    --size_;
+    value = base_ + slot;
+    return true;
+  }
+}
+
+/*
+ * Remove value from the clock. If removal is successful, return true,
+ * otherwise return false
+ */
+template <typename T> bool ClockReplacer<T>::Erase(const T &value) {
+  size_t slot = SlotOf(value);
+  if (slot >= num_frames_) return false;
+  std::lock_guard<std::mutex> guard(latch_);
+  if (!in_replacer_[slot]) return false;
+  in_replacer_[slot] = false;
+  ref_[slot] = false;
+  --size_;
+  return true;
+}
+
+template <typename T> size_t ClockReplacer<T>::Size() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return size_;
+}
+
+/*
+ * The hand takes frames without reference bit first, then the others once
+ * it has cleared their bit
+ */
+template <typename T>
+size_t ClockReplacer<T>::PeekVictims(T *values, size_t max_values) {
+  std::lock_guard<std::mutex> guard(latch_);
+  size_t count = 0;
+  for (int round = 0; round < 2; ++round) {
+    for (size_t i = 0; i < num_frames_ && count < max_values; ++i) {
+      size_t slot = (hand_ + i) % num_frames_;
+      if (in_replacer_[slot] && ref_[slot] == (round == 1)) {
+        values[count++] = base_ + slot;
+      }
+    }
+  }
+  return count;
+}
+
+template class ClockReplacer<Page *>;
+// test only
+template class ClockReplacer<int>;
+
+} // namespace cmudb
@@ -0,0 +1,143 @@
+/**
+ * LRU-K implementation
+ */
+#include <cassert>
+
+#include "buffer/lru_k_replacer.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+template <typename T>
+LRUKReplacer<T>::LRUKReplacer(size_t num_frames, T base, size_t k,
+                              uint64_t correlated_period)
+    : num_frames_(num_frames), base_(base), k_(k),
+      correlated_period_(correlated_period), current_ts_(0), size_(0) {
+  assert(k_ > 0);
+  in_replacer_ = new bool[num_frames_]();
+  num_refs_ = new size_t[num_frames_]();
+  history_ = new uint64_t[num_frames_ * k_]();
+}
+
+template <typename T> LRUKReplacer<T>::~LRUKReplacer() {
+  delete[] in_replacer_;
+  delete[] num_refs_;
+  delete[] history_;
+}
+
+/*
+ * Record a reference to value and make it evictable. A reference inside the
+ * correlated period of the previous one replaces it instead of adding a new
+ * entry to the history.
+ */
+template <typename T> void LRUKReplacer<T>::Insert(const T &value) {
+  size_t slot = SlotOf(value);
+  assert(slot < num_frames_);
+  std::lock_guard<std::mutex> guard(latch_);
+  uint64_t now = ++current_ts_;
+  if (!in_replacer_[slot]) {
+    in_replacer_[slot] = true;
+    ++size_;
+  }
+
+  uint64_t *history = HistoryOf(slot);
+  if (num_refs_[slot] > 0 && now - history[0] <= correlated_period_) {
+    history[0] = now;
+    return;
+  }
+  if (num_refs_[slot] < k_) ++num_refs_[slot];
+  for (size_t i = num_refs_[slot] - 1; i > 0; --i) {
+    history[i] = history[i - 1];
+  }
+  history[0] = now;
+}
+
+/*
+ * Whether slot goes before other: frames outside their correlated period
+ * first, then the largest backward K-distance, then the lowest slot.
+ * Caller must hold latch_
+ */
+template <typename T>
+bool LRUKReplacer<T>::EvictsBefore(size_t slot, size_t other) {
+  const uint64_t *history = HistoryOf(slot);
+  const uint64_t *other_history = HistoryOf(other);
+  bool correlated = current_ts_ - history[0] <= correlated_period_;
+  bool other_correlated = current_ts_ - other_history[0] <= correlated_period_;
+  if (correlated != other_correlated) return other_correlated;
+  bool infinite = num_refs_[slot] < k_;
+  bool other_infinite = num_refs_[other] < k_;
+  if (infinite != other_infinite) return infinite;
+  // oldest known reference, which is the K-th one for a full history
+  uint64_t ts = history[num_refs_[slot] - 1];
+  uint64_t other_ts = other_history[num_refs_[other] - 1];
+  if (ts != other_ts) return ts < other_ts;
+  return slot < other;
+}
+
+/*
+ * Evict the frame with the largest backward K-distance, preferring frames
+ * outside their correlated period.
+ * If LRU-K is empty, return false
+ */
+template <typename T> bool LRUKReplacer<T>::Victim(T &value) {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (size_ == 0) return false;
+
+  size_t victim = num_frames_;
+  for (size_t slot = 0; slot < num_frames_; ++slot) {
+    if (!in_replacer_[slot]) continue;
+    if (victim == num_frames_ || EvictsBefore(slot, victim)) victim = slot;
+  }
+
+  in_replacer_[victim] = false;
+  --size_;
+  value = base_ + victim;
+  return true;
+}
+
+/*
+ * Repeated selection of the next frame after the previous one, so nothing
+ * has to be allocated
+ */
+template <typename T>
+size_t LRUKReplacer<T>::PeekVictims(T *values, size_t max_values) {
+  std::lock_guard<std::mutex> guard(latch_);
+  size_t count = 0, prev = num_frames_;
+  while (count < max_values && count < size_) {
+    size_t next = num_frames_;
+    for (size_t slot = 0; slot < num_frames_; ++slot) {
+      if (!in_replacer_[slot]) continue;
+      if (prev != num_frames_ && !EvictsBefore(prev, slot)) continue;
+      if (next == num_frames_ || EvictsBefore(slot, next)) next = slot;
+    }
+    values[count++] = base_ + next;
+    prev = next;
+  }
+  return count;
+}
+
+/*
+ * Remove value from LRU-K and forget its history. If value was evictable
+ * return true, otherwise return false
+ */
+template <typename T> bool LRUKReplacer<T>::Erase(const T &value) {
+  size_t slot = SlotOf(value);
+  if (slot >= num_frames_) return false;
+  std::lock_guard<std::mutex> guard(latch_);
+  num_refs_[slot] = 0;
+  if (!in_replacer_[slot]) return false;
+  in_replacer_[slot] = false;
+  --size_;
+  return true;
+}
+
+template <typename T> size_t LRUKReplacer<T>::Size() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return size_;
+}
+
+template class LRUKReplacer<Page *>;
+// test only
+template class LRUKReplacer<int>;
+
+} // namespace cmudb
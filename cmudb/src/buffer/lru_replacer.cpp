@@ -1,67 +1,68 @@
 /**
  * LRU implementation
  */
+#include <cassert>
+
 #include "buffer/lru_replacer.h"
 #include "page/page.h"
 
 namespace cmudb {
 
-template <typename T> LRUReplacer<T>::LRUReplacer()
-: head_(std::make_shared<Node>()), tail_(std::make_shared<Node>()) {
-    head_->next = tail_;
-    tail_->pre = head_;
+template <typename T>
+LRUReplacer<T>::LRUReplacer(size_t num_frames, T base)
+: num_frames_(num_frames), base_(base), head_(num_frames), size_(0) {
+    links_ = new Link[num_frames_ + 1];
+    links_[head_].pre = links_[head_].next = head_;
+    in_replacer_ = new bool[num_frames_]();
 }
 
 template <typename T> LRUReplacer<T>::~LRUReplacer() {
-    while (head_) {
-        auto next = head_->next;
-        head_->next = nullptr;
-        head_ = next;
-    }
-    while (tail_) {
-        auto pre = tail_->pre;
-        tail_->pre = nullptr;
-        tail_ = pre;
-    }
+    delete[] links_;
+    delete[] in_replacer_;
+}
+
+template <typename T> void LRUReplacer<T>::Unlink(uint32_t slot) {
+    Link &link = links_[slot];
+    links_[link.pre].next = link.next;
+    links_[link.next].pre = link.pre;
+}
+
+template <typename T> void LRUReplacer<T>::PushFront(uint32_t slot) {
+    Link &link = links_[slot];
+    link.pre = head_;
+    link.next = links_[head_].next;
+    links_[link.next].pre = slot;
+    links_[head_].next = slot;
 }
 
 /*
  * Insert value into LRU
  */
 template <typename T> void LRUReplacer<T>::Insert(const T &value) {
+    size_t slot = SlotOf(value);
+    assert(slot < num_frames_);
     std::lock_guard<std::mutex> guard(latch_);
-    if (map_.count(value)) {
-        auto node = map_[value];
-        auto pre = node->pre, next = node->next;
-        pre->next = next;
-        next->pre = pre;
-        node->next = head_->next;
-        node->next->pre = node;
-        node->pre = head_;
-        head_->next = node;
+    if (in_replacer_[slot]) {
+        if (links_[head_].next == slot) return;
+        Unlink(slot);
     } else {
-        auto node = std::make_shared<Node>(value);
-        map_[value] = node;
-        node->next = head_->next;
-        node->next->pre = node;
-        head_->next = node;
-        node->pre = head_;
+        in_replacer_[slot] = true;
+        ++size_;
     }
+    PushFront(slot);
 }
+
 /*
  * return true. If LRU is empty, return false
  */
 template <typename T> bool LRUReplacer<T>::Victim(T &value) {
     std::lock_guard<std::mutex> guard(latch_);
-    if (map_.empty()) return false;
-    auto node = tail_->pre;
-    node->pre->next = tail_;
-    tail_->pre = node->pre;
-    map_.erase(node->val);
-    node->pre = nullptr;
-    node->next = nullptr;
-    map_.erase(node->val);
-    value = node->val;
+    if (size_ == 0) return false;
+    uint32_t slot = links_[head_].pre;
+    Unlink(slot);
+    in_replacer_[slot] = false;
+    --size_;
+    value = base_ + slot;
     return true;
 }
 
@@ -70,21 +71,32 @@ template <typename T> bool LRUReplacer<T>::Victim(T &value) {
  * return false
  */
 template <typename T> bool LRUReplacer<T>::Erase(const T &value) {
+    size_t slot = SlotOf(value);
+    if (slot >= num_frames_) return false;
     std::lock_guard<std::mutex> guard(latch_);
-    if (!map_.count(value)) return false;
-    auto node = map_[value];
-    auto pre = node->pre, next = node->next;
-    pre->next = next;
-    next->pre = pre;
-    map_.erase(value);
-    node->next = nullptr;
-    node->pre = nullptr;
+    if (!in_replacer_[slot]) return false;
+    Unlink(slot);
+    in_replacer_[slot] = false;
+    --size_;
     return true;
 }
 
-template <typename T> size_t LRUReplacer<T>::Size() { 
+template <typename T> size_t LRUReplacer<T>::Size() {
     std::lock_guard<std::mutex> guard(latch_);
-    return map_.size(); 
+    return size_;
+}
+
+/*
+ * Values from least to most recently inserted
+ */
+template <typename T> size_t LRUReplacer<T>::PeekVictims(T *values, size_t max_values) {
+    std::lock_guard<std::mutex> guard(latch_);
+    size_t count = 0;
+    for (uint32_t slot = links_[head_].pre; slot != head_ && count < max_values;
+         slot = links_[slot].pre) {
+        values[count++] = base_ + slot;
+    }
+    return count;
 }
 
 template class LRUReplacer<Page *>;
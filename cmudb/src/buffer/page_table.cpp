@@ -0,0 +1,97 @@
+/**
+ * page_table.cpp
+ */
+#include <cassert>
+
+#include "buffer/page_table.h"
+
+namespace cmudb {
+
+/*
+ * Use at least twice as many slots as frames, rounded to a power of two, so
+ * the load factor stays at or below one half
+ */
+PageTable::PageTable(Page *frames, size_t capacity)
+    : frames_(frames), capacity_(capacity) {
+  size_t num_slots = 2;
+  while (num_slots < 2 * capacity_) {
+    num_slots <<= 1;
+  }
+  mask_ = num_slots - 1;
+  slots_ = new std::atomic<uint64_t>[num_slots];
+  for (size_t i = 0; i < num_slots; ++i) {
+    slots_[i] = EMPTY_SLOT;
+  }
+}
+
+PageTable::~PageTable() { delete[] slots_; }
+
+/*
+ * Lock free lookup, probing from the home slot of page_id up to the first
+ * empty slot. An entry moved back by a concurrent Remove can be missed.
+ */
+bool PageTable::Find(const page_id_t &page_id, Page *&page) {
+  size_t slot = SlotOf(page_id);
+  for (size_t steps = 0; steps <= mask_; ++steps) {
+    uint64_t entry = slots_[slot].load();
+    if (entry == EMPTY_SLOT)
+      return false;
+    if (KeyOf(entry) == page_id) {
+      page = &frames_[FrameOf(entry)];
+      return true;
+    }
+    slot = (slot + 1) & mask_;
+  }
+  return false;
+}
+
+/*
+ * Empty the slot of page_id, then move back every following entry of the
+ * probe run whose home slot does not lie between the hole and the entry.
+ * An entry is copied to its new slot before its old one is overwritten, so
+ * readers never see a frame that is not in the table.
+ */
+bool PageTable::Remove(const page_id_t &page_id) {
+  size_t hole = SlotOf(page_id);
+  for (;;) {
+    uint64_t entry = slots_[hole].load();
+    if (entry == EMPTY_SLOT)
+      return false;
+    if (KeyOf(entry) == page_id)
+      break;
+    hole = (hole + 1) & mask_;
+  }
+
+  size_t next = hole;
+  for (;;) {
+    next = (next + 1) & mask_;
+    uint64_t entry = slots_[next].load();
+    if (entry == EMPTY_SLOT)
+      break;
+    size_t home = SlotOf(KeyOf(entry));
+    // distance travelled from home, stays put if it does not pass the hole
+    if (((next - home) & mask_) < ((next - hole) & mask_))
+      continue;
+    slots_[hole].store(entry);
+    hole = next;
+  }
+  slots_[hole].store(EMPTY_SLOT);
+  return true;
+}
+
+/*
+ * Publish the frame in the first empty slot of the probe run. The frame must
+ * belong to the table, already carry page_id and not be in the table.
+ */
+void PageTable::Insert(const page_id_t &page_id, Page *const &page) {
+  assert(page >= frames_ && page < frames_ + capacity_);
+  uint64_t entry = static_cast<uint64_t>(static_cast<uint32_t>(page_id)) << 32 |
+                   static_cast<uint32_t>(page - frames_);
+  size_t slot = SlotOf(page_id);
+  while (slots_[slot].load() != EMPTY_SLOT) {
+    slot = (slot + 1) & mask_;
+  }
+  slots_[slot].store(entry);
+}
+
+} // namespace cmudb
@@ -0,0 +1,52 @@
+/**
+ * thread_pool.cpp
+ */
+#include "common/thread_pool.h"
+
+namespace cmudb {
+
+ThreadPool::ThreadPool(size_t num_threads) : stopped_(false) {
+  for (size_t i = 0; i < num_threads; ++i) {
+    workers_.emplace_back([this] { WorkerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    stopped_ = true;
+    tasks_.clear();
+  }
+  cv_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    tasks_.push_back(std::move(task));
+  }
+  cv_.notify_one();
+}
+
+size_t ThreadPool::GetQueueSize() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return tasks_.size();
+}
+
+void ThreadPool::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(latch_);
+  while (true) {
+    cv_.wait(lock, [this] { return stopped_ || !tasks_.empty(); });
+    if (stopped_) return;
+    std::function<void()> task = std::move(tasks_.front());
+    tasks_.pop_front();
+    lock.unlock();
+    task();
+    lock.lock();
+  }
+}
+
+} // namespace cmudb
@@ -7,19 +7,149 @@
 namespace cmudb {
 
 bool LockManager::LockShared(Transaction *txn, const RID &rid) {
-  return false;
+  std::unique_lock<std::mutex> lock(latch_);
+  if (!Acquire(txn, rid, LockMode::SHARED, lock)) return false;
+  txn->GetSharedLockSet()->emplace(rid);
+  return true;
 }
 
 bool LockManager::LockExclusive(Transaction *txn, const RID &rid) {
-  return false;
+  std::unique_lock<std::mutex> lock(latch_);
+  if (!Acquire(txn, rid, LockMode::EXCLUSIVE, lock)) return false;
+  txn->GetExclusiveLockSet()->emplace(rid);
+  return true;
 }
 
+/*
+ * Turn a shared lock of txn into an exclusive one. Only one holder can wait
+ * for an upgrade at a time, a second one would deadlock with the first.
+ */
 bool LockManager::LockUpgrade(Transaction *txn, const RID &rid) {
-  return false;
+  std::unique_lock<std::mutex> lock(latch_);
+  auto queue_it = lock_table_.find(rid);
+  if (txn->GetState() != TransactionState::GROWING ||
+      queue_it == lock_table_.end() || queue_it->second.upgrading_) {
+    Abort(txn);
+    return false;
+  }
+  LockQueue &queue = queue_it->second;
+  auto it = queue.requests_.begin();
+  while (it != queue.requests_.end() &&
+         !(it->txn_id_ == txn->GetTransactionId() && it->granted_)) {
+    ++it;
+  }
+  if (it == queue.requests_.end() || it->mode_ != LockMode::SHARED) {
+    Abort(txn);
+    return false;
+  }
+  // the other shared holders must all be younger
+  for (auto &request : queue.requests_) {
+    if (request.granted_ && request.txn_id_ < txn->GetTransactionId()) {
+      Abort(txn);
+      return false;
+    }
+  }
+  queue.requests_.erase(it);
+  txn->GetSharedLockSet()->erase(rid);
+  // first in line, behind the holders
+  auto pos = queue.requests_.begin();
+  while (pos != queue.requests_.end() && pos->granted_) ++pos;
+  auto request = queue.requests_.emplace(pos, txn->GetTransactionId(),
+                                         LockMode::EXCLUSIVE);
+  queue.upgrading_ = true;
+  queue.cv_.wait(lock, [&] { return IsGrantable(queue, request); });
+  queue.upgrading_ = false;
+  request->granted_ = true;
+  txn->GetExclusiveLockSet()->emplace(rid);
+  return true;
 }
 
+/*
+ * With strict 2PL locks are only released at commit or abort, otherwise the
+ * first unlock ends the growing phase
+ */
 bool LockManager::Unlock(Transaction *txn, const RID &rid) {
+  std::unique_lock<std::mutex> lock(latch_);
+  if (strict_2PL_ && txn->GetState() != TransactionState::COMMITTED &&
+      txn->GetState() != TransactionState::ABORTED) {
+    Abort(txn);
+    return false;
+  }
+  if (txn->GetState() == TransactionState::GROWING) {
+    txn->SetState(TransactionState::SHRINKING);
+  }
+  txn->GetSharedLockSet()->erase(rid);
+  txn->GetExclusiveLockSet()->erase(rid);
+  auto queue_it = lock_table_.find(rid);
+  if (queue_it == lock_table_.end()) return false;
+  LockQueue &queue = queue_it->second;
+  for (auto it = queue.requests_.begin(); it != queue.requests_.end(); ++it) {
+    if (it->txn_id_ == txn->GetTransactionId() && it->granted_) {
+      queue.requests_.erase(it);
+      if (queue.requests_.empty()) {
+        lock_table_.erase(queue_it);
+      } else {
+        queue.cv_.notify_all();
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * Queue a request of txn for rid and wait until it is granted, or die if it
+ * would wait for an older transaction. Caller holds latch_.
+ */
+bool LockManager::Acquire(Transaction *txn, const RID &rid, LockMode mode,
+                          std::unique_lock<std::mutex> &lock) {
+  if (txn->GetState() != TransactionState::GROWING) {
+    Abort(txn);
+    return false;
+  }
+  LockQueue &queue = lock_table_[rid];
+  if (Die(txn, queue, mode)) {
+    if (queue.requests_.empty()) lock_table_.erase(rid);
+    return false;
+  }
+  auto request =
+      queue.requests_.emplace(queue.requests_.end(), txn->GetTransactionId(),
+                              mode);
+  queue.cv_.wait(lock, [&] { return IsGrantable(queue, request); });
+  request->granted_ = true;
+  return true;
+}
+
+/*
+ * Wait-die: abort txn if an older transaction holds or waits for a lock that
+ * conflicts with mode
+ * @return: true if txn died
+ */
+bool LockManager::Die(Transaction *txn, LockQueue &queue, LockMode mode) {
+  for (auto &request : queue.requests_) {
+    bool conflicts =
+        mode == LockMode::EXCLUSIVE || request.mode_ == LockMode::EXCLUSIVE;
+    if (conflicts && request.txn_id_ < txn->GetTransactionId()) {
+      Abort(txn);
+      return true;
+    }
+  }
   return false;
 }
 
+bool LockManager::IsGrantable(LockQueue &queue,
+                              std::list<Request>::iterator request) {
+  if (request->mode_ == LockMode::EXCLUSIVE) {
+    return request == queue.requests_.begin();
+  }
+  for (auto it = queue.requests_.begin(); it != request; ++it) {
+    if (it->mode_ == LockMode::EXCLUSIVE) return false;
+  }
+  return true;
+}
+
+void LockManager::Abort(Transaction *txn) {
+  txn->SetState(TransactionState::ABORTED);
+}
+
 } // namespace cmudb
@@ -12,7 +12,13 @@ Transaction *TransactionManager::Begin() {
   Transaction *txn = new Transaction(next_txn_id_++);
 
   if (ENABLE_LOGGING) {
-    // TODO: write log and update transaction's prev_lsn here
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::BEGIN);
+    // a checkpoint that starts after the begin record sees the transaction
+    std::lock_guard<std::mutex> guard(active_latch_);
+    lsn_t begin_lsn = log_manager_->AppendLogRecord(log_record);
+    txn->SetPrevLSN(begin_lsn);
+    active_txns_[txn->GetTransactionId()] = std::make_pair(txn, begin_lsn);
   }
 
   return txn;
@@ -34,7 +40,16 @@ void TransactionManager::Commit(Transaction *txn) {
   write_set->clear();
 
   if (ENABLE_LOGGING) {
-    // TODO: write log and update transaction's prev_lsn here
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::COMMIT);
+    lsn_t commit_lsn = log_manager_->AppendLogRecord(log_record);
+    txn->SetPrevLSN(commit_lsn);
+    {
+      std::lock_guard<std::mutex> guard(active_latch_);
+      active_txns_.erase(txn->GetTransactionId());
+    }
+    // durable once the commit record is, concurrent commits share the flush
+    log_manager_->Flush(commit_lsn);
   }
 
   // release all the lock
@@ -71,7 +86,11 @@ void TransactionManager::Abort(Transaction *txn) {
   write_set->clear();
 
   if (ENABLE_LOGGING) {
-    // TODO: write log and update transaction's prev_lsn here
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::ABORT);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(log_record));
+    std::lock_guard<std::mutex> guard(active_latch_);
+    active_txns_.erase(txn->GetTransactionId());
   }
 
   // release all the lock
@@ -85,4 +104,18 @@ void TransactionManager::Abort(Transaction *txn) {
     lock_manager_->Unlock(txn, locked_rid);
   }
 }
+
+lsn_t TransactionManager::GetActiveTransactions(
+    std::vector<std::pair<txn_id_t, lsn_t>> &active_txns) {
+  active_txns.clear();
+  lsn_t first_lsn = INVALID_LSN;
+  std::lock_guard<std::mutex> guard(active_latch_);
+  for (auto &entry : active_txns_) {
+    active_txns.emplace_back(entry.first, entry.second.first->GetPrevLSN());
+    if (first_lsn == INVALID_LSN || entry.second.second < first_lsn)
+      first_lsn = entry.second.second;
+  }
+  return first_lsn;
+}
+
 } // namespace cmudb
@@ -0,0 +1,359 @@
+/**
+ * async_io_engine.cpp
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "disk/async_io_engine.h"
+
+#if defined(__linux__) && defined(__NR_io_uring_setup) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define HAVE_IO_URING
+#endif
+#endif
+
+namespace cmudb {
+
+/*
+ * Blocking transfers of the whole buffer, a read past the end of the file
+ * is cut to zeros
+ */
+static bool ReadFully(int fd, char *data, size_t size, size_t offset) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t rc = pread(fd, data + done, size - done, offset + done);
+    if (rc < 0 && errno == EINTR) continue;
+    if (rc < 0) return false;
+    if (rc == 0) break;
+    done += rc;
+  }
+  memset(data + done, 0, size - done);
+  return true;
+}
+
+static bool WriteFully(int fd, const char *data, size_t size, size_t offset) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t rc = pwrite(fd, data + done, size - done, offset + done);
+    if (rc < 0 && errno == EINTR) continue;
+    if (rc <= 0) return false;
+    done += rc;
+  }
+  return true;
+}
+
+AsyncIOEngine *AsyncIOEngine::Create(size_t queue_depth) {
+  if (IOUringEngine::IsSupported()) {
+    return new IOUringEngine(queue_depth);
+  }
+  LOG_DEBUG("io_uring not available, using worker threads");
+  return new ThreadPoolIOEngine(ASYNC_IO_WORKERS, queue_depth);
+}
+
+/*****************************************************************************
+ * IO_URING
+ *****************************************************************************/
+struct IOUringEngine::Request {
+  std::promise<bool> done;
+  struct iovec iov;
+  size_t offset;
+  bool is_read;
+};
+
+#ifdef HAVE_IO_URING
+
+static int IOUringSetup(unsigned entries, struct io_uring_params *params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int IOUringEnter(int ring_fd, unsigned to_submit, unsigned min_complete,
+                        unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit,
+                                  min_complete, flags, nullptr, 0));
+}
+
+bool IOUringEngine::IsSupported() {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  int ring_fd = IOUringSetup(1, &params);
+  if (ring_fd < 0) return false;
+  close(ring_fd);
+  return true;
+}
+
+/*
+ * Set up a ring of queue_depth entries and map its queues, following
+ * io_uring_setup(2)
+ */
+IOUringEngine::IOUringEngine(size_t queue_depth)
+    : ring_fd_(-1), queue_depth_(queue_depth), sq_ring_(MAP_FAILED),
+      sqes_(MAP_FAILED), cq_ring_(MAP_FAILED), num_queued_(0),
+      num_in_flight_(0) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = IOUringSetup(queue_depth_, &params);
+  if (ring_fd_ < 0) {
+    throw Exception(EXCEPTION_TYPE_INVALID,
+                    std::string("io_uring_setup: ") + strerror(errno));
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  cq_ring_ = single_mmap
+                 ? sq_ring_
+                 : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+    Unmap();
+    close(ring_fd_);
+    throw Exception(EXCEPTION_TYPE_INVALID, "can not map io_uring queues");
+  }
+
+  char *sq = static_cast<char *>(sq_ring_);
+  sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  char *cq = static_cast<char *>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  cqes_ = cq + params.cq_off.cqes;
+  // the kernel rounds the depth up, never use more than asked for
+  queue_depth_ = std::min<size_t>(queue_depth_, params.sq_entries);
+
+  reaper_ = std::thread([this] { ReapLoop(); });
+}
+
+/*
+ * Wait for the requests in flight, then wake the reaper up with a request
+ * that carries no Request to tell it to stop
+ */
+IOUringEngine::~IOUringEngine() {
+  {
+    std::unique_lock<std::mutex> lock(latch_);
+    SubmitLocked();
+    cv_.wait(lock, [this] { return num_in_flight_ == 0; });
+    PushLocked(IORING_OP_NOP, -1, nullptr);
+    SubmitLocked();
+  }
+  reaper_.join();
+  Unmap();
+  close(ring_fd_);
+}
+
+std::future<bool> IOUringEngine::Read(int fd, char *data, size_t size,
+                                      size_t offset) {
+  return Queue(true, fd, data, size, offset);
+}
+
+std::future<bool> IOUringEngine::Write(int fd, const char *data, size_t size,
+                                       size_t offset) {
+  return Queue(false, fd, const_cast<char *>(data), size, offset);
+}
+
+void IOUringEngine::Submit() {
+  std::lock_guard<std::mutex> guard(latch_);
+  SubmitLocked();
+}
+
+std::future<bool> IOUringEngine::Queue(bool is_read, int fd, char *data,
+                                       size_t size, size_t offset) {
+  Request *request = new Request;
+  request->iov.iov_base = data;
+  request->iov.iov_len = size;
+  request->offset = offset;
+  request->is_read = is_read;
+  std::future<bool> result = request->done.get_future();
+
+  std::unique_lock<std::mutex> lock(latch_);
+  while (num_in_flight_ >= queue_depth_) {
+    // our own queued requests may be the ones in the way
+    SubmitLocked();
+    cv_.wait(lock);
+  }
+  ++num_in_flight_;
+  PushLocked(is_read ? IORING_OP_READV : IORING_OP_WRITEV, fd, request);
+  return result;
+}
+
+void IOUringEngine::PushLocked(uint8_t opcode, int fd, Request *request) {
+  unsigned tail = *sq_tail_;
+  unsigned index = tail & *sq_mask_;
+  struct io_uring_sqe *sqe = static_cast<struct io_uring_sqe *>(sqes_) + index;
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->user_data = reinterpret_cast<uint64_t>(request);
+  if (request != nullptr) {
+    sqe->off = request->offset;
+    sqe->addr = reinterpret_cast<uint64_t>(&request->iov);
+    sqe->len = 1;
+  }
+  sq_array_[index] = index;
+  // publish the entry before the kernel can see the new tail
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+  ++num_queued_;
+}
+
+void IOUringEngine::SubmitLocked() {
+  while (num_queued_ > 0) {
+    int rc = IOUringEnter(ring_fd_, num_queued_, 0, 0);
+    if (rc < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EBUSY) continue;
+      throw Exception(EXCEPTION_TYPE_INVALID,
+                      std::string("io_uring_enter: ") + strerror(errno));
+    }
+    num_queued_ -= rc;
+  }
+}
+
+/*
+ * Wait for completions and complete their futures, until the stop request.
+ * Completions are handled under latch_, the request was queued under it.
+ */
+void IOUringEngine::ReapLoop() {
+  bool stopped = false;
+  while (!stopped) {
+    if (IOUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+        errno != EINTR) {
+      LOG_DEBUG("io_uring_enter failed while waiting");
+    }
+    std::lock_guard<std::mutex> guard(latch_);
+    unsigned head = *cq_head_;
+    unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+      struct io_uring_cqe *cqe =
+          static_cast<struct io_uring_cqe *>(cqes_) + (head & *cq_mask_);
+      Request *request = reinterpret_cast<Request *>(cqe->user_data);
+      if (request == nullptr) {
+        stopped = true;
+        continue;
+      }
+      int res = cqe->res;
+      size_t size = request->iov.iov_len;
+      bool ok;
+      if (res < 0) {
+        ok = false;
+      } else if (request->is_read) {
+        // may stop short at the end of the file
+        ok = true;
+        memset(static_cast<char *>(request->iov.iov_base) + res, 0, size - res);
+      } else {
+        ok = static_cast<size_t>(res) == size;
+        if (ok && on_write_done_) on_write_done_();
+      }
+      request->done.set_value(ok);
+      delete request;
+      --num_in_flight_;
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    cv_.notify_all();
+  }
+}
+
+void IOUringEngine::Unmap() {
+  if (sqes_ != MAP_FAILED) munmap(sqes_, sqes_size_);
+  if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != MAP_FAILED) munmap(sq_ring_, sq_ring_size_);
+}
+
+#else
+
+bool IOUringEngine::IsSupported() { return false; }
+
+IOUringEngine::IOUringEngine(size_t queue_depth) : queue_depth_(queue_depth) {
+  throw Exception(EXCEPTION_TYPE_NOT_IMPLEMENTED, "io_uring not available");
+}
+
+IOUringEngine::~IOUringEngine() {}
+
+std::future<bool> IOUringEngine::Read(int, char *, size_t, size_t) {
+  return std::future<bool>();
+}
+
+std::future<bool> IOUringEngine::Write(int, const char *, size_t, size_t) {
+  return std::future<bool>();
+}
+
+void IOUringEngine::Submit() {}
+
+#endif
+
+/*****************************************************************************
+ * THREAD POOL
+ *****************************************************************************/
+ThreadPoolIOEngine::ThreadPoolIOEngine(size_t num_workers, size_t queue_depth)
+    : queue_depth_(queue_depth), num_in_flight_(0), workers_(num_workers) {}
+
+ThreadPoolIOEngine::~ThreadPoolIOEngine() {
+  std::unique_lock<std::mutex> lock(latch_);
+  SubmitLocked();
+  cv_.wait(lock, [this] { return num_in_flight_ == 0; });
+}
+
+std::future<bool> ThreadPoolIOEngine::Read(int fd, char *data, size_t size,
+                                           size_t offset) {
+  return Queue([=] { return ReadFully(fd, data, size, offset); });
+}
+
+std::future<bool> ThreadPoolIOEngine::Write(int fd, const char *data,
+                                            size_t size, size_t offset) {
+  return Queue([=] {
+    bool ok = WriteFully(fd, data, size, offset);
+    if (ok && on_write_done_) on_write_done_();
+    return ok;
+  });
+}
+
+void ThreadPoolIOEngine::Submit() {
+  std::lock_guard<std::mutex> guard(latch_);
+  SubmitLocked();
+}
+
+std::future<bool> ThreadPoolIOEngine::Queue(std::function<bool()> io) {
+  auto done = std::make_shared<std::promise<bool>>();
+  std::future<bool> result = done->get_future();
+  std::unique_lock<std::mutex> lock(latch_);
+  while (num_in_flight_ >= queue_depth_) {
+    SubmitLocked();
+    cv_.wait(lock);
+  }
+  ++num_in_flight_;
+  queued_.push_back([this, io, done] {
+    done->set_value(io());
+    std::lock_guard<std::mutex> guard(latch_);
+    --num_in_flight_;
+    cv_.notify_all();
+  });
+  return result;
+}
+
+void ThreadPoolIOEngine::SubmitLocked() {
+  for (auto &task : queued_) {
+    workers_.Submit(std::move(task));
+  }
+  queued_.clear();
+}
+
+} // namespace cmudb
@@ -1,113 +1,355 @@
 /**
  * disk_manager.cpp
  */
+#include <algorithm>
 #include <assert.h>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
 #include <cstring>
+#include <fcntl.h>
 #include <iostream>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <thread>
+#include <unistd.h>
+#include <vector>
 
+#include "common/exception.h"
 #include "common/logger.h"
 #include "disk/disk_manager.h"
+#include "page/header_page.h"
 
 namespace cmudb {
 
-static char *buffer_used = nullptr;
-
 /**
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
+ * @input page_size: page size used if the file is new or does not record one
+ * @input direct_io: read and write pages with O_DIRECT
  */
-DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), next_page_id_(0), num_flushes_(0), flush_log_(false),
+DiskManager::DiskManager(const std::string &db_file, size_t page_size,
+                         bool direct_io)
+    : log_(nullptr), db_fd_(-1), file_name_(db_file), page_size_(page_size),
+      direct_io_(false), db_file_size_(0), free_space_map_(nullptr),
+      durability_mode_(DurabilityMode::NONE),
+      sync_interval_(DURABILITY_SYNC_INTERVAL),
+      sync_pages_(DURABILITY_SYNC_PAGES), pages_written_(0), pages_synced_(0),
+      num_syncs_(0), num_flushes_(0), flush_log_(false),
       flush_log_f_(nullptr) {
+  if (!IsValidPageSize(page_size_)) {
+    throw Exception(EXCEPTION_TYPE_OUT_OF_RANGE, "invalid page size");
+  }
   std::string::size_type n = file_name_.find(".");
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
     return;
   }
   log_name_ = file_name_.substr(0, n) + ".log";
+  master_name_ = file_name_.substr(0, n) + ".master";
+
+  log_ = new SegmentedLog(log_name_);
 
-  log_io_.open(log_name_,
-               std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-  // directory or file does not exist
-  if (!log_io_.is_open()) {
-    log_io_.clear();
-    // create a new file
-    log_io_.open(log_name_, std::ios::binary | std::ios::trunc | std::ios::app |
-                                std::ios::out);
-    log_io_.close();
-    // reopen with original mode
-    log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app |
-                                std::ios::out);
-  }
-
-  db_io_.open(db_file,
-              std::ios::binary | std::ios::in | std::ios::out | std::ios::out);
-  // directory or file does not exist
-  if (!db_io_.is_open()) {
-    db_io_.clear();
-    // create a new file
-    db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out);
-    db_io_.close();
-    // reopen with original mode
-    db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
+  // create the file if it does not exist
+  db_fd_ = open(db_file.c_str(), O_RDWR | O_CREAT, 0644);
+  if (db_fd_ < 0) {
+    throw Exception(EXCEPTION_TYPE_INVALID,
+                    "can not open " + db_file + ": " + strerror(errno));
+  }
+  struct stat stat_buf;
+  if (fstat(db_fd_, &stat_buf) == 0) {
+    db_file_size_ = stat_buf.st_size;
   }
+
+  // read before O_DIRECT is on, the header is shorter than a block
+  size_t recorded_page_size = ReadRecordedPageSize();
+  if (IsValidPageSize(recorded_page_size) ||
+      recorded_page_size == OLD_FORMAT_PAGE_SIZE) {
+    page_size_ = recorded_page_size;
+  }
+  // the pages of an older file are too small for O_DIRECT
+  if (direct_io && page_size_ % DIRECT_IO_ALIGNMENT == 0) {
+    EnableDirectIO();
+  }
+  free_space_map_ = new FreeSpaceMap(file_name_.substr(0, n) + ".fsm",
+                                     page_size_, GetNumPages());
 }
 
 DiskManager::~DiskManager() {
-  db_io_.close();
-  log_io_.close();
+  // waits for the asynchronous requests in flight
+  delete async_io_;
+  // the last batch
+  StopSyncThread();
+  delete free_space_map_;
+  if (db_fd_ >= 0) {
+    close(db_fd_);
+  }
+  delete log_;
 }
 
 /**
  * Write the contents of the specified page into disk file
  */
 void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
-  size_t offset = page_id * PAGE_SIZE;
-  // set write cursor to offset
-  db_io_.seekp(offset);
-  db_io_.write(page_data, PAGE_SIZE);
-  // check for I/O error
-  if (db_io_.bad()) {
-    LOG_DEBUG("I/O error while writing");
-    return;
+  if (WritePageData(page_id, page_data)) PagesWritten(1);
+}
+
+/**
+ * Private helper function to write one page, without syncing it
+ * @return: false on I/O error
+ */
+bool DiskManager::WritePageData(page_id_t page_id, const char *page_data) {
+  size_t offset = static_cast<size_t>(page_id) * page_size_;
+  char *bounce = nullptr;
+  if (NeedsBounce(page_data)) {
+    bounce = AllocateAligned(page_size_);
+    memcpy(bounce, page_data, page_size_);
+    page_data = bounce;
+  }
+  size_t written = 0;
+  while (written < page_size_) {
+    ssize_t rc = pwrite(db_fd_, page_data + written, page_size_ - written,
+                        offset + written);
+    if (rc < 0 && errno == EINTR) continue;
+    // check for I/O error
+    if (rc <= 0) {
+      LOG_DEBUG("I/O error while writing");
+      break;
+    }
+    written += rc;
+  }
+  FreeAligned(bounce);
+  ExtendFileSize(offset + written);
+  return written == page_size_;
+}
+
+/**
+ * Write num_pages consecutive pages starting at page_id, the content of the
+ * i-th page is in page_data[i]. The pages go out in as few vectored writes
+ * as IOV_MAX allows. With O_DIRECT a run holding an unaligned buffer is
+ * written page by page instead.
+ * @return: false on I/O error
+ */
+bool DiskManager::WritePages(page_id_t page_id, size_t num_pages,
+                             const char *const *page_data) {
+  for (size_t i = 0; i < num_pages; ++i) {
+    if (NeedsBounce(page_data[i])) {
+      bool ok = true;
+      for (size_t j = 0; j < num_pages; ++j) {
+        ok = WritePageData(page_id + j, page_data[j]) && ok;
+      }
+      PagesWritten(num_pages);
+      return ok;
+    }
+  }
+  size_t offset = static_cast<size_t>(page_id) * page_size_;
+  std::vector<struct iovec> iov(std::min<size_t>(num_pages, IOV_MAX));
+  size_t done = 0;
+  while (done < num_pages) {
+    size_t count = std::min(num_pages - done, iov.size());
+    for (size_t i = 0; i < count; ++i) {
+      iov[i].iov_base = const_cast<char *>(page_data[done + i]);
+      iov[i].iov_len = page_size_;
+    }
+    // a short write leaves part of a page behind, finish it page by page
+    ssize_t rc;
+    do {
+      rc = pwritev(db_fd_, iov.data(), count, offset + done * page_size_);
+    } while (rc < 0 && errno == EINTR);
+    if (rc < 0) {
+      LOG_DEBUG("I/O error while writing");
+      ExtendFileSize(offset + done * page_size_);
+      return false;
+    }
+    size_t written = rc / page_size_;
+    if (written < count) {
+      if (!WritePageData(page_id + done + written, page_data[done + written])) {
+        return false;
+      }
+      ++written;
+    }
+    done += written;
   }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
+  ExtendFileSize(offset + num_pages * page_size_);
+  PagesWritten(num_pages);
+  return true;
 }
 
 /**
  * Read the contents of the specified page into the given memory area
  */
 void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
-  int offset = page_id * PAGE_SIZE;
+  ReadPages(page_id, 1, page_data);
+}
+
+/**
+ * Read num_pages consecutive pages starting at page_id with a single read,
+ * page_data must hold num_pages pages. Pages past the end of the file read
+ * as zeros.
+ */
+void DiskManager::ReadPages(page_id_t page_id, size_t num_pages,
+                            char *page_data) {
+  size_t offset = static_cast<size_t>(page_id) * page_size_;
+  size_t size = num_pages * page_size_;
   // check if read beyond file length
-  if (offset > GetFileSize(file_name_)) {
+  if (offset > db_file_size_.load()) {
     LOG_DEBUG("I/O error while reading");
-    // std::cerr << "I/O error while reading" << std::endl;
-  } else {
-    // set read cursor to offset
-    db_io_.seekp(offset);
-    db_io_.read(page_data, PAGE_SIZE);
-    // if file ends before reading PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < PAGE_SIZE) {
-      LOG_DEBUG("Read less than a page");
-      // std::cerr << "Read less than a page" << std::endl;
-      memset(page_data + read_count, 0, PAGE_SIZE - read_count);
+    memset(page_data, 0, size);
+    return;
+  }
+  char *target = NeedsBounce(page_data) ? AllocateAligned(size) : page_data;
+  size_t read_count = 0;
+  while (read_count < size) {
+    ssize_t rc = pread(db_fd_, target + read_count, size - read_count,
+                       offset + read_count);
+    if (rc < 0 && errno == EINTR) continue;
+    if (rc < 0) {
+      LOG_DEBUG("I/O error while reading");
+      break;
     }
+    // end of file
+    if (rc == 0) break;
+    read_count += rc;
+  }
+  if (target != page_data) {
+    memcpy(page_data, target, read_count);
+    FreeAligned(target);
   }
+  // if file ends before reading all the pages
+  if (read_count < size) {
+    LOG_DEBUG("Read less than a page");
+    memset(page_data + read_count, 0, size - read_count);
+  }
+}
+
+/**
+ * Queue an asynchronous read of the specified page. With O_DIRECT an
+ * unaligned buffer is read synchronously instead, a bounce buffer would have
+ * to outlive the call.
+ */
+std::future<bool> DiskManager::ReadPageAsync(page_id_t page_id,
+                                             char *page_data, bool submit) {
+  if (NeedsBounce(page_data)) {
+    ReadPage(page_id, page_data);
+    std::promise<bool> done;
+    done.set_value(true);
+    return done.get_future();
+  }
+  size_t offset = static_cast<size_t>(page_id) * page_size_;
+  AsyncIOEngine &async_io = GetAsyncIO();
+  std::future<bool> result =
+      async_io.Read(db_fd_, page_data, page_size_, offset);
+  if (submit) async_io.Submit();
+  return result;
+}
+
+/**
+ * Queue an asynchronous write of the specified page. The file counts the
+ * page from now on, a read that overtakes the write sees zeros. In SYNC
+ * mode the page is written and synced before returning.
+ */
+std::future<bool> DiskManager::WritePageAsync(page_id_t page_id,
+                                              const char *page_data,
+                                              bool submit) {
+  if (NeedsBounce(page_data) || durability_mode_ == DurabilityMode::SYNC) {
+    WritePage(page_id, page_data);
+    std::promise<bool> done;
+    done.set_value(true);
+    return done.get_future();
+  }
+  size_t offset = static_cast<size_t>(page_id) * page_size_;
+  AsyncIOEngine &async_io = GetAsyncIO();
+  std::future<bool> result =
+      async_io.Write(db_fd_, page_data, page_size_, offset);
+  ExtendFileSize(offset + page_size_);
+  if (submit) async_io.Submit();
+  return result;
+}
+
+/**
+ * Submit the asynchronous requests queued with submit = false
+ */
+void DiskManager::SubmitAsyncIO() { GetAsyncIO().Submit(); }
+
+AsyncIOEngine &DiskManager::GetAsyncIO() {
+  std::call_once(async_io_started_, [this] {
+    async_io_ = AsyncIOEngine::Create();
+    async_io_->OnWriteDone([this] { PagesWritten(1); });
+  });
+  return *async_io_;
+}
+
+/**
+ * Choose when page writes reach the disk. Leaving BATCHED syncs the writes
+ * of the last batch.
+ */
+void DiskManager::SetDurabilityMode(DurabilityMode mode,
+                                    std::chrono::milliseconds interval,
+                                    size_t sync_pages) {
+  StopSyncThread();
+  sync_interval_ = interval;
+  sync_pages_ = std::max<size_t>(1, sync_pages);
+  durability_mode_ = mode;
+  if (mode == DurabilityMode::BATCHED) {
+    StartSyncThread();
+  } else if (mode == DurabilityMode::SYNC && pages_written_ != pages_synced_) {
+    Sync();
+  }
+}
+
+/**
+ * fdatasync the db file, every page write completed before the call is
+ * durable when it returns
+ * @return: false on I/O error
+ */
+bool DiskManager::Sync() {
+  uint64_t written = pages_written_;
+  if (fdatasync(db_fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing");
+    return false;
+  }
+  ++num_syncs_;
+  uint64_t synced = pages_synced_;
+  while (written > synced &&
+         !pages_synced_.compare_exchange_weak(synced, written)) {
+  }
+  return true;
+}
+
+const char *DiskManager::GetDurabilityModeName(DurabilityMode mode) {
+  switch (mode) {
+  case DurabilityMode::BATCHED:
+    return "batched";
+  case DurabilityMode::SYNC:
+    return "sync";
+  case DurabilityMode::NONE:
+  default:
+    return "none";
+  }
+}
+
+bool DiskManager::ParseDurabilityMode(const std::string &name,
+                                      DurabilityMode &mode) {
+  for (DurabilityMode candidate : {DurabilityMode::NONE,
+                                   DurabilityMode::BATCHED,
+                                   DurabilityMode::SYNC}) {
+    if (name == GetDurabilityModeName(candidate)) {
+      mode = candidate;
+      return true;
+    }
+  }
+  return false;
 }
 
 /**
  * Write the contents of the log into disk file
  * Only return when sync is done, and only perform sequence write
+ * The log is always synced, whatever the durability mode of the pages.
  */
 void DiskManager::WriteLog(char *log_data, int size) {
   // enforce swap log buffer
-  assert(log_data != buffer_used);
-  buffer_used = log_data;
+  assert(log_data != last_log_data_);
+  last_log_data_ = log_data;
 
   if (size == 0) // no effect on num_flushes_ if log buffer is empty
     return;
@@ -120,16 +362,11 @@ void DiskManager::WriteLog(char *log_data, int size) {
            std::future_status::ready);
 
   num_flushes_ += 1;
-  // sequence write
-  log_io_.write(log_data, size);
-
-  // check for I/O error
-  if (log_io_.bad()) {
+  // sequence write, synced to keep disk file in sync
+  if (log_ == nullptr || !log_->Append(log_data, size)) {
     LOG_DEBUG("I/O error while writing log");
     return;
   }
-  // needs to flush to keep disk file in sync
-  log_io_.flush();
   flush_log_ = false;
 }
 
@@ -138,36 +375,94 @@ void DiskManager::WriteLog(char *log_data, int size) {
  * Always read from the beginning and perform sequence read
  * @return: false means already reach the end
  */
-bool DiskManager::ReadLog(char *log_data, int size, int offset) {
-  if (offset >= GetFileSize(log_name_)) {
-    // LOG_DEBUG("end of log file");
-    // LOG_DEBUG("file size is %d", GetFileSize(log_name_));
+bool DiskManager::ReadLog(char *log_data, int size, size_t offset) {
+  // if log file ends before reading "size", the rest is zeros
+  return log_ != nullptr && log_->Read(log_data, size, offset);
+}
+
+size_t DiskManager::GetLogSize() {
+  return log_ == nullptr ? 0 : log_->GetEnd();
+}
+
+/**
+ * The log before offset is not needed by recovery any more, the segments
+ * holding only such log are recycled
+ */
+void DiskManager::TruncateLog(size_t offset) {
+  if (log_ != nullptr) log_->Truncate(offset);
+}
+
+size_t DiskManager::GetNextLogRun(size_t offset) {
+  return log_ == nullptr ? 0 : log_->GetNextRun(offset);
+}
+
+// layout of the master record
+struct MasterRecord {
+  uint32_t magic;
+  lsn_t checkpoint_lsn;
+  uint64_t offset;
+};
+static const uint32_t MASTER_RECORD_MAGIC = 0x4d535452;
+
+/**
+ * Overwrite the master record in place, it is smaller than a sector so a
+ * crash leaves either the old or the new one
+ */
+bool DiskManager::WriteMasterRecord(lsn_t checkpoint_lsn, size_t offset) {
+  MasterRecord record{MASTER_RECORD_MAGIC, checkpoint_lsn, offset};
+  int fd = open(master_name_.c_str(), O_WRONLY | O_CREAT, 0644);
+  if (fd < 0) {
+    LOG_DEBUG("can not open master record");
     return false;
   }
-  log_io_.seekp(offset);
-  log_io_.read(log_data, size);
-  // if log file ends before reading "size"
-  int read_count = log_io_.gcount();
-  if (read_count < size) {
-    log_io_.clear();
-    memset(log_data + read_count, 0, size - read_count);
+  bool written =
+      pwrite(fd, &record, sizeof(record), 0) ==
+          static_cast<ssize_t>(sizeof(record)) &&
+      fdatasync(fd) == 0;
+  if (!written) {
+    LOG_DEBUG("I/O error while writing master record");
   }
+  close(fd);
+  return written;
+}
 
+bool DiskManager::ReadMasterRecord(lsn_t &checkpoint_lsn, size_t &offset) {
+  MasterRecord record;
+  int fd = open(master_name_.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  bool read_ok = pread(fd, &record, sizeof(record), 0) ==
+                     static_cast<ssize_t>(sizeof(record)) &&
+                 record.magic == MASTER_RECORD_MAGIC;
+  close(fd);
+  if (!read_ok) return false;
+  checkpoint_lsn = record.checkpoint_lsn;
+  offset = record.offset;
   return true;
 }
 
 /**
  * Allocate new page (operations like create index/table)
- * For now just keep an increasing counter
+ * A deallocated page is reused first, preferably close to hint, otherwise
+ * the file grows by a page
  */
-page_id_t DiskManager::AllocatePage() { return next_page_id_++; }
+page_id_t DiskManager::AllocatePage(page_id_t hint) {
+  if (free_space_map_ == nullptr) return INVALID_PAGE_ID;
+  return free_space_map_->Allocate(hint);
+}
 
 /**
  * Deallocate page (operations like drop index/table)
- * Need bitmap in header page for tracking pages
+ * The page can be handed out again by AllocatePage, its content on disk is
+ * left as is
  */
-void DiskManager::DeallocatePage(__attribute__((unused)) page_id_t page_id) {
-  return;
+void DiskManager::DeallocatePage(page_id_t page_id) {
+  if (free_space_map_ == nullptr || !free_space_map_->Free(page_id)) {
+    LOG_DEBUG("deallocating a page that is not allocated");
+  }
+}
+
+size_t DiskManager::GetNumFreePages() {
+  return free_space_map_ == nullptr ? 0 : free_space_map_->GetNumFreePages();
 }
 
 /**
@@ -180,10 +475,141 @@ int DiskManager::GetNumFlushes() const { return num_flushes_; }
  */
 bool DiskManager::GetFlushState() const { return flush_log_; }
 
+bool DiskManager::IsValidPageSize(size_t page_size) {
+  return page_size >= MIN_PAGE_SIZE && page_size <= MAX_PAGE_SIZE &&
+         (page_size & (page_size - 1)) == 0;
+}
+
+char *DiskManager::AllocateAligned(size_t size) {
+  void *data = nullptr;
+  if (posix_memalign(&data, DIRECT_IO_ALIGNMENT, size) != 0) {
+    throw std::bad_alloc();
+  }
+  memset(data, 0, size);
+  return static_cast<char *>(data);
+}
+
+void DiskManager::FreeAligned(char *data) { free(data); }
+
+/**
+ * Private helper function to read the page size recorded in the header page
+ * of an existing file. A header page of the older format that did not
+ * record it means OLD_FORMAT_PAGE_SIZE pages. 0 if the file is too short to
+ * have a header page or page 0 is not one
+ */
+size_t DiskManager::ReadRecordedPageSize() {
+  char header[OLD_FORMAT_PAGE_SIZE];
+  ssize_t rc = pread(db_fd_, header, sizeof(header), 0);
+  if (rc < HEADER_PAGE_PREFIX_SIZE) return 0;
+  if (rc == sizeof(header) && HeaderPage::IsOlderFormat(header)) {
+    return OLD_FORMAT_PAGE_SIZE;
+  }
+  return HeaderPage::ReadPageSize(header);
+}
+
+/**
+ * Private helper function to turn on O_DIRECT, page_size_ is known by now
+ * and is a multiple of DIRECT_IO_ALIGNMENT. Some file systems (tmpfs) refuse
+ * it, the file then stays buffered.
+ */
+void DiskManager::EnableDirectIO() {
+#ifdef O_DIRECT
+  int flags = fcntl(db_fd_, F_GETFL);
+  if (flags >= 0 && fcntl(db_fd_, F_SETFL, flags | O_DIRECT) == 0) {
+    direct_io_ = true;
+    return;
+  }
+#endif
+  LOG_DEBUG("O_DIRECT not supported, using buffered I/O");
+}
+
+/**
+ * Private helper function, O_DIRECT transfers need an aligned buffer
+ */
+bool DiskManager::NeedsBounce(const char *data) const {
+  return direct_io_ &&
+         reinterpret_cast<uintptr_t>(data) % DIRECT_IO_ALIGNMENT != 0;
+}
+
+/**
+ * Private helper function to remember how far the file reaches, without
+ * asking the file system
+ */
+void DiskManager::ExtendFileSize(size_t end) {
+  size_t file_size = db_file_size_.load();
+  while (end > file_size &&
+         !db_file_size_.compare_exchange_weak(file_size, end)) {
+  }
+}
+
+/**
+ * Private helper function to account for completed page writes: in SYNC
+ * mode they are synced right away, in BATCHED mode the sync thread is woken
+ * once sync_pages of them wait for a sync
+ */
+void DiskManager::PagesWritten(size_t num_pages) {
+  uint64_t written = pages_written_ += num_pages;
+  switch (durability_mode_.load()) {
+  case DurabilityMode::SYNC:
+    Sync();
+    break;
+  case DurabilityMode::BATCHED:
+    if (written - pages_synced_ >= sync_pages_) sync_cv_.notify_one();
+    break;
+  case DurabilityMode::NONE:
+  default:
+    break;
+  }
+}
+
+/**
+ * Private helper function to start the sync thread of BATCHED mode. It
+ * sleeps for the sync interval, or until enough writes piled up, and syncs
+ * if anything was written since the last sync.
+ */
+void DiskManager::StartSyncThread() {
+  std::lock_guard<std::mutex> guard(sync_latch_);
+  sync_running_ = true;
+  sync_thread_ = new std::thread([this] {
+    std::unique_lock<std::mutex> lock(sync_latch_);
+    while (sync_running_) {
+      sync_cv_.wait_for(lock, sync_interval_, [this] {
+        return !sync_running_ || pages_written_ - pages_synced_ >= sync_pages_;
+      });
+      if (pages_written_ == pages_synced_) continue;
+      lock.unlock();
+      Sync();
+      lock.lock();
+    }
+  });
+}
+
+/**
+ * Private helper function to stop the sync thread, the writes it has not
+ * synced yet are synced before returning
+ */
+void DiskManager::StopSyncThread() {
+  {
+    std::lock_guard<std::mutex> guard(sync_latch_);
+    if (!sync_running_) return;
+    sync_running_ = false;
+  }
+  sync_cv_.notify_all();
+  sync_thread_->join();
+  delete sync_thread_;
+  sync_thread_ = nullptr;
+  if (pages_written_ != pages_synced_) Sync();
+}
+
+/**
+ * Number of whole pages in the database file
+ */
+size_t DiskManager::GetNumPages() { return db_file_size_.load() / page_size_; }
+
 /**
  * Private helper function to get disk file size
  */
-int DiskManager::GetFileSize(const std::string &file_name) {
+ssize_t DiskManager::GetFileSize(const std::string &file_name) {
   struct stat stat_buf;
   int rc = stat(file_name.c_str(), &stat_buf);
   return rc == 0 ? stat_buf.st_size : -1;
@@ -0,0 +1,219 @@
+/**
+ * free_space_map.cpp
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "disk/free_space_map.h"
+
+namespace cmudb {
+
+// first word of the meta page
+#define FREE_SPACE_MAP_MAGIC 0x4d505346
+
+FreeSpaceMap::FreeSpaceMap(const std::string &file_name, size_t page_size,
+                           size_t num_file_pages)
+    : page_size_(page_size), words_per_page_(page_size / sizeof(uint64_t)),
+      high_water_mark_(0), num_free_(0) {
+  fd_ = open(file_name.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd_ < 0) {
+    throw Exception(EXCEPTION_TYPE_INVALID,
+                    "can not open " + file_name + ": " + strerror(errno));
+  }
+  Load(num_file_pages);
+}
+
+FreeSpaceMap::~FreeSpaceMap() { close(fd_); }
+
+/*
+ * Allocate a free page, or extend the high water mark if there is none.
+ * The bitmap page (and the meta page if the mark moved) is written before
+ * the id is returned.
+ */
+page_id_t FreeSpaceMap::Allocate(page_id_t hint) {
+  std::lock_guard<std::mutex> guard(latch_);
+  page_id_t page_id = FindFree(hint);
+  if (page_id != INVALID_PAGE_ID) {
+    --num_free_;
+  } else {
+    page_id = high_water_mark_++;
+    Grow(high_water_mark_);
+  }
+  FlipBit(page_id);
+  WriteBitmapPage(page_id);
+  if (page_id + 1 == high_water_mark_) WriteMetaPage();
+  return page_id;
+}
+
+bool FreeSpaceMap::Free(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (page_id < 0 || page_id >= high_water_mark_ || !TestBit(page_id)) {
+    return false;
+  }
+  FlipBit(page_id);
+  ++num_free_;
+  WriteBitmapPage(page_id);
+  return true;
+}
+
+bool FreeSpaceMap::IsAllocated(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  return page_id >= 0 && page_id < high_water_mark_ && TestBit(page_id);
+}
+
+page_id_t FreeSpaceMap::GetHighWaterMark() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return high_water_mark_;
+}
+
+size_t FreeSpaceMap::GetNumFreePages() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return num_free_;
+}
+
+/*
+ * Search words of 64 pages outwards from the word of hint, taking the free
+ * page closest to hint, the lowest free page without hint.
+ * Caller holds latch_
+ * @return: INVALID_PAGE_ID if every page below the high water mark is used
+ */
+page_id_t FreeSpaceMap::FindFree(page_id_t hint) const {
+  if (num_free_ == 0) return INVALID_PAGE_ID;
+  if (hint < 0 || hint >= high_water_mark_) hint = 0;
+  long num_words = (high_water_mark_ + 63) / 64;
+  long start = hint / 64;
+  // bits past the mark are never set, mask them out of the last word
+  auto free_bits = [this, num_words](long word) {
+    uint64_t bits = ~bits_[word];
+    if (word == num_words - 1 && high_water_mark_ % 64 != 0) {
+      bits &= (uint64_t(1) << (high_water_mark_ % 64)) - 1;
+    }
+    return bits;
+  };
+
+  uint64_t bits = free_bits(start);
+  if (bits != 0) {
+    int offset = hint % 64;
+    uint64_t above = bits & (~uint64_t(0) << offset);
+    uint64_t below = bits & ~above;
+    int up = above ? __builtin_ctzll(above) : 64;
+    int down = below ? 63 - __builtin_clzll(below) : -64;
+    return start * 64 + (up - offset <= offset - down ? up : down);
+  }
+  for (long distance = 1; distance < num_words; ++distance) {
+    if (start + distance < num_words && (bits = free_bits(start + distance))) {
+      return (start + distance) * 64 + __builtin_ctzll(bits);
+    }
+    if (start - distance >= 0 && (bits = free_bits(start - distance))) {
+      return (start - distance) * 64 + 63 - __builtin_clzll(bits);
+    }
+  }
+  return INVALID_PAGE_ID;
+}
+
+/*
+ * Read the map back. Pages of the database file beyond the recorded high
+ * water mark (a map from an older file, or none at all) are counted as
+ * allocated, and the map is rewritten.
+ */
+void FreeSpaceMap::Load(size_t num_file_pages) {
+  std::vector<char> meta(page_size_, 0);
+  bool valid = false;
+  if (num_file_pages > 0 &&
+      pread(fd_, meta.data(), page_size_, 0) == static_cast<ssize_t>(page_size_)) {
+    uint32_t header[3];
+    memcpy(header, meta.data(), sizeof(header));
+    if (header[0] == FREE_SPACE_MAP_MAGIC && header[1] == page_size_) {
+      high_water_mark_ = header[2];
+      valid = true;
+    }
+  }
+
+  if (valid) {
+    Grow(high_water_mark_);
+    size_t size = bits_.size() * sizeof(uint64_t);
+    ssize_t rc = pread(fd_, bits_.data(), size, page_size_);
+    if (rc != static_cast<ssize_t>(size)) {
+      LOG_DEBUG("free space map is short, pages count as allocated");
+      std::fill(bits_.begin(), bits_.end(), ~uint64_t(0));
+    }
+  } else {
+    high_water_mark_ = 0;
+    if (ftruncate(fd_, 0) != 0) {
+      LOG_DEBUG("can not truncate free space map");
+    }
+  }
+
+  bool rewrite = !valid;
+  if (static_cast<size_t>(high_water_mark_) < num_file_pages) {
+    Grow(num_file_pages);
+    for (size_t page_id = high_water_mark_; page_id < num_file_pages; ++page_id) {
+      if (!TestBit(page_id)) FlipBit(page_id);
+    }
+    high_water_mark_ = num_file_pages;
+    rewrite = true;
+  }
+  // bits past the mark are meaningless, clear them
+  for (size_t bit = high_water_mark_; bit < bits_.size() * 64; ++bit) {
+    if (TestBit(bit)) FlipBit(bit);
+  }
+  num_free_ = 0;
+  for (page_id_t page_id = 0; page_id < high_water_mark_; ++page_id) {
+    if (!TestBit(page_id)) ++num_free_;
+  }
+
+  if (rewrite) {
+    for (size_t bit = 0; bit < bits_.size() * 64; bit += words_per_page_ * 64) {
+      WriteBitmapPage(bit);
+    }
+    WriteMetaPage();
+  }
+}
+
+/*
+ * Make room for num_pages bits, in whole bitmap pages
+ */
+void FreeSpaceMap::Grow(size_t num_pages) {
+  size_t bits_per_page = words_per_page_ * 64;
+  size_t num_bitmap_pages = (num_pages + bits_per_page - 1) / bits_per_page;
+  if (bits_.size() < num_bitmap_pages * words_per_page_) {
+    bits_.resize(num_bitmap_pages * words_per_page_, 0);
+  }
+}
+
+/*
+ * Write the bitmap page holding bit, bitmap pages follow the meta page
+ */
+void FreeSpaceMap::WriteBitmapPage(size_t bit) {
+  size_t index = bit / (words_per_page_ * 64);
+  WriteFully(reinterpret_cast<const char *>(&bits_[index * words_per_page_]),
+             page_size_, (index + 1) * page_size_);
+}
+
+void FreeSpaceMap::WriteMetaPage() {
+  std::vector<char> meta(page_size_, 0);
+  uint32_t header[3] = {FREE_SPACE_MAP_MAGIC, static_cast<uint32_t>(page_size_),
+                        static_cast<uint32_t>(high_water_mark_)};
+  memcpy(meta.data(), header, sizeof(header));
+  WriteFully(meta.data(), page_size_, 0);
+}
+
+void FreeSpaceMap::WriteFully(const char *data, size_t size, size_t offset) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t rc = pwrite(fd_, data + done, size - done, offset + done);
+    if (rc < 0 && errno == EINTR) continue;
+    if (rc <= 0) {
+      LOG_DEBUG("I/O error while writing free space map");
+      return;
+    }
+    done += rc;
+  }
+}
+
+} // namespace cmudb
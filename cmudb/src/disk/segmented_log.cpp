@@ -0,0 +1,423 @@
+/**
+ * segmented_log.cpp
+ */
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "disk/segmented_log.h"
+
+namespace cmudb {
+
+// first word of the control file
+#define SEGMENTED_LOG_MAGIC 0x474f4c53
+// zeros after the end of the log, more than the size field of a log record
+#define SEGMENTED_LOG_END_MARK 8
+// zeros written at once when a new segment is allocated
+#define SEGMENTED_LOG_ZERO_CHUNK (1 << 20)
+
+static bool WriteFully(int fd, const char *data, size_t size, size_t offset) {
+  size_t written = 0;
+  while (written < size) {
+    ssize_t rc = pwrite(fd, data + written, size - written, offset + written);
+    if (rc < 0 && errno == EINTR) continue;
+    if (rc <= 0) return false;
+    written += rc;
+  }
+  return true;
+}
+
+/*
+ * Write size bytes of data at offset and mark zeros right after them with a
+ * single pwritev, so that the data does not reach the file without the end
+ * mark after it. A short write is completed with pwrite.
+ */
+static bool WriteWithEndMark(int fd, const char *data, size_t size,
+                             size_t mark, size_t offset) {
+  static const char zeros[SEGMENTED_LOG_END_MARK] = {};
+  struct iovec iov[2] = {{const_cast<char *>(data), size},
+                         {const_cast<char *>(zeros), mark}};
+  ssize_t rc;
+  do {
+    rc = pwritev(fd, iov, 2, offset);
+  } while (rc < 0 && errno == EINTR);
+  if (rc < 0) return false;
+  size_t written = rc;
+  if (written < size) {
+    return WriteFully(fd, data + written, size - written, offset + written) &&
+           WriteFully(fd, zeros, mark, offset + size);
+  }
+  return WriteFully(fd, zeros + (written - size), size + mark - written,
+                    offset + written);
+}
+
+static size_t ReadFully(int fd, char *data, size_t size, size_t offset) {
+  size_t read_count = 0;
+  while (read_count < size) {
+    ssize_t rc = pread(fd, data + read_count, size - read_count,
+                       offset + read_count);
+    if (rc < 0 && errno == EINTR) continue;
+    if (rc <= 0) break;
+    read_count += rc;
+  }
+  return read_count;
+}
+
+SegmentedLog::SegmentedLog(const std::string &name, size_t segment_size,
+                           size_t recycled_segments)
+    : name_(name), segment_size_(segment_size),
+      recycled_segments_(recycled_segments), first_segment_(0), end_(0),
+      run_recorded_(false) {
+  control_fd_ = open(name_.c_str(), O_RDWR | O_CREAT, 0644);
+  if (control_fd_ < 0) {
+    throw Exception(EXCEPTION_TYPE_INVALID,
+                    "can not open " + name_ + ": " + strerror(errno));
+  }
+  ScanSegments(LoadControl());
+}
+
+SegmentedLog::~SegmentedLog() {
+  if (prepare_.valid()) prepare_.wait();
+  for (auto &segment : segments_) {
+    close(segment.second);
+  }
+  close(control_fd_);
+}
+
+/*
+ * Write data at the end of the log and sync it. The first append of a
+ * SegmentedLog records the start of its run in the control file.
+ */
+bool SegmentedLog::Append(const char *data, size_t size) {
+  std::unique_lock<std::mutex> lock(latch_);
+  if (!run_recorded_) {
+    runs_.push_back(end_);
+    if (!WriteControl()) {
+      runs_.pop_back();
+      return false;
+    }
+    run_recorded_ = true;
+  }
+
+  std::vector<int> written_fds;
+  size_t written = 0;
+  while (written < size) {
+    uint64_t segment = end_ / segment_size_;
+    size_t offset = end_ % segment_size_;
+    auto it = segments_.find(segment);
+    int fd = it == segments_.end() ? -1 : it->second;
+    if (fd < 0) {
+      // one appender at a time, the segment is only prepared here
+      lock.unlock();
+      if (prepare_.valid()) prepare_.wait();
+      fd = PrepareSegment(segment);
+      lock.lock();
+      if (fd < 0) return false;
+    }
+    size_t n = std::min(size - written, segment_size_ - offset);
+    size_t mark = std::min<size_t>(SEGMENTED_LOG_END_MARK,
+                                   segment_size_ - offset - n);
+    if (!WriteWithEndMark(fd, data + written, n, mark, offset)) return false;
+    if (written_fds.empty() || written_fds.back() != fd)
+      written_fds.push_back(fd);
+    if (offset < segment_size_ / 2 && offset + n >= segment_size_ / 2)
+      PrepareAhead(segment + 1);
+    written += n;
+    end_ += n;
+  }
+  for (int fd : written_fds) {
+    if (fdatasync(fd) != 0) return false;
+  }
+  return true;
+}
+
+/*
+ * Read size bytes of the log at offset. Truncated segments and anything
+ * past the end of the log read as zeros.
+ */
+bool SegmentedLog::Read(char *data, size_t size, size_t offset) {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (offset >= end_) return false;
+  size_t done = 0;
+  while (done < size) {
+    uint64_t pos = offset + done;
+    uint64_t segment = pos / segment_size_;
+    size_t n = std::min<size_t>(size - done,
+                                segment_size_ - pos % segment_size_);
+    size_t read_count = 0;
+    if (pos < end_ && segment >= first_segment_) {
+      int fd = OpenSegment(segment);
+      if (fd >= 0)
+        read_count = ReadFully(fd, data + done,
+                               std::min<uint64_t>(n, end_ - pos),
+                               pos % segment_size_);
+    }
+    memset(data + done + read_count, 0, n - read_count);
+    done += n;
+  }
+  return true;
+}
+
+/*
+ * Drop the segments before the one holding offset. The control file is
+ * updated before any of them can be reused.
+ */
+void SegmentedLog::Truncate(size_t offset) {
+  std::lock_guard<std::mutex> guard(latch_);
+  uint64_t segment = std::min<uint64_t>(offset, end_) / segment_size_;
+  if (segment <= first_segment_) return;
+  uint64_t first_segment = first_segment_;
+  std::vector<uint64_t> runs = runs_;
+  first_segment_ = segment;
+  runs_.erase(std::remove_if(runs_.begin(), runs_.end(),
+                             [this](uint64_t run) {
+                               return run < first_segment_ * segment_size_;
+                             }),
+              runs_.end());
+  if (!WriteControl()) {
+    first_segment_ = first_segment;
+    runs_ = runs;
+    return;
+  }
+
+  struct stat stat_buf;
+  for (uint64_t dropped = first_segment; dropped < segment; ++dropped) {
+    auto it = segments_.find(dropped);
+    if (it != segments_.end()) {
+      close(it->second);
+      segments_.erase(it);
+    }
+    if (stat(SegmentName(dropped).c_str(), &stat_buf) == 0)
+      free_segments_.push_back(dropped);
+  }
+  while (free_segments_.size() > recycled_segments_) {
+    unlink(SegmentName(free_segments_.front()).c_str());
+    free_segments_.pop_front();
+  }
+}
+
+size_t SegmentedLog::GetNextRun(size_t offset) {
+  std::lock_guard<std::mutex> guard(latch_);
+  auto run = std::upper_bound(runs_.begin(), runs_.end(), offset);
+  return run == runs_.end() ? end_ : *run;
+}
+
+size_t SegmentedLog::GetStart() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return first_segment_ * segment_size_;
+}
+
+size_t SegmentedLog::GetEnd() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return end_;
+}
+
+size_t SegmentedLog::GetNumSegments() {
+  std::lock_guard<std::mutex> guard(latch_);
+  size_t num_segments = 0;
+  struct stat stat_buf;
+  for (uint64_t segment = first_segment_;
+       segment <= (end_ + segment_size_ - 1) / segment_size_; ++segment) {
+    if (stat(SegmentName(segment).c_str(), &stat_buf) == 0) ++num_segments;
+  }
+  return num_segments;
+}
+
+size_t SegmentedLog::GetNumFreeSegments() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return free_segments_.size();
+}
+
+std::string SegmentedLog::SegmentName(uint64_t segment) const {
+  return name_ + "." + std::to_string(segment);
+}
+
+/*
+ * Read the control file back
+ * @return: false if there is none, the log starts over then
+ */
+bool SegmentedLog::LoadControl() {
+  uint32_t header[2];
+  uint64_t sizes[2];
+  if (pread(control_fd_, header, sizeof(header), 0) != sizeof(header) ||
+      header[0] != SEGMENTED_LOG_MAGIC ||
+      pread(control_fd_, sizes, sizeof(sizes), sizeof(header)) !=
+          sizeof(sizes) ||
+      sizes[0] == 0)
+    return false;
+  std::vector<uint64_t> runs(header[1]);
+  size_t size = runs.size() * sizeof(uint64_t);
+  if (ReadFully(control_fd_, reinterpret_cast<char *>(runs.data()), size,
+                sizeof(header) + sizeof(sizes)) != size)
+    return false;
+  segment_size_ = sizes[0];
+  first_segment_ = sizes[1];
+  runs_ = runs;
+  return true;
+}
+
+/*
+ * Caller holds latch_
+ */
+bool SegmentedLog::WriteControl() {
+  std::vector<char> control(2 * sizeof(uint32_t) + 2 * sizeof(uint64_t) +
+                            runs_.size() * sizeof(uint64_t));
+  uint32_t header[2] = {SEGMENTED_LOG_MAGIC,
+                        static_cast<uint32_t>(runs_.size())};
+  uint64_t sizes[2] = {segment_size_, first_segment_};
+  memcpy(control.data(), header, sizeof(header));
+  memcpy(control.data() + sizeof(header), sizes, sizeof(sizes));
+  memcpy(control.data() + sizeof(header) + sizeof(sizes), runs_.data(),
+         runs_.size() * sizeof(uint64_t));
+  if (!WriteFully(control_fd_, control.data(), control.size(), 0) ||
+      fdatasync(control_fd_) != 0) {
+    LOG_DEBUG("I/O error while writing log control file");
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Find the segment files next to the control file. The log ends with the
+ * last segment as far as anybody can tell, files of truncated segments (all
+ * of them without a control file) are kept for reuse.
+ */
+void SegmentedLog::ScanSegments(bool valid) {
+  if (!valid) {
+    first_segment_ = 0;
+    runs_.clear();
+  }
+  std::string::size_type slash = name_.rfind('/');
+  std::string dir_name =
+      slash == std::string::npos ? "." : name_.substr(0, slash + 1);
+  std::string prefix =
+      (slash == std::string::npos ? name_ : name_.substr(slash + 1)) + ".";
+  uint64_t end_segment = first_segment_;
+  std::vector<uint64_t> free_segments;
+  DIR *dir = opendir(dir_name.c_str());
+  if (dir != nullptr) {
+    while (struct dirent *entry = readdir(dir)) {
+      std::string file_name = entry->d_name;
+      if (file_name.size() <= prefix.size() ||
+          file_name.compare(0, prefix.size(), prefix) != 0 ||
+          file_name.find_first_not_of("0123456789", prefix.size()) !=
+              std::string::npos)
+        continue;
+      uint64_t segment = strtoull(file_name.c_str() + prefix.size(), nullptr,
+                                  10);
+      if (valid && segment >= first_segment_) {
+        end_segment = std::max(end_segment, segment + 1);
+      } else {
+        free_segments.push_back(segment);
+      }
+    }
+    closedir(dir);
+  }
+  std::sort(free_segments.begin(), free_segments.end());
+  free_segments_.assign(free_segments.begin(), free_segments.end());
+  while (free_segments_.size() > recycled_segments_) {
+    unlink(SegmentName(free_segments_.front()).c_str());
+    free_segments_.pop_front();
+  }
+  end_ = end_segment * segment_size_;
+}
+
+/*
+ * A segment of the log that is on disk already, -1 if there is no file.
+ * Caller holds latch_
+ */
+int SegmentedLog::OpenSegment(uint64_t segment) {
+  auto it = segments_.find(segment);
+  if (it != segments_.end()) return it->second;
+  int fd = open(SegmentName(segment).c_str(), O_RDWR);
+  if (fd >= 0) segments_[segment] = fd;
+  return fd;
+}
+
+/*
+ * Make a segment file ready to be appended to: rename a truncated segment
+ * (its own old file first) and zero its start, or allocate a new one by
+ * writing zeros over all of it. Runs without the latch.
+ * @return: the open segment, -1 on I/O error
+ */
+int SegmentedLog::PrepareSegment(uint64_t segment) {
+  std::string segment_name = SegmentName(segment);
+  bool recycled = false;
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    auto it = segments_.find(segment);
+    if (it != segments_.end()) return it->second;
+    if (!free_segments_.empty()) {
+      auto same = std::find(free_segments_.begin(), free_segments_.end(),
+                            segment);
+      uint64_t free_segment =
+          same == free_segments_.end() ? free_segments_.front() : *same;
+      free_segments_.erase(same == free_segments_.end()
+                               ? free_segments_.begin()
+                               : same);
+      recycled = free_segment == segment ||
+                 rename(SegmentName(free_segment).c_str(),
+                        segment_name.c_str()) == 0;
+    }
+  }
+
+  int fd;
+  if (recycled) {
+    static const char zeros[SEGMENTED_LOG_END_MARK] = {};
+    fd = open(segment_name.c_str(), O_RDWR);
+    if (fd >= 0 && (!WriteFully(fd, zeros, sizeof(zeros), 0) ||
+                    fdatasync(fd) != 0)) {
+      close(fd);
+      fd = -1;
+    }
+  } else {
+    fd = open(segment_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    std::vector<char> zeros(std::min<size_t>(SEGMENTED_LOG_ZERO_CHUNK,
+                                             segment_size_),
+                            0);
+    for (size_t offset = 0; fd >= 0 && offset < segment_size_;
+         offset += zeros.size()) {
+      if (!WriteFully(fd, zeros.data(),
+                      std::min(zeros.size(), segment_size_ - offset),
+                      offset)) {
+        close(fd);
+        fd = -1;
+      }
+    }
+    if (fd >= 0 && fdatasync(fd) != 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+  if (fd < 0) {
+    LOG_DEBUG("I/O error while preparing log segment");
+    return -1;
+  }
+  std::lock_guard<std::mutex> guard(latch_);
+  segments_[segment] = fd;
+  return fd;
+}
+
+/*
+ * Prepare segment in the background, unless it is already.
+ * Caller holds latch_
+ */
+void SegmentedLog::PrepareAhead(uint64_t segment) {
+  if ((prepare_.valid() && prepare_.wait_for(std::chrono::seconds(0)) !=
+                               std::future_status::ready) ||
+      segments_.count(segment) > 0)
+    return;
+  prepare_ = std::async(std::launch::async,
+                        [this, segment] { PrepareSegment(segment); });
+}
+
+} // namespace cmudb
@@ -1,4 +1,6 @@
 #include <list>
+#include <thread>
+#include <unordered_set>
 
 #include "hash/extendible_hash.h"
 #include "page/page.h"
@@ -11,10 +13,27 @@ namespace cmudb {
  */
 template <typename K, typename V>
 ExtendibleHash<K, V>::ExtendibleHash(size_t size)
-: globalDepth_(0), maxSize_(size), buckets_({ std::make_shared<Bucket>(0) }) {}
+: maxSize_(size), directory_(new Directory(0)), epoch_(0) {
+    directory_.load()->slots[0] = new Bucket(0);
+    for (auto &parity : readers_) {
+        for (auto &reader : parity) reader.count = 0;
+    }
+}
 
-template <typename K, typename V> 
+template <typename K, typename V>
 ExtendibleHash<K, V>::ExtendibleHash(): ExtendibleHash(2) {}
+
+template <typename K, typename V>
+ExtendibleHash<K, V>::~ExtendibleHash() {
+    Directory *dir = directory_.load();
+    std::unordered_set<Bucket *> buckets;
+    for (size_t i = 0; i < dir->Size(); ++i) buckets.insert(dir->slots[i].load());
+    for (Bucket *bucket : buckets) delete bucket;
+    delete dir;
+    for (Directory *retired : retired_) delete retired;
+    for (Bucket *retired : retiredBuckets_) delete retired;
+}
+
 /*
  * helper function to calculate the hashing address of input key
  */
@@ -26,9 +45,11 @@ size_t ExtendibleHash<K, V>::HashKey(const K &key) { return std::hash<K>{}(key);
  * NOTE: you must implement this function in order to pass test
  */
 template <typename K, typename V>
-int ExtendibleHash<K, V>::GetGlobalDepth() const { 
-    std::lock_guard<std::mutex> guard(latch_);
-    return globalDepth_; 
+int ExtendibleHash<K, V>::GetGlobalDepth() const {
+    size_t token = Enter();
+    int depth = directory_.load()->globalDepth;
+    Exit(token);
+    return depth;
 }
 
 /*
@@ -36,18 +57,89 @@ int ExtendibleHash<K, V>::GetGlobalDepth() const {
  * NOTE: you must implement this function in order to pass test
  */
 template <typename K, typename V>
-int ExtendibleHash<K, V>::GetLocalDepth(int bucket_id) const { 
-    std::lock_guard<std::mutex> guard(latch_);
-    return buckets_[bucket_id]->depth; 
+int ExtendibleHash<K, V>::GetLocalDepth(int bucket_id) const {
+    size_t token = Enter();
+    int depth = directory_.load()->slots[bucket_id].load()->depth;
+    Exit(token);
+    return depth;
 }
 
 /*
  * helper function to return current number of bucket in hash table
  */
 template <typename K, typename V>
-int ExtendibleHash<K, V>::GetNumBuckets() const { 
-    std::lock_guard<std::mutex> guard(latch_);
-    return buckets_.size(); 
+int ExtendibleHash<K, V>::GetNumBuckets() const {
+    size_t token = Enter();
+    int size = directory_.load()->Size();
+    Exit(token);
+    return size;
+}
+
+/*
+ * Announce a directory reader in the current epoch, on the counter stripe of
+ * the calling thread
+ * @return: token to pass to Exit
+ */
+template <typename K, typename V>
+size_t ExtendibleHash<K, V>::Enter() const {
+    static std::atomic<size_t> next_stripe{0};
+    thread_local size_t stripe = next_stripe++ % HASH_READER_STRIPES;
+    for (;;) {
+        uint64_t epoch = epoch_.load();
+        std::atomic<size_t> &count = readers_[epoch & 1][stripe].count;
+        ++count;
+        if (epoch_.load() == epoch) return (epoch & 1) * HASH_READER_STRIPES + stripe;
+        // raced with an epoch change, count in the new one
+        --count;
+    }
+}
+
+template <typename K, typename V>
+void ExtendibleHash<K, V>::Exit(size_t token) const {
+    --readers_[token / HASH_READER_STRIPES][token % HASH_READER_STRIPES].count;
+}
+
+/*
+ * Latch the bucket the current directory maps hash to. The directory is
+ * read again once the bucket is latched: a split may have moved the key to
+ * another bucket meanwhile.
+ * Caller must be inside Enter/Exit
+ */
+template <typename K, typename V>
+typename ExtendibleHash<K, V>::Bucket *ExtendibleHash<K, V>::LatchBucket(size_t hash) {
+    for (;;) {
+        Bucket *bucket = directory_.load()->SlotOf(hash).load();
+        bucket->latch.lock();
+        if (directory_.load()->SlotOf(hash).load() == bucket) return bucket;
+        bucket->latch.unlock();
+    }
+}
+
+/*
+ * Free the retired directories and buckets once the operations that may
+ * still read them are done. Must be called outside Enter/Exit and without
+ * holding latches.
+ */
+template <typename K, typename V>
+void ExtendibleHash<K, V>::Reclaim() {
+    std::vector<Directory *> retired;
+    std::vector<Bucket *> retiredBuckets;
+    {
+        std::lock_guard<std::mutex> guard(retireLatch_);
+        retired.swap(retired_);
+        retiredBuckets.swap(retiredBuckets_);
+    }
+    if (retired.empty() && retiredBuckets.empty()) return;
+    {
+        std::lock_guard<std::mutex> guard(reclaimLatch_);
+        // readers entering from now on count in the next epoch
+        uint64_t epoch = epoch_++;
+        for (auto &reader : readers_[epoch & 1]) {
+            while (reader.count.load() != 0) std::this_thread::yield();
+        }
+    }
+    for (Directory *dir : retired) delete dir;
+    for (Bucket *bucket : retiredBuckets) delete bucket;
 }
 
 /*
@@ -55,26 +147,133 @@ int ExtendibleHash<K, V>::GetNumBuckets() const {
  */
 template <typename K, typename V>
 bool ExtendibleHash<K, V>::Find(const K &key, V &value) {
-    std::lock_guard<std::mutex> guard(latch_);
-    auto index = HashKey(key) & ((1 << globalDepth_) - 1);
-    if (!buckets_[index]->map.count(key)) return false;
-    value = buckets_[index]->map[key];
-    return true;
+    size_t token = Enter();
+    Bucket *bucket = LatchBucket(HashKey(key));
+    auto it = bucket->map.find(key);
+    bool found = it != bucket->map.end();
+    if (found) value = it->second;
+    bucket->latch.unlock();
+    Exit(token);
+    return found;
 }
 
 /*
  * delete <key,value> entry in hash table
- * Shrink & Combination is not required for this project
+ * Combine the bucket with its buddy when both fit in half a bucket and halve
+ * the directory when no bucket needs the global depth anymore
  */
 template <typename K, typename V>
 bool ExtendibleHash<K, V>::Remove(const K &key) {
-    std::lock_guard<std::mutex> guard(latch_);
-    auto index = HashKey(key) & ((1 << globalDepth_) - 1);
-    if (!buckets_[index]->map.count(key))  return false;
-    buckets_[index]->map.erase(key);
+    size_t hash = HashKey(key);
+    size_t token = Enter();
+    Bucket *bucket = LatchBucket(hash);
+    bool found = bucket->map.erase(key) > 0;
+    bool merged = false;
+    if (found && (int)bucket->map.size() <= maxSize_ / 2) {
+        std::lock_guard<std::mutex> guard(dirLatch_);
+        while (Merge(bucket, hash)) merged = true;
+        if (merged) Shrink();
+    }
+    bucket->latch.unlock();
+    Exit(token);
+    if (merged) Reclaim();
+    return found;
+}
+
+/*
+ * Move the entries of the buddy of bucket, the bucket whose slots differ in
+ * the last bit of their local depth, into bucket and point the buddy slots
+ * to bucket. Merging is best effort: it is skipped when the buddy is split
+ * deeper, latched by another operation, or the two together would fill more
+ * than half a bucket, so that churn around the split point does not keep
+ * splitting and merging the same bucket.
+ * Caller must hold dirLatch_ and the latch of bucket, which hash maps to
+ * @return: true if the buddy was merged and retired
+ */
+template <typename K, typename V>
+bool ExtendibleHash<K, V>::Merge(Bucket *bucket, size_t hash) {
+    int depth = bucket->depth;
+    if (depth == 0) return false;
+    Directory *dir = directory_.load();
+    Bucket *buddy = dir->SlotOf(hash ^ (1 << (depth - 1))).load();
+    // waiting for the buddy latch could deadlock with its holder
+    if (buddy->depth != depth || !buddy->latch.try_lock()) return false;
+    if ((int)(bucket->map.size() + buddy->map.size()) > maxSize_ / 2) {
+        buddy->latch.unlock();
+        return false;
+    }
+    bucket->map.insert(buddy->map.begin(), buddy->map.end());
+    bucket->depth = depth - 1;
+    for (size_t i = 0; i < dir->Size(); ++i) {
+        if (dir->slots[i] == buddy) dir->slots[i] = bucket;
+    }
+    // operations waiting on the buddy find it unmapped and retry
+    buddy->latch.unlock();
+    std::lock_guard<std::mutex> guard(retireLatch_);
+    retiredBuckets_.push_back(buddy);
     return true;
 }
 
+/*
+ * Halve the directory as long as no bucket is at the global depth, every
+ * slot of the upper half then points to the same bucket as its lower twin.
+ * Caller must hold dirLatch_
+ */
+template <typename K, typename V>
+void ExtendibleHash<K, V>::Shrink() {
+    Directory *dir = directory_.load();
+    while (dir->globalDepth > 0) {
+        for (size_t i = 0; i < dir->Size(); ++i) {
+            if (dir->slots[i].load()->depth == dir->globalDepth) return;
+        }
+        Directory *halved = new Directory(dir->globalDepth - 1);
+        for (size_t i = 0; i < halved->Size(); ++i) {
+            halved->slots[i] = dir->slots[i].load();
+        }
+        directory_ = halved;
+        std::lock_guard<std::mutex> guard(retireLatch_);
+        retired_.push_back(dir);
+        dir = halved;
+    }
+}
+
+/*
+ * Move the entries of bucket whose next hash bit is set to a new bucket and
+ * point the matching directory slots to it, doubling the directory first if
+ * bucket is already at the global depth. The new bucket is returned latched.
+ * Caller must hold dirLatch_ and the latch of bucket
+ */
+template <typename K, typename V>
+typename ExtendibleHash<K, V>::Bucket *ExtendibleHash<K, V>::Split(Bucket *bucket) {
+    Directory *dir = directory_.load();
+    int depth = bucket->depth;
+    if (depth == dir->globalDepth) {
+        Directory *doubled = new Directory(dir->globalDepth + 1);
+        for (size_t i = 0; i < doubled->Size(); ++i) {
+            doubled->slots[i] = dir->slots[i & (dir->Size() - 1)].load();
+        }
+        directory_ = doubled;
+        std::lock_guard<std::mutex> guard(retireLatch_);
+        retired_.push_back(dir);
+        dir = doubled;
+    }
+
+    Bucket *newBucket = new Bucket(depth + 1);
+    newBucket->latch.lock();
+    auto it = bucket->map.begin();
+    while (it != bucket->map.end()) {
+        if (HashKey(it->first) & (1 << depth)) {
+            newBucket->map[it->first] = it->second;
+            it = bucket->map.erase(it);
+        } else ++it;
+    }
+    bucket->depth = depth + 1;
+    for (size_t i = 0; i < dir->Size(); ++i) {
+        if (dir->slots[i] == bucket && (i & (1 << depth))) dir->slots[i] = newBucket;
+    }
+    return newBucket;
+}
+
 /*
  * insert <key,value> entry in hash table
  * Split & Redistribute bucket when there is overflow and if necessary increase
@@ -82,33 +281,27 @@ bool ExtendibleHash<K, V>::Remove(const K &key) {
  */
 template <typename K, typename V>
 void ExtendibleHash<K, V>::Insert(const K &key, const V &value) {
-    std::lock_guard<std::mutex> guard(latch_);
-    auto index = HashKey(key) & ((1 << globalDepth_) - 1);
-    auto bucket = buckets_[index];
+    size_t hash = HashKey(key);
+    size_t token = Enter();
+    Bucket *bucket = LatchBucket(hash);
     bucket->map[key] = value;
-    while ((int)bucket->map.size() > maxSize_) {
-        auto newBucket = std::make_shared<Bucket>(bucket->depth + 1);
-        auto it = bucket->map.begin();
-        while (it != bucket->map.end()) {
-            if (HashKey(it->first) & (1 << bucket->depth)) {
-                newBucket->map[it->first] = it->second;
-                it = bucket->map.erase(it);
-            } else ++it;
-        }
-        if (++bucket->depth > globalDepth_) {
-            for (int i = 0; i < (1 << globalDepth_); ++i) {
-                if (buckets_[i] == bucket) buckets_.push_back(newBucket);
-                else buckets_.push_back(buckets_[i]);
-            }
-            ++globalDepth_;
-        } else {
-            for (int i = 0; i < (1 << globalDepth_); ++i) {
-                if (buckets_[i] == bucket && (i & (1 << (bucket->depth - 1)))) buckets_[i] = newBucket;
-            }
+    bool doubled = false;
+    if ((int)bucket->map.size() > maxSize_) {
+        std::lock_guard<std::mutex> guard(dirLatch_);
+        Directory *dir = directory_.load();
+        while ((int)bucket->map.size() > maxSize_) {
+            int depth = bucket->depth;
+            Bucket *newBucket = Split(bucket);
+            // keep splitting the half the key went to
+            if (hash & (1 << depth)) std::swap(bucket, newBucket);
+            newBucket->latch.unlock();
         }
-        index = HashKey(key) & ((1 << globalDepth_) - 1);
-        bucket = buckets_[index];
+        doubled = directory_.load() != dir;
     }
+    bucket->latch.unlock();
+    Exit(token);
+    // only the writer that retired a directory waits for its readers
+    if (doubled) Reclaim();
 }
 
 template class ExtendibleHash<page_id_t, Page *>;
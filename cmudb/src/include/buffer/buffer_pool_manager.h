@@ -4,44 +4,232 @@
  * Functionality: The simplified Buffer Manager interface allows a client to
  * new/delete pages on disk, to read a disk page into the buffer pool and pin
  * it, also to unpin a page in the buffer pool.
+ *
+ * The pool can be partitioned into several independent shards. Page ids are
+ * hashed onto a shard, and each shard owns its own frames, page table,
+ * replacer, free list and latch, so operations on pages that live in
+ * different shards never contend with each other.
+ *
+ * A FetchPage hit takes no latch at all: the frame is found through the
+ * shard's lock free page table and pinned with an atomic increment. The
+ * shard latch is only taken on a miss, on eviction and on page deletion.
+ * Frames stay in the replacer while pinned, the replacer is lazily cleaned
+ * up when a pinned frame comes out of Victim().
+ *
+ * A background page cleaner can be started to write dirty unpinned frames
+ * ahead of the replacer's victim order, so that eviction rarely has to write
+ * a page while the shard latch is held. The cleaner writes a page under its
+ * read latch without pinning it, an evictor waits for that write by taking
+ * the write latch of the frame it claimed. The writes of a cleaner round are
+ * submitted together as asynchronous disk I/O.
+ *
+ * Writes are coalesced: FlushAllPages sorts the dirty frames by page id and
+ * writes every run of consecutive pages with one vectored write, and an
+ * eviction that has to write a dirty victim takes up to EVICTION_WRITE_RUN
+ * dirty unpinned neighbours of it along, in any shard, latched like the
+ * cleaner does. Bulk loads then turn into a few large sequential writes.
+ *
+ * With logging on, every write of a page first forces the log up to the
+ * page's LSN (write ahead rule). A page also knows the LSN of its oldest
+ * change that is not written back (recLSN), which checkpoints collect into
+ * a dirty page table.
+ *
+ * FetchPage can be given a BufferRing, misses then recycle the ring's own
+ * frames instead of evicting pages through the replacer.
+ *
+ * Every pool keeps counters and latency histograms of its operations, see
+ * buffer_pool_stats.h.
+ *
+ * Prefetch schedules page reads on a pool of I/O workers. The page is read
+ * into a claimed frame outside the shard latch and then installed unpinned,
+ * as if it had been fetched and unpinned. The claimed frame is in the page
+ * table during the read, a fetch of the page waits for it. The reads of a PrefetchBatch are
+ * submitted together as asynchronous disk I/O. Prefetching is only a hint:
+ * it gives up if the shard has no free frame.
+ *
+ * For a warm restart, SaveResidentPages writes the ids of the resident pages
+ * to a file, hottest first according to the replacers, and
+ * LoadResidentPages reads them back in the background. The ids are read in
+ * sorted runs of consecutive pages, into free frames only, so pages that
+ * queries have fetched meanwhile are never evicted for the warm-up. Like a
+ * prefetch, a page being loaded is in the page table and fetches of it wait,
+ * so the warm-up may overlap with queries.
  */
 
 #pragma once
+#include <chrono>
+#include <condition_variable>
+#include <future>
 #include <list>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include "buffer/buffer_pool_stats.h"
+#include "buffer/buffer_ring.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
 #include "buffer/lru_replacer.h"
+#include "buffer/page_table.h"
+#include "common/thread_pool.h"
 #include "disk/disk_manager.h"
-#include "hash/extendible_hash.h"
 #include "logging/log_manager.h"
 #include "page/page.h"
 
 namespace cmudb {
+// replacement policy used by every shard of a buffer pool
+enum class ReplacerType { LRU, CLOCK, LRU_K };
+
+// reads the id of the next page of a chain (heap pages, leaf pages) out of
+// the content of a page
+typedef page_id_t (*NextPageFn)(const char *data);
+
 class BufferPoolManager {
+  friend class BufferRing;
+
 public:
   BufferPoolManager(size_t pool_size, DiskManager *disk_manager,
-                          LogManager *log_manager = nullptr);
+                          LogManager *log_manager = nullptr,
+                          size_t num_instances = 1,
+                          ReplacerType replacer_type = ReplacerType::LRU);
 
   ~BufferPoolManager();
 
-  Page *FetchPage(page_id_t page_id);
+  Page *FetchPage(page_id_t page_id, BufferRing *buffer_ring = nullptr);
 
   bool UnpinPage(page_id_t page_id, bool is_dirty);
 
   bool FlushPage(page_id_t page_id);
 
-  Page *NewPage(page_id_t &page_id);
+  // writes back every dirty page, or those whose oldest change that is not
+  // on disk precedes rec_lsn, see above. Returns the number of pages
+  // written, the caller must not hold a page latch
+  size_t FlushAllPages(lsn_t rec_lsn = INVALID_LSN);
+  // (page id, recovery lsn) of the pages with changes that are not on disk,
+  // the caller must not hold a page latch
+  void GetDirtyPageTable(std::vector<std::pair<page_id_t, lsn_t>> &dirty_pages);
+
+  Page *NewPage(page_id_t &page_id, page_id_t hint = INVALID_PAGE_ID);
 
   bool DeletePage(page_id_t page_id);
 
+  // asynchronous reads that leave the pages unpinned
+  void Prefetch(page_id_t page_id);
+  void PrefetchBatch(const std::vector<page_id_t> &page_ids);
+  // read count pages of a chain starting at page_id, following next_page
+  void PrefetchChain(page_id_t page_id, size_t count, NextPageFn next_page,
+                     std::shared_ptr<BufferRing> buffer_ring = nullptr);
+
+  // clean_target: clean frames to keep at the head of the victim order
+  // max_writes: page writes per round, interval: pause between rounds
+  void RunPageCleaner(size_t clean_target = PAGE_CLEANER_CLEAN_TARGET,
+                      size_t max_writes = PAGE_CLEANER_MAX_WRITES,
+                      std::chrono::milliseconds interval =
+                          std::chrono::milliseconds(PAGE_CLEANER_INTERVAL));
+  void StopPageCleaner();
+
+  // warm restart, see above
+  bool SaveResidentPages(const std::string &file_name);
+  // the future tells how many pages were loaded
+  std::future<size_t> LoadResidentPages(const std::string &file_name);
+
+  inline size_t GetPoolSize() const { return pool_size_; }
+  inline size_t GetPageSize() const { return page_size_; }
+  inline size_t GetNumInstances() const { return num_instances_; }
+  // frames reused for another page
+  inline size_t GetEvictionCount() const {
+    return stats_.Get(BufferPoolCounter::EVICTION);
+  }
+  // pages written back by evictions, the victims and their neighbours
+  inline size_t GetForegroundWriteCount() const {
+    return stats_.Get(BufferPoolCounter::FOREGROUND_WRITE);
+  }
+  inline size_t GetCleanerWriteCount() const {
+    return stats_.Get(BufferPoolCounter::CLEANER_WRITE);
+  }
+  // pages read by prefetching
+  inline size_t GetPrefetchCount() const {
+    return stats_.Get(BufferPoolCounter::PREFETCH);
+  }
+
+  // counters and latency histograms since construction or the last reset
+  inline BufferPoolStatsSnapshot GetStats() const { return stats_.Snapshot(); }
+  inline void ResetStats() { stats_.Reset(); }
+  // state of every frame of the pool, in frame order
+  void GetFrameStats(std::vector<FrameStats> &frames) const;
+
 private:
+  // one partition of the pool, protected by its own latch
+  struct Shard {
+    Page *pages_;      // frames owned by this shard (slice of the pool)
+    size_t size_;      // number of frames in this shard
+    PageTable *page_table_;        // to keep track of pages
+    Replacer<Page *> *replacer_;   // to find an unpinned page for replacement
+    std::list<Page *> *free_list_; // to find a free page for replacement
+    std::mutex latch_;             // to protect shard data structure
+    // signaled when a prefetched page is installed
+    std::condition_variable loaded_cv_;
+  };
+
+  inline Shard &GetShard(page_id_t page_id) {
+    return shards_[static_cast<size_t>(page_id) % num_instances_];
+  }
+  Replacer<Page *> *MakeReplacer(const Shard &shard) const;
+  inline bool OwnsFrame(const Shard &shard, const Page *page) const {
+    return page >= shard.pages_ && page < shard.pages_ + shard.size_;
+  }
+  Shard &GetFrameShard(const Page *page);
+  Page *GetVictimPage(Shard &shard);
+  void EvictPage(Shard &shard, Page *page);
+  Page *TryLatchDirtyPage(page_id_t page_id);
+  bool WriteRun(Page *const *pages, size_t num_pages);
+  void FlushLog(lsn_t lsn);
+  size_t CleanShard(Shard &shard, size_t clean_target, size_t max_writes);
+  ThreadPool &GetIOWorkers();
+  page_id_t PrefetchPage(page_id_t page_id, BufferRing *buffer_ring,
+                         NextPageFn next_page);
+  Page *ClaimPrefetchFrame(Shard &shard, page_id_t page_id,
+                           BufferRing *buffer_ring);
+  void InstallPrefetchedPage(Shard &shard, page_id_t page_id, Page *page,
+                             bool read_ok);
+  size_t WarmUp(const std::vector<page_id_t> &page_ids);
+  Page *ClaimWarmFrame(page_id_t page_id);
+  Page *GetRingVictimPage(Shard &shard, BufferRing &buffer_ring);
+  void ReleaseRingFrame(BufferRing &buffer_ring, Page *page);
+  void ReleaseBufferRing(BufferRing &buffer_ring);
+  Page *TryPin(Shard &shard, page_id_t page_id);
+  Page *FindLoaded(Shard &shard, page_id_t page_id,
+                   std::unique_lock<std::mutex> &lock);
+  std::unique_lock<std::mutex> LockShard(Shard &shard);
+  void RecordHit(Page *page, std::chrono::steady_clock::time_point start);
+  bool Unpin(Shard &shard, Page *page);
+
   size_t pool_size_; // number of pages in buffer pool
   Page *pages_;      // array of pages
+  size_t page_size_; // size of the data of every page
+  char *page_data_;  // page_size_ bytes of data per page
   DiskManager *disk_manager_;
   LogManager *log_manager_;
-  HashTable<page_id_t, Page *> *page_table_; // to keep track of pages
-  Replacer<Page *> *replacer_;   // to find an unpinned page for replacement
-  std::list<Page *> *free_list_; // to find a free page for replacement
-  std::mutex latch_;             // to protect shared data structure
+  size_t num_instances_; // number of shards the pool is split into
+  ReplacerType replacer_type_;
+
+  BufferPoolStats stats_;
+
+  // page cleaner
+  std::thread *page_cleaner_ = nullptr;
+  bool cleaner_running_ = false;
+  std::mutex cleaner_latch_;
+  std::condition_variable cleaner_cv_;
+  // scratch space of one cleaner round, sized once
+  std::vector<Page *> cleaner_candidates_;
+  std::vector<page_id_t> cleaner_page_ids_;
+  std::vector<std::future<bool>> cleaner_writes_;
+
+  // I/O workers serving prefetches, started on first use
+  std::once_flag io_workers_started_;
+  ThreadPool *io_workers_ = nullptr;
+  Shard *shards_;        // array of shards
 };
 } // namespace cmudb
@@ -0,0 +1,113 @@
+/**
+ * buffer_pool_stats.h
+ *
+ * Functionality: Counters and latency histograms of one buffer pool.
+ *
+ * Updates are relaxed atomic adds on one of several stripes, every thread
+ * sticks to one stripe, so threads hitting the pool concurrently do not
+ * bounce the same cache line. Reading sums the stripes. Reset() zeroes them
+ * while updates may still be in flight: a snapshot taken right after a reset
+ * may already include a few operations that started before it.
+ *
+ * Latencies are kept in power of two buckets of nanoseconds, bucket 0 holds
+ * latencies below 1ns and bucket i holds latencies in [2^(i-1), 2^i).
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+enum class BufferPoolCounter {
+  FETCH_HIT,        // FetchPage found the page resident
+  FETCH_MISS,       // FetchPage had to read the page
+  NEW_PAGE,         // pages created by NewPage
+  EVICTION,         // frames reused for another page
+  FOREGROUND_WRITE, // dirty pages written back by an eviction
+  CLEANER_WRITE,    // dirty pages written back by the page cleaner
+  FLUSH_WRITE,      // dirty pages written back by FlushPage/FlushAllPages
+  WRITE_RUN,        // vectored writes of FlushAllPages and evictions
+  PREFETCH,         // pages read by prefetching
+  LATCH_WAIT_NS,    // time FetchPage/NewPage waited for a shard latch
+  NUM_COUNTERS
+};
+
+enum class BufferPoolLatency { FETCH_HIT, FETCH_MISS, NEW_PAGE, NUM_LATENCIES };
+
+static const size_t NUM_POOL_COUNTERS =
+    static_cast<size_t>(BufferPoolCounter::NUM_COUNTERS);
+static const size_t NUM_POOL_LATENCIES =
+    static_cast<size_t>(BufferPoolLatency::NUM_LATENCIES);
+static const size_t STATS_HISTOGRAM_BUCKETS = 32;
+
+struct LatencyHistogram {
+  uint64_t buckets_[STATS_HISTOGRAM_BUCKETS] = {};
+
+  // number of recorded latencies
+  uint64_t Count() const;
+  // upper bound in ns of the bucket holding the p-th percentile (0 < p <= 1)
+  uint64_t Percentile(double p) const;
+  // upper bound in ns of the highest non empty bucket
+  uint64_t Max() const;
+  static inline uint64_t BucketUpperBound(size_t bucket) {
+    return static_cast<uint64_t>(1) << bucket;
+  }
+};
+
+// a point in time copy of the statistics of a pool
+struct BufferPoolStatsSnapshot {
+  uint64_t counters_[NUM_POOL_COUNTERS] = {};
+  LatencyHistogram latencies_[NUM_POOL_LATENCIES];
+
+  inline uint64_t Get(BufferPoolCounter counter) const {
+    return counters_[static_cast<size_t>(counter)];
+  }
+  inline const LatencyHistogram &Get(BufferPoolLatency latency) const {
+    return latencies_[static_cast<size_t>(latency)];
+  }
+};
+
+// bookkeeping of one buffer pool frame
+struct FrameStats {
+  page_id_t page_id_;
+  int pin_count_;
+  bool is_dirty_;
+  uint32_t access_count_; // fetches since the page was loaded in the frame
+};
+
+class BufferPoolStats {
+public:
+  BufferPoolStats();
+
+  inline void Add(BufferPoolCounter counter, uint64_t value = 1) {
+    GetStripe().counters_[static_cast<size_t>(counter)].fetch_add(
+        value, std::memory_order_relaxed);
+  }
+  void RecordLatency(BufferPoolLatency latency, uint64_t ns);
+
+  // sum of one counter over all stripes
+  uint64_t Get(BufferPoolCounter counter) const;
+  BufferPoolStatsSnapshot Snapshot() const;
+  void Reset();
+
+  static const char *GetName(BufferPoolCounter counter);
+  static const char *GetName(BufferPoolLatency latency);
+
+private:
+  struct Stripe {
+    std::atomic<uint64_t> counters_[NUM_POOL_COUNTERS];
+    std::atomic<uint64_t> buckets_[NUM_POOL_LATENCIES][STATS_HISTOGRAM_BUCKETS];
+    // keeps the next stripe off the cache lines of this one
+    char padding_[64];
+  };
+
+  Stripe &GetStripe();
+
+  Stripe stripes_[BUFFER_POOL_STATS_STRIPES];
+};
+
+} // namespace cmudb
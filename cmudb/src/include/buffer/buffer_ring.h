@@ -0,0 +1,49 @@
+/**
+ * buffer_ring.h
+ *
+ * Functionality: Bulk read access strategy. A sequential scan fetches its
+ * pages through a small private ring of frames instead of the shared
+ * replacer: once the ring holds its share of a shard, the scan recycles the
+ * oldest unpinned frame of the ring rather than evicting somebody else's
+ * page. Frames owned by a ring never enter the replacer, so a large scan
+ * cannot flush the working set of the pool.
+ *
+ * A ring is driven by one scan and by the read-ahead it issues. When it is
+ * destroyed its frames are handed back to the replacer of their shard, so it
+ * must not outlive its buffer pool manager.
+ */
+
+#pragma once
+
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+namespace cmudb {
+
+class BufferPoolManager;
+class Page;
+
+class BufferRing {
+  friend class BufferPoolManager;
+
+public:
+  BufferRing(BufferPoolManager *buffer_pool_manager, size_t size);
+  ~BufferRing();
+
+  BufferRing(const BufferRing &) = delete;
+  BufferRing &operator=(const BufferRing &) = delete;
+
+  inline size_t GetSize() const { return size_; }
+
+private:
+  BufferPoolManager *buffer_pool_manager_;
+  size_t size_;
+  // frames adopted by the ring, least recently loaded first. An entry is
+  // stale once the frame's buffer_ring_ no longer points to this ring
+  std::vector<Page *> frames_;
+  // taken after the latch of a shard, protects frames_
+  std::mutex latch_;
+};
+
+} // namespace cmudb
@@ -0,0 +1,52 @@
+/**
+ * clock_replacer.h
+ *
+ * Functionality: CLOCK approximation of LRU. Every frame owns a fixed slot
+ * with a reference bit, Insert sets the bit and Victim sweeps a clock hand
+ * over the slots, giving a second chance to referenced frames. Nothing is
+ * allocated after construction.
+ *
+ * Values are mapped onto slots by their distance to base, so the replacer can
+ * track ints in [0, num_frames) or the frames of a Page array starting at
+ * base.
+ */
+
+#pragma once
+
+#include <mutex>
+
+#include "buffer/replacer.h"
+
+namespace cmudb {
+
+template <typename T> class ClockReplacer : public Replacer<T> {
+public:
+  ClockReplacer(size_t num_frames, T base = T());
+
+  ~ClockReplacer();
+
+  void Insert(const T &value);
+
+  bool Victim(T &value);
+
+  bool Erase(const T &value);
+
+  size_t Size();
+
+  size_t PeekVictims(T *values, size_t max_values);
+
+private:
+  inline size_t SlotOf(const T &value) const {
+    return static_cast<size_t>(value - base_);
+  }
+
+  size_t num_frames_;
+  T base_;
+  bool *in_replacer_; // slot holds an evictable frame
+  bool *ref_;         // reference bit, cleared when the hand passes by
+  size_t hand_;
+  size_t size_;
+  std::mutex latch_;
+};
+
+} // namespace cmudb
@@ -0,0 +1,68 @@
+/**
+ * lru_k_replacer.h
+ *
+ * Functionality: LRU-K replacement. The replacer remembers the timestamps of
+ * the last K references of every frame and evicts the frame whose K-th most
+ * recent reference is the oldest. Frames referenced fewer than K times have
+ * an infinite backward K-distance and go first (oldest reference first), so
+ * pages touched once by a scan are evicted before pages that are reused.
+ *
+ * Time is a logical clock advanced by every Insert. References that come
+ * within correlated_period ticks of the previous one are considered part of
+ * the same operation and only refresh the latest timestamp. Frames whose
+ * last reference is still inside that period are only evicted if no other
+ * frame is available.
+ *
+ * The history of a frame is kept across Victim, so a frame that turns out to
+ * be pinned does not lose it, and dropped by Erase once the frame is reused.
+ * Values are mapped onto slots by their distance to base, like in
+ * ClockReplacer. Nothing is allocated after construction.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+#include "buffer/replacer.h"
+
+namespace cmudb {
+
+template <typename T> class LRUKReplacer : public Replacer<T> {
+public:
+  LRUKReplacer(size_t num_frames, T base = T(), size_t k = 2,
+               uint64_t correlated_period = 0);
+
+  ~LRUKReplacer();
+
+  void Insert(const T &value);
+
+  bool Victim(T &value);
+
+  bool Erase(const T &value);
+
+  size_t Size();
+
+  size_t PeekVictims(T *values, size_t max_values);
+
+private:
+  inline size_t SlotOf(const T &value) const {
+    return static_cast<size_t>(value - base_);
+  }
+  // most recent reference first
+  inline uint64_t *HistoryOf(size_t slot) { return history_ + slot * k_; }
+  bool EvictsBefore(size_t slot, size_t other);
+
+  size_t num_frames_;
+  T base_;
+  size_t k_;
+  uint64_t correlated_period_;
+  bool *in_replacer_;  // slot holds an evictable frame
+  size_t *num_refs_;   // number of valid timestamps, at most k_
+  uint64_t *history_;  // k_ timestamps per slot
+  uint64_t current_ts_;
+  size_t size_;
+  std::mutex latch_;
+};
+
+} // namespace cmudb
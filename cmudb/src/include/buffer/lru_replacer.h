@@ -5,26 +5,30 @@
  * all the pages that are unpinned and ready to be swapped. The simplest way to
  * implement LRU is a FIFO queue, but remember to dequeue or enqueue pages when
  * a page changes from unpinned to pinned, or vice-versa.
+ *
+ * The list is intrusive: every frame owns a fixed slot holding the links to
+ * its neighbours, and the slot past the last frame is the head of the
+ * circular list. Values are mapped onto slots by their distance to base, like
+ * in ClockReplacer. Nothing is allocated after construction.
  */
 
 #pragma once
 
+#include <cstdint>
+#include <mutex>
+
 #include "buffer/replacer.h"
-#include "hash/extendible_hash.h"
 
 namespace cmudb {
 
 template <typename T> class LRUReplacer : public Replacer<T> {
 private:
-    struct Node {
-        T val;
-        std::shared_ptr<Node> pre;
-        std::shared_ptr<Node> next;
-        Node() {}
-        Node(T v): val(v), pre(nullptr), next(nullptr) {}
+    struct Link {
+        uint32_t pre;
+        uint32_t next;
     };
 public:
-  LRUReplacer();
+  LRUReplacer(size_t num_frames, T base = T());
 
   ~LRUReplacer();
 
@@ -36,10 +40,22 @@ public:
 
   size_t Size();
 
+  size_t PeekVictims(T *values, size_t max_values);
+
 private:
-    std::shared_ptr<Node> head_, tail_;
-    std::unordered_map<T, std::shared_ptr<Node>> map_;
-    std::mutex latch_;
+  inline size_t SlotOf(const T &value) const {
+    return static_cast<size_t>(value - base_);
+  }
+  inline void Unlink(uint32_t slot);
+  inline void PushFront(uint32_t slot);
+
+  size_t num_frames_;
+  T base_;
+  uint32_t head_;      // sentinel slot, next is the most recently inserted
+  Link *links_;        // num_frames_ + 1 slots, the last one is head_
+  bool *in_replacer_;  // slot holds an evictable frame
+  size_t size_;
+  std::mutex latch_;
 };
 
 } // namespace cmudb
@@ -0,0 +1,70 @@
+/**
+ * page_table.h
+ *
+ * Functionality: Page table of one buffer pool shard. Maps a page id to the
+ * frame currently holding it.
+ *
+ * Open addressing with linear probing over a fixed array of slots, sized
+ * from the number of frames of the shard (at least twice as many slots, as a
+ * power of two), so the table never allocates after construction. A slot is
+ * one 64 bit word packing the page id and the index of the frame, eight
+ * slots share a cache line and a probe never dereferences a frame. Page ids
+ * go through a murmur3 finalizer so that sequential ids do not cluster.
+ * Remove shifts the following entries back instead of leaving tombstones.
+ *
+ * Find never takes a lock: it may race with a concurrent Insert/Remove and
+ * report a miss for a page that is resident, and it may return a frame that
+ * is being replaced. Callers must validate the frame (pin it, then re-check
+ * its page id) and fall back to a locked lookup on a miss.
+ * Insert and Remove must be serialized by the caller (shard latch).
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "hash/hash_table.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+class PageTable : public HashTable<page_id_t, Page *> {
+public:
+  // frames: the capacity frames that can be in the table
+  PageTable(Page *frames, size_t capacity);
+  ~PageTable();
+
+  bool Find(const page_id_t &page_id, Page *&page) override;
+  bool Remove(const page_id_t &page_id) override;
+  void Insert(const page_id_t &page_id, Page *const &page) override;
+
+  inline size_t GetNumSlots() const { return mask_ + 1; }
+
+private:
+  static const uint64_t EMPTY_SLOT = ~static_cast<uint64_t>(0);
+
+  static inline uint32_t Mix(page_id_t page_id) {
+    uint32_t h = static_cast<uint32_t>(page_id);
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+  }
+  inline size_t SlotOf(page_id_t page_id) const { return Mix(page_id) & mask_; }
+  static inline page_id_t KeyOf(uint64_t entry) {
+    return static_cast<page_id_t>(static_cast<uint32_t>(entry >> 32));
+  }
+  static inline uint32_t FrameOf(uint64_t entry) {
+    return static_cast<uint32_t>(entry);
+  }
+
+  Page *frames_;
+  size_t capacity_;
+  size_t mask_;
+  std::atomic<uint64_t> *slots_;
+};
+
+} // namespace cmudb
@@ -17,6 +17,10 @@ public:
   virtual bool Victim(T &value) = 0;
   virtual bool Erase(const T &value) = 0;
   virtual size_t Size() = 0;
+  // copy up to max_values values into values, in the order Victim() would
+  // return them, without removing them. Used to clean pages ahead of the
+  // replacer, a policy that cannot tell its order returns 0
+  virtual size_t PeekVictims(T *values, size_t max_values) { return 0; }
 };
 
 } // namespace cmudb
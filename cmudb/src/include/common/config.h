@@ -20,11 +20,40 @@ extern std::atomic<bool> ENABLE_LOGGING;
 #define INVALID_TXN_ID -1  // representing an invalid txn id
 #define INVALID_LSN -1     // representing an invalid lsn
 #define HEADER_PAGE_ID 0   // the header page id
-#define PAGE_SIZE 512     // size of a data page in byte
+#define PAGE_SIZE 4096    // default size of a data page in byte
+#define MIN_PAGE_SIZE 4096 // page sizes are powers of two within these bounds
+#define MAX_PAGE_SIZE 32768
+#define OLD_FORMAT_PAGE_SIZE 512 // pages of files that do not record their size
+#define DIRECT_IO_ALIGNMENT 4096 // O_DIRECT buffers, offsets and sizes
+#define LOG_BUFFER_PAGES (BUFFER_POOL_SIZE + 1) // size of a log buffer in pages
 #define LOG_BUFFER_SIZE                                                            \
-  ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE) // size of a log buffer in byte
+  (LOG_BUFFER_PAGES * PAGE_SIZE) // size of a log buffer in byte, default page
 #define BUCKET_SIZE 50                 // size of extendible hash bucket
-#define BUFFER_POOL_SIZE 10            // size of buffer pool
+#define HASH_READER_STRIPES 16         // reader counters of an extendible hash
+#define BUFFER_POOL_SIZE 10            // default size of buffer pool
+#define BUFFER_POOL_STATS_STRIPES 16   // counter stripes of a buffer pool
+#define PAGE_CLEANER_CLEAN_TARGET 4    // clean frames kept ahead of eviction
+#define PAGE_CLEANER_MAX_WRITES 16     // page writes per page cleaner round
+#define PAGE_CLEANER_INTERVAL 10       // ms between page cleaner rounds
+#define EVICTION_WRITE_RUN 16          // dirty pages an eviction writes at once
+#define SCAN_RING_SIZE 4               // frames recycled by a sequential scan
+#define READ_AHEAD_PAGES 2             // pages a scan prefetches ahead of it
+#define PREFETCH_WORKERS 2             // I/O threads serving prefetches
+#define ASYNC_IO_QUEUE_DEPTH 64        // asynchronous page I/O in flight
+#define ASYNC_IO_WORKERS 4             // threads of the io_uring fallback
+#define DURABILITY_SYNC_INTERVAL 10    // ms between batched fdatasyncs
+#define DURABILITY_SYNC_PAGES 256      // unsynced page writes forcing a sync
+#define WARM_UP_READ_PAGES 16          // pages per read when warming up a pool
+#define LRU_K_REFERENCES 2             // references remembered by LRU-K
+#define LRU_K_CORRELATED_PERIOD 2      // LRU-K ticks merged into one reference
+#define REDO_WORKERS 4                 // threads applying the log during redo
+#define REDO_BATCH_SIZE 256            // log records handed over at once
+#define REDO_QUEUE_DEPTH 64            // batches queued per redo worker
+#define RECOVERY_READ_SIZE (4 << 20)   // log read ahead by recovery, in bytes
+#define CHECKPOINT_INTERVAL 30000      // ms between fuzzy checkpoints
+#define CHECKPOINT_LOG_SIZE (64 << 20) // log bytes forcing a checkpoint
+#define LOG_SEGMENT_SIZE (16 << 20)    // size of a log segment file in bytes
+#define LOG_RECYCLED_SEGMENTS 4        // truncated log segments kept for reuse
 
 typedef int32_t page_id_t; // page id type
 typedef int32_t txn_id_t;  // transaction id type
@@ -0,0 +1,43 @@
+/**
+ * thread_pool.h
+ *
+ * Fixed set of worker threads serving a FIFO queue of tasks. Used for
+ * background I/O such as read-ahead. Tasks still queued when the pool is
+ * destroyed are dropped, the ones already running are waited for.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cmudb {
+
+class ThreadPool {
+public:
+  ThreadPool(size_t num_threads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  void Submit(std::function<void()> task);
+
+  // number of tasks waiting for a worker
+  size_t GetQueueSize();
+
+private:
+  void WorkerLoop();
+
+  std::vector<std::thread> workers_;
+  std::deque<std::function<void()>> tasks_;
+  bool stopped_;
+  std::mutex latch_;
+  std::condition_variable cv_;
+};
+
+} // namespace cmudb
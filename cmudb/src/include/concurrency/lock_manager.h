@@ -2,6 +2,12 @@
  * lock_manager.h
  *
  * Tuple level lock manager, use wait-die to prevent deadlocks
+ *
+ * Every locked rid has a FIFO queue of requests. A shared request is granted
+ * once only shared requests are ahead of it, an exclusive one once it is at
+ * the head. A transaction may only wait for younger ones (higher id): if an
+ * older transaction holds or waits for a conflicting lock, the requester
+ * dies, it is aborted and the call returns false.
  */
 
 #pragma once
@@ -38,7 +44,32 @@ public:
   /*** END OF APIs ***/
 
 private:
+  enum class LockMode { SHARED, EXCLUSIVE };
+
+  struct Request {
+    Request(txn_id_t txn_id, LockMode mode)
+        : txn_id_(txn_id), mode_(mode), granted_(false) {}
+    txn_id_t txn_id_;
+    LockMode mode_;
+    bool granted_;
+  };
+
+  struct LockQueue {
+    std::list<Request> requests_;
+    std::condition_variable cv_;
+    // a shared holder is waiting to become the exclusive one
+    bool upgrading_ = false;
+  };
+
+  bool Acquire(Transaction *txn, const RID &rid, LockMode mode,
+               std::unique_lock<std::mutex> &lock);
+  bool Die(Transaction *txn, LockQueue &queue, LockMode mode);
+  bool IsGrantable(LockQueue &queue, std::list<Request>::iterator request);
+  void Abort(Transaction *txn);
+
   bool strict_2PL_;
+  std::mutex latch_;
+  std::unordered_map<RID, LockQueue> lock_table_;
 };
 
 } // namespace cmudb
@@ -5,7 +5,11 @@
 
 #pragma once
 #include <atomic>
+#include <mutex>
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "concurrency/lock_manager.h"
@@ -21,9 +25,17 @@ public:
   Transaction *Begin();
   void Commit(Transaction *txn);
   void Abort(Transaction *txn);
+  // (txn id, last lsn) of every transaction that has begun but not ended,
+  // returns the lsn of the oldest begin record among them or INVALID_LSN
+  lsn_t GetActiveTransactions(
+      std::vector<std::pair<txn_id_t, lsn_t>> &active_txns);
 
 private:
   std::atomic<txn_id_t> next_txn_id_;
+  // transactions with a begin record in the log and no commit or abort
+  // record yet, with the lsn of their begin record
+  std::unordered_map<txn_id_t, std::pair<Transaction *, lsn_t>> active_txns_;
+  std::mutex active_latch_;
   LockManager *lock_manager_;
   LogManager *log_manager_;
 };
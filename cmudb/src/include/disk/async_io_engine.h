@@ -0,0 +1,138 @@
+/**
+ * async_io_engine.h
+ *
+ * Asynchronous positional reads and writes for DiskManager. Read and Write
+ * only queue a request, Submit hands everything queued so far over at once,
+ * so a caller can keep many requests in flight for the price of one system
+ * call. Every request completes a future, true if the whole buffer was
+ * transferred. A read that reaches the end of the file fills the rest of the
+ * buffer with zeros, like DiskManager::ReadPages.
+ *
+ * IOUringEngine drives io_uring through its system calls directly, a single
+ * thread reaps the completions. ThreadPoolIOEngine runs blocking pread/pwrite
+ * on worker threads, for kernels (or sandboxes) without io_uring. Create
+ * picks the first one that works.
+ *
+ * At most queue_depth requests are in flight, Read and Write block until one
+ * completes beyond that. Destroying an engine waits for the requests in
+ * flight.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/config.h"
+#include "common/thread_pool.h"
+
+namespace cmudb {
+
+class AsyncIOEngine {
+public:
+  virtual ~AsyncIOEngine() {}
+
+  // data must stay valid until the future is ready
+  virtual std::future<bool> Read(int fd, char *data, size_t size,
+                                 size_t offset) = 0;
+  virtual std::future<bool> Write(int fd, const char *data, size_t size,
+                                  size_t offset) = 0;
+  // start the requests queued so far
+  virtual void Submit() = 0;
+
+  virtual const char *GetName() const = 0;
+
+  // called on the completing thread after every successful write, before
+  // its future is ready. Set it before the first request
+  inline void OnWriteDone(std::function<void()> callback) {
+    on_write_done_ = callback;
+  }
+
+  // io_uring if the kernel lets us use it, worker threads otherwise
+  static AsyncIOEngine *Create(size_t queue_depth = ASYNC_IO_QUEUE_DEPTH);
+
+protected:
+  std::function<void()> on_write_done_;
+};
+
+class IOUringEngine : public AsyncIOEngine {
+public:
+  // throws if io_uring is not available
+  explicit IOUringEngine(size_t queue_depth = ASYNC_IO_QUEUE_DEPTH);
+  ~IOUringEngine();
+
+  std::future<bool> Read(int fd, char *data, size_t size, size_t offset);
+  std::future<bool> Write(int fd, const char *data, size_t size,
+                          size_t offset);
+  void Submit();
+  const char *GetName() const { return "io_uring"; }
+
+  // whether this kernel can set up a ring at all
+  static bool IsSupported();
+
+private:
+  struct Request;
+
+  std::future<bool> Queue(bool is_read, int fd, char *data, size_t size,
+                          size_t offset);
+  // put a request in the submission queue, caller holds latch_
+  void PushLocked(uint8_t opcode, int fd, Request *request);
+  void SubmitLocked();
+  void ReapLoop();
+  void Unmap();
+
+  int ring_fd_;
+  size_t queue_depth_;
+  // rings shared with the kernel, head and tail are free running counters
+  void *sq_ring_;
+  size_t sq_ring_size_;
+  unsigned *sq_head_;
+  unsigned *sq_tail_;
+  unsigned *sq_mask_;
+  unsigned *sq_array_;
+  void *sqes_;
+  size_t sqes_size_;
+  void *cq_ring_;
+  size_t cq_ring_size_;
+  unsigned *cq_head_;
+  unsigned *cq_tail_;
+  unsigned *cq_mask_;
+  void *cqes_;
+
+  unsigned num_queued_; // in the submission queue, not submitted yet
+  size_t num_in_flight_; // queued or submitted, not completed yet
+  std::mutex latch_;
+  std::condition_variable cv_; // a request completed
+  std::thread reaper_;
+};
+
+class ThreadPoolIOEngine : public AsyncIOEngine {
+public:
+  explicit ThreadPoolIOEngine(size_t num_workers = ASYNC_IO_WORKERS,
+                              size_t queue_depth = ASYNC_IO_QUEUE_DEPTH);
+  ~ThreadPoolIOEngine();
+
+  std::future<bool> Read(int fd, char *data, size_t size, size_t offset);
+  std::future<bool> Write(int fd, const char *data, size_t size,
+                          size_t offset);
+  void Submit();
+  const char *GetName() const { return "thread pool"; }
+
+private:
+  std::future<bool> Queue(std::function<bool()> io);
+  void SubmitLocked();
+
+  size_t queue_depth_;
+  std::vector<std::function<void()>> queued_;
+  size_t num_in_flight_;
+  std::mutex latch_;
+  std::condition_variable cv_; // a request completed
+  // declared last, so that it is gone before the members its tasks use
+  ThreadPool workers_;
+};
+
+} // namespace cmudb
@@ -5,31 +5,127 @@
  * database. It also performs read and write of pages to and from disk, and
  * provides a logical file layer within the context of a database management
  * system.
+ *
+ * Pages are read and written with positional pread/pwrite on a file
+ * descriptor, so concurrent reads and writes of different pages do not
+ * serialize. WritePages writes a run of consecutive pages held in separate
+ * buffers (buffer pool frames) with vectored writes. With direct_io the file is opened with O_DIRECT and bypasses
+ * the OS page cache, page buffers should then be aligned to
+ * DIRECT_IO_ALIGNMENT (see AllocateAligned), others go through a bounce
+ * buffer. File systems that do not support O_DIRECT fall back to buffered
+ * I/O.
+ *
+ * Allocated pages are tracked by a FreeSpaceMap in a ".fsm" file next to the
+ * database file, so that deallocated pages are reused and allocation
+ * resumes where it stopped after a restart.
+ *
+ * Page writes are made durable according to the DurabilityMode: NONE leaves
+ * them to the OS, SYNC calls fdatasync before a write returns, and BATCHED
+ * has a background sync thread call fdatasync every sync interval, or as
+ * soon as sync_pages writes have not been synced yet. Sync makes every
+ * completed write durable on demand, in any mode.
+ *
+ * ReadPageAsync/WritePageAsync go through an AsyncIOEngine (io_uring, or
+ * worker threads without it), started on first use. With submit = false the
+ * request waits for SubmitAsyncIO, so a batch is submitted at once.
+ *
+ * The log is a SegmentedLog: ".log" next to the database file is its control
+ * file, the log itself is in fixed-size ".log.<n>" segment files that are
+ * recycled once a checkpoint truncates the log before them.
+ *
+ * The master record in a ".master" file next to the database file tells
+ * recovery where the last checkpoint record is in the log.
  */
 
 #pragma once
 #include <atomic>
-#include <fstream>
+#include <chrono>
+#include <condition_variable>
 #include <future>
+#include <mutex>
 #include <string>
+#include <thread>
 
 #include "common/config.h"
+#include "disk/async_io_engine.h"
+#include "disk/free_space_map.h"
+#include "disk/segmented_log.h"
 
 namespace cmudb {
 
+// when page writes reach the disk, see above
+enum class DurabilityMode { NONE, BATCHED, SYNC };
+
 class DiskManager {
 public:
-  DiskManager(const std::string &db_file);
+  // page_size: page size of a new database file, an existing file keeps the
+  // one recorded in its header page (OLD_FORMAT_PAGE_SIZE if it predates
+  // that)
+  DiskManager(const std::string &db_file, size_t page_size = PAGE_SIZE,
+              bool direct_io = false);
   ~DiskManager();
 
   void WritePage(page_id_t page_id, const char *page_data);
   void ReadPage(page_id_t page_id, char *page_data);
+  void ReadPages(page_id_t page_id, size_t num_pages, char *page_data);
+  // consecutive pages from separate buffers, written with pwritev
+  bool WritePages(page_id_t page_id, size_t num_pages,
+                  const char *const *page_data);
+
+  // the future tells whether the page was transferred, page_data must stay
+  // valid until then
+  std::future<bool> ReadPageAsync(page_id_t page_id, char *page_data,
+                                  bool submit = true);
+  std::future<bool> WritePageAsync(page_id_t page_id, const char *page_data,
+                                   bool submit = true);
+  void SubmitAsyncIO();
+  const char *GetAsyncIOEngineName() { return GetAsyncIO().GetName(); }
+
+  // interval and sync_pages only apply to BATCHED. Not safe to call from
+  // several threads at once
+  void SetDurabilityMode(DurabilityMode mode,
+                         std::chrono::milliseconds interval =
+                             std::chrono::milliseconds(DURABILITY_SYNC_INTERVAL),
+                         size_t sync_pages = DURABILITY_SYNC_PAGES);
+  inline DurabilityMode GetDurabilityMode() const { return durability_mode_; }
+  // fdatasync the db file now
+  bool Sync();
+  inline size_t GetNumSyncs() const { return num_syncs_; }
+  static const char *GetDurabilityModeName(DurabilityMode mode);
+  // "none", "batched" or "sync"
+  static bool ParseDurabilityMode(const std::string &name,
+                                  DurabilityMode &mode);
 
   void WriteLog(char *log_data, int size);
-  bool ReadLog(char *log_data, int size, int offset);
+  bool ReadLog(char *log_data, int size, size_t offset);
+  // end offset of the log, offsets keep growing across truncations
+  size_t GetLogSize();
+  // the log before offset may be recycled
+  void TruncateLog(size_t offset);
+  // where the appends after the one at offset resume, see SegmentedLog
+  size_t GetNextLogRun(size_t offset);
+  // lsn and log offset of the last checkpoint record, synced before it
+  // returns. False on I/O error, or if there is no master record to read
+  bool WriteMasterRecord(lsn_t checkpoint_lsn, size_t offset);
+  bool ReadMasterRecord(lsn_t &checkpoint_lsn, size_t &offset);
 
-  page_id_t AllocatePage();
+  // reuses deallocated pages first, the closest one to hint, see
+  // FreeSpaceMap. INVALID_PAGE_ID if the database file could not be opened
+  page_id_t AllocatePage(page_id_t hint = INVALID_PAGE_ID);
   void DeallocatePage(page_id_t page_id);
+  // deallocated pages waiting to be reused
+  size_t GetNumFreePages();
+
+  inline size_t GetPageSize() const { return page_size_; }
+  size_t GetNumPages();
+  // false if direct_io was not asked for or not supported by the file system
+  // or the page size
+  inline bool IsDirectIO() const { return direct_io_; }
+  // power of two between MIN_PAGE_SIZE and MAX_PAGE_SIZE
+  static bool IsValidPageSize(size_t page_size);
+  // zeroed memory aligned to DIRECT_IO_ALIGNMENT, release with FreeAligned
+  static char *AllocateAligned(size_t size);
+  static void FreeAligned(char *data);
 
   int GetNumFlushes() const;
   bool GetFlushState() const;
@@ -37,14 +133,45 @@ public:
   inline bool HasFlushLogFuture() { return flush_log_f_ != nullptr; }
 
 private:
-  int GetFileSize(const std::string &name);
-  // stream to write log file
-  std::fstream log_io_;
+  ssize_t GetFileSize(const std::string &name);
+  size_t ReadRecordedPageSize();
+  void EnableDirectIO();
+  bool NeedsBounce(const char *data) const;
+  bool WritePageData(page_id_t page_id, const char *page_data);
+  void ExtendFileSize(size_t end);
+  void PagesWritten(size_t num_pages);
+  void StartSyncThread();
+  void StopSyncThread();
+  AsyncIOEngine &GetAsyncIO();
+  // log files, appended to by WriteLog
+  SegmentedLog *log_;
   std::string log_name_;
-  // stream to write db file
-  std::fstream db_io_;
+  std::string master_name_;
+  // db file, only accessed with positional reads and writes
+  int db_fd_;
   std::string file_name_;
-  std::atomic<page_id_t> next_page_id_;
+  size_t page_size_;
+  bool direct_io_;
+  // size of the db file, kept up to date by the writes
+  std::atomic<size_t> db_file_size_;
+  // allocated pages, kept in a file next to the db file
+  FreeSpaceMap *free_space_map_;
+  // durability
+  std::atomic<DurabilityMode> durability_mode_;
+  std::chrono::milliseconds sync_interval_;
+  std::atomic<size_t> sync_pages_;
+  // page writes completed, and how many of them the last sync covered
+  std::atomic<uint64_t> pages_written_;
+  std::atomic<uint64_t> pages_synced_;
+  std::atomic<size_t> num_syncs_;
+  std::thread *sync_thread_ = nullptr;
+  bool sync_running_ = false;
+  std::mutex sync_latch_;
+  std::condition_variable sync_cv_;
+  std::once_flag async_io_started_;
+  AsyncIOEngine *async_io_ = nullptr;
+  // the buffer of the last WriteLog, log buffers must be swapped
+  const char *last_log_data_ = nullptr;
   int num_flushes_;
   bool flush_log_;
   std::future<void> *flush_log_f_;
@@ -0,0 +1,76 @@
+/**
+ * free_space_map.h
+ *
+ * Tracks which pages of a database file are in use, so that deallocated
+ * pages are handed out again instead of growing the file.
+ *
+ * The map lives in its own file next to the database file, so that page ids
+ * of the database file keep their meaning (page 0 is the header page). It is
+ * a meta page followed by bitmap pages, one bit per page of the database
+ * file, set if the page is allocated. Pages at or beyond the high water mark
+ * have never been allocated.
+ *
+ * Meta page format (size in byte):
+ *  --------------------------------------------------
+ * | Magic (4) | PageSize (4) | HighWaterMark (4) | ...
+ *  --------------------------------------------------
+ *
+ * Every change is written to the file (not synced) before Allocate returns,
+ * so a page id is never handed out twice across a restart after the process
+ * exits or crashes; such a crash can only leak a freed page. An OS crash or
+ * power loss may lose recent changes like any other unsynced write. A
+ * missing or unreadable map counts every page of the database file as
+ * allocated.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+class FreeSpaceMap {
+public:
+  // num_file_pages: pages in the database file, an empty file starts over
+  // with an empty map
+  FreeSpaceMap(const std::string &file_name, size_t page_size,
+               size_t num_file_pages);
+  ~FreeSpaceMap();
+
+  // a free page, the closest one to hint if there is a choice, or a new
+  // page at the high water mark
+  page_id_t Allocate(page_id_t hint = INVALID_PAGE_ID);
+  // false if page_id is not allocated
+  bool Free(page_id_t page_id);
+
+  bool IsAllocated(page_id_t page_id);
+  page_id_t GetHighWaterMark();
+  size_t GetNumFreePages();
+
+private:
+  inline bool TestBit(size_t bit) const {
+    return (bits_[bit / 64] >> (bit % 64)) & 1;
+  }
+  inline void FlipBit(size_t bit) { bits_[bit / 64] ^= uint64_t(1) << (bit % 64); }
+  page_id_t FindFree(page_id_t hint) const;
+  void Load(size_t num_file_pages);
+  void Grow(size_t num_pages);
+  void WriteBitmapPage(size_t bit);
+  void WriteMetaPage();
+  void WriteFully(const char *data, size_t size, size_t offset);
+
+  int fd_;
+  size_t page_size_;
+  size_t words_per_page_; // 64 bit words of a bitmap page
+  page_id_t high_water_mark_;
+  size_t num_free_;
+  std::vector<uint64_t> bits_; // whole bitmap pages
+  std::mutex latch_;
+};
+
+} // namespace cmudb
@@ -0,0 +1,99 @@
+/**
+ * segmented_log.h
+ *
+ * The log file of a database, split into segment files of a fixed size.
+ *
+ * Log offsets are logical, they keep growing over the life of the database.
+ * The segment holding offset o is the file "<name>.<o / segment_size>". A
+ * segment is written with zeros in full before the log reaches it (in the
+ * background, once the segment before it is half full), so appending to the
+ * log never allocates blocks or changes a file size on the commit path.
+ *
+ * Truncate drops the segments before an offset. Up to recycled_segments of
+ * them are kept and renamed to become the next segments, which are then
+ * already allocated and written; the others are deleted. A recycled segment
+ * still holds old log records, so every append is followed by a few zero
+ * bytes, written together with it, and a recycled segment starts with
+ * zeros: the log ends before bytes that do not parse as a log record. A
+ * write torn by a crash may still leave old records right after the end,
+ * recovery tells them apart by their lsns (see LogRecovery).
+ *
+ * The control file "<name>" keeps the first segment and where each run of
+ * appends starts. The end of the log is not recorded anywhere, a log that is
+ * opened again appends from the next segment on and readers skip from the
+ * end of a run to the start of the next one (see GetNextRun).
+ *
+ * Control file format (size in byte):
+ *  ----------------------------------------------------------------------
+ * | Magic (4) | NumRuns (4) | SegmentSize (8) | FirstSegment (8) | Run (8)*
+ *  ----------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+class SegmentedLog {
+public:
+  // segment_size applies to a new log, an existing one keeps its own
+  SegmentedLog(const std::string &name,
+               size_t segment_size = LOG_SEGMENT_SIZE,
+               size_t recycled_segments = LOG_RECYCLED_SEGMENTS);
+  ~SegmentedLog();
+
+  // write at the end of the log and sync, false on I/O error
+  bool Append(const char *data, size_t size);
+  // zeros past the end of the log, false if offset is at or past it
+  bool Read(char *data, size_t size, size_t offset);
+  // the segments before the one holding offset are not needed any more
+  void Truncate(size_t offset);
+  // the start of the first run of appends after offset, the end of the log
+  // if there is none
+  size_t GetNextRun(size_t offset);
+
+  size_t GetStart();
+  size_t GetEnd();
+  inline size_t GetSegmentSize() const { return segment_size_; }
+  // segments that are part of the log, and truncated ones kept for reuse
+  size_t GetNumSegments();
+  size_t GetNumFreeSegments();
+
+private:
+  std::string SegmentName(uint64_t segment) const;
+  bool LoadControl();
+  bool WriteControl();
+  void ScanSegments(bool valid);
+  int OpenSegment(uint64_t segment);
+  int PrepareSegment(uint64_t segment);
+  void PrepareAhead(uint64_t segment);
+
+  std::string name_;
+  size_t segment_size_;
+  size_t recycled_segments_;
+  int control_fd_;
+  uint64_t first_segment_;
+  // start offsets of the runs of appends, ascending
+  std::vector<uint64_t> runs_;
+  uint64_t end_;
+  // runs_ has the appends of this SegmentedLog
+  bool run_recorded_;
+  // open segments of the log, by number
+  std::map<uint64_t, int> segments_;
+  // truncated segment files, oldest first
+  std::deque<uint64_t> free_segments_;
+  // the next segment being written in the background
+  std::future<void> prepare_;
+  std::mutex latch_;
+};
+
+} // namespace cmudb
@@ -5,10 +5,29 @@
  * Functionality: The buffer pool manager must maintain a page table to be able
  * to quickly map a PageId to its corresponding memory location; or alternately
  * report that the PageId does not match any currently-buffered page.
+ *
+ * Concurrency: every bucket has its own latch, the directory is read without
+ * any lock. An operation looks its bucket up in the current directory,
+ * latches it and checks that the directory still maps the key to it,
+ * otherwise it retries. Splits are serialized by a directory latch, taken
+ * while holding the latch of the overflowing bucket. Doubling copies the
+ * directory and publishes the copy atomically, so readers never wait for it.
+ *
+ * A directory replaced by a doubling is freed once every operation that
+ * could still be reading it has finished (epoch based reclamation): readers
+ * are counted per epoch, and the writer that retired the directory advances
+ * the epoch and waits for the readers of the previous one to drain, after
+ * it released its latches.
+ *
+ * Removes combine a bucket with its buddy once both fit in half a bucket and
+ * halve the directory when no bucket needs the global depth, so the table
+ * shrinks back after churn. Merged buckets are retired the same way as
+ * directories, as readers may still be waiting on their latch.
  */
 
 #pragma once
 
+#include <atomic>
 #include <cstdlib>
 #include <vector>
 #include <mutex>
@@ -16,6 +35,7 @@
 #include <memory>
 #include <string>
 
+#include "common/config.h"
 #include "hash/hash_table.h"
 
 namespace cmudb {
@@ -24,14 +44,29 @@ template <typename K, typename V>
 class ExtendibleHash : public HashTable<K, V> {
 private:
     struct Bucket {
-        int depth;
+        std::atomic<int> depth;
+        std::mutex latch;
         std::unordered_map<K, V> map;
         Bucket(int d): depth(d) {}
     };
+    struct Directory {
+        int globalDepth;
+        std::atomic<Bucket *> *slots;
+        Directory(int d): globalDepth(d), slots(new std::atomic<Bucket *>[1 << d]) {}
+        ~Directory() { delete[] slots; }
+        inline size_t Size() const { return static_cast<size_t>(1) << globalDepth; }
+        inline std::atomic<Bucket *> &SlotOf(size_t hash) { return slots[hash & (Size() - 1)]; }
+    };
+    // number of operations inside the directory, one counter per cache line
+    struct ReaderCount {
+        std::atomic<size_t> count;
+        char padding[64];
+    };
 public:
   // constructor
   ExtendibleHash(size_t size);
   ExtendibleHash();
+  ~ExtendibleHash();
   // helper function to generate hash addressing
   size_t HashKey(const K &key);
   // helper function to get global & local depth
@@ -44,9 +79,25 @@ public:
   void Insert(const K &key, const V &value) override;
 
 private:
-  int globalDepth_;
+  size_t Enter() const;
+  void Exit(size_t token) const;
+  Bucket *LatchBucket(size_t hash);
+  Bucket *Split(Bucket *bucket);
+  bool Merge(Bucket *bucket, size_t hash);
+  void Shrink();
+  void Reclaim();
+
   int maxSize_;
-  std::vector<std::shared_ptr<Bucket>> buckets_;
-  mutable std::mutex latch_;
+  std::atomic<Directory *> directory_;
+  // serializes directory updates
+  std::mutex dirLatch_;
+  // epochs of the directory readers
+  mutable std::atomic<uint64_t> epoch_;
+  mutable ReaderCount readers_[2][HASH_READER_STRIPES];
+  // directories and buckets waiting for their readers to leave
+  std::mutex retireLatch_;
+  std::vector<Directory *> retired_;
+  std::vector<Bucket *> retiredBuckets_;
+  std::mutex reclaimLatch_;
 };
 } // namespace cmudb
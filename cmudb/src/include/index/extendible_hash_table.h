@@ -0,0 +1,84 @@
+/**
+ * extendible_hash_table.h
+ *
+ * Implementation of a disk resident extendible hash table, made of one
+ * directory page and bucket pages.
+ * (1) We only support unique key
+ * (2) support insert & remove, a point lookup fetches the directory and the
+ * bucket page only
+ * (3) Buckets split and the directory doubles as the table grows, up to the
+ * directory that fills a page. Past that, buckets grow overflow pages.
+ * Buckets are not merged back when keys are removed.
+ *
+ * Concurrency: lookups and removes hold the directory page read latch, and a
+ * latch on the first page of their bucket which covers its overflow pages.
+ * Inserts do the same as long as the bucket has room; an insert that has to
+ * split takes the directory page write latch instead.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "concurrency/transaction.h"
+#include "page/hash_table_bucket_page.h"
+#include "page/hash_table_directory_page.h"
+
+namespace cmudb {
+
+#define HASH_TABLE_TYPE                                                        \
+  ExtendibleHashTable<KeyType, ValueType, KeyComparator>
+
+INDEX_TEMPLATE_ARGUMENTS
+class ExtendibleHashTable {
+public:
+  // creates the directory and its first bucket when directory_page_id is
+  // INVALID_PAGE_ID, records the directory page id in the header page
+  explicit ExtendibleHashTable(const std::string &name,
+                               BufferPoolManager *buffer_pool_manager,
+                               const KeyComparator &comparator,
+                               page_id_t directory_page_id = INVALID_PAGE_ID);
+
+  // Insert a key-value pair into this hash table.
+  bool Insert(const KeyType &key, const ValueType &value,
+              Transaction *transaction = nullptr);
+
+  // Remove a key and its value from this hash table.
+  bool Remove(const KeyType &key, Transaction *transaction = nullptr);
+
+  // return the value associated with a given key
+  bool GetValue(const KeyType &key, std::vector<ValueType> &result,
+                Transaction *transaction = nullptr);
+
+  page_id_t GetDirectoryPageId() const { return directory_page_id_; }
+  // expose for test purpose
+  int GetGlobalDepth();
+
+private:
+  enum class InsertResult { INSERTED = 0, DUPLICATE, FULL };
+
+  uint32_t Hash(const KeyType &key) const;
+
+  Page *FetchPage(page_id_t page_id);
+
+  Page *NewBucket();
+
+  HASH_TABLE_BUCKET_TYPE *BucketOf(Page *page) const {
+    return reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(page->GetData());
+  }
+
+  InsertResult InsertIntoBucket(Page *head, const KeyType &key,
+                                const ValueType &value, bool overflow);
+
+  void SplitBucket(HashTableDirectoryPage *directory, uint32_t slot);
+
+  void UpdateDirectoryPageId();
+
+  // member variable
+  std::string index_name_;
+  page_id_t directory_page_id_;
+  BufferPoolManager *buffer_pool_manager_;
+  KeyComparator comparator_;
+};
+
+} // namespace cmudb
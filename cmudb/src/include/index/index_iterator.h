@@ -34,15 +34,21 @@ public:
               bufferPoolManager_->UnpinPage(leaf_->GetPageId(), false);
               leaf_ = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
               index_ = 0;
+              ReadAhead();
           }
       }
       return *this;
   }
 
 private:
+    void ReadAhead();
+    static page_id_t ReadNextPageId(const char *data);
+
     B_PLUS_TREE_LEAF_PAGE_TYPE *leaf_;
     int index_;
     BufferPoolManager *bufferPoolManager_;
+    // leaves left before the next read-ahead is issued
+    size_t pagesUntilReadAhead_ = 0;
 };
 
 } // namespace cmudb
@@ -0,0 +1,82 @@
+/**
+ * checkpoint_manager.h
+ * Take fuzzy checkpoints, so that recovery only reads the log written since
+ * about the last one.
+ *
+ * A checkpoint does not stop transactions or page writes. It notes the next
+ * lsn, collects the active transactions with their last lsn and the dirty
+ * pages of the buffer pool with the lsn of their oldest change that is not
+ * on disk (recLSN), and logs both tables in a CHECKPOINT record. Recovery
+ * starts at the oldest of the recLSNs and of the first records of the
+ * active transactions, and skips the changes before the checkpoint to pages
+ * that were not dirty then, or that only got dirty later. The master record
+ * points recovery at the checkpoint record once it is durable, the log
+ * before the start of recovery is truncated then.
+ *
+ * Pages that have stayed dirty since before the previous checkpoint are
+ * written back first, so that the start of recovery keeps moving forward.
+ * The checkpoint thread takes a checkpoint every interval, or as soon as
+ * log_size bytes were logged since the last one.
+ */
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "buffer/buffer_pool_manager.h"
+#include "concurrency/transaction_manager.h"
+#include "logging/log_manager.h"
+
+namespace cmudb {
+
+class CheckpointManager {
+public:
+  CheckpointManager(TransactionManager *transaction_manager,
+                    LogManager *log_manager,
+                    BufferPoolManager *buffer_pool_manager,
+                    DiskManager *disk_manager)
+      : transaction_manager_(transaction_manager), log_manager_(log_manager),
+        buffer_pool_manager_(buffer_pool_manager), disk_manager_(disk_manager),
+        last_begin_lsn_(INVALID_LSN), last_log_size_(0), num_checkpoints_(0),
+        truncate_log_(true), running_(false), checkpoint_thread_(nullptr) {}
+
+  ~CheckpointManager() { StopCheckpointThread(); }
+
+  // take a checkpoint now, returns the lsn of its record or INVALID_LSN
+  // without logging
+  lsn_t Checkpoint();
+
+  void RunCheckpointThread(
+      std::chrono::milliseconds interval =
+          std::chrono::milliseconds(CHECKPOINT_INTERVAL),
+      size_t log_size = CHECKPOINT_LOG_SIZE);
+  void StopCheckpointThread();
+
+  inline size_t GetNumCheckpoints() const { return num_checkpoints_; }
+  // keep the whole log, recovery can then still start from the beginning
+  inline void SetTruncateLog(bool truncate_log) {
+    truncate_log_ = truncate_log;
+  }
+
+private:
+  TransactionManager *transaction_manager_;
+  LogManager *log_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+  DiskManager *disk_manager_;
+  // one checkpoint at a time
+  std::mutex checkpoint_latch_;
+  // next lsn when the last checkpoint began, and the log size after it
+  lsn_t last_begin_lsn_;
+  std::atomic<size_t> last_log_size_;
+  std::atomic<size_t> num_checkpoints_;
+  std::atomic<bool> truncate_log_;
+  // checkpoint thread
+  bool running_;
+  std::thread *checkpoint_thread_;
+  std::mutex latch_;
+  std::condition_variable cv_;
+};
+
+} // namespace cmudb
@@ -3,13 +3,32 @@
  * log manager maintain a separate thread that is awaken when the log buffer is
  * full or time out(every X second) to write log buffer's content into disk log
  * file.
+ *
+ * Records are appended to one of two buffers while the flush thread writes
+ * the other one out, the two are swapped on every flush. Appending does not
+ * take the latch: a single atomic step on reserve_ hands out the lsn and the
+ * slot in the buffer, then every writer serializes its record into its slot
+ * in parallel. The flush thread closes the buffer and waits until all of its
+ * slots are filled before writing it, so only complete records reach disk.
+ * A flush starts when the log buffer is full, after LOG_TIMEOUT, or when
+ * somebody forces the log with Flush. Transactions that force the log while
+ * a flush is in progress are served together by the next one, so a group of
+ * commits shares one write and one sync (group commit).
+ *
+ * The log manager remembers the log file offset of an lsn every
+ * RECOVERY_READ_SIZE bytes or so, which tells a checkpoint where in the log
+ * file recovery has to start.
  */
 
 #pragma once
 #include <algorithm>
+#include <atomic>
+#include <cassert>
 #include <condition_variable>
 #include <future>
+#include <map>
 #include <mutex>
+#include <thread>
 
 #include "disk/disk_manager.h"
 #include "logging/log_record.h"
@@ -19,18 +38,25 @@ namespace cmudb {
 class LogManager {
 public:
   LogManager(DiskManager *disk_manager)
-      : next_lsn_(0), persistent_lsn_(INVALID_LSN),
-        disk_manager_(disk_manager) {
-    // TODO: you may intialize your own defined memeber variables here
-    log_buffer_ = new char[LOG_BUFFER_SIZE];
-    flush_buffer_ = new char[LOG_BUFFER_SIZE];
+      : reserve_(0), persistent_lsn_(INVALID_LSN),
+        log_buffer_size_(LOG_BUFFER_PAGES * disk_manager->GetPageSize()),
+        flush_requested_(false), flushing_(false), running_(false),
+        flush_thread_(nullptr), disk_manager_(disk_manager),
+        log_size_(disk_manager->GetLogSize()) {
+    assert(log_buffer_size_ <= OFFSET_MASK);
+    log_offsets_[0] = log_size_;
+    for (int i = 0; i < 2; ++i) {
+      buffers_[i] = new char[log_buffer_size_];
+      filled_[i] = 0;
+    }
   }
 
   ~LogManager() {
-    delete[] log_buffer_;
-    delete[] flush_buffer_;
-    log_buffer_ = nullptr;
-    flush_buffer_ = nullptr;
+    StopFlushThread();
+    for (int i = 0; i < 2; ++i) {
+      delete[] buffers_[i];
+      buffers_[i] = nullptr;
+    }
   }
   // spawn a separate thread to wake up periodically to flush
   void RunFlushThread();
@@ -38,31 +64,72 @@ public:
 
   // append a log record into log buffer
   lsn_t AppendLogRecord(LogRecord &log_record);
+  // force the log out up to lsn and wait until it is on disk
+  void Flush(lsn_t lsn);
 
   // get/set helper functions
   inline lsn_t GetPersistentLSN() { return persistent_lsn_; }
   inline void SetPersistentLSN(lsn_t lsn) { persistent_lsn_ = lsn; }
-  inline char *GetLogBuffer() { return log_buffer_; }
+  inline char *GetLogBuffer() { return buffers_[BufferOf(reserve_)]; }
+  inline size_t GetLogBufferSize() const { return log_buffer_size_; }
+  // lsn of the next record appended
+  inline lsn_t GetNextLSN() { return LsnOf(reserve_); }
+  // continue the lsns of an existing log, before anything is appended
+  void SetNextLSN(lsn_t lsn);
+  // bytes of the log file, including what this log manager wrote
+  inline size_t GetLogSize() { return log_size_; }
+  // an offset of the log file at or before the record with lsn
+  size_t GetLogOffset(lsn_t lsn);
 
 private:
-  // TODO: you may add your own member variables
-  // also remember to change constructor accordingly
+  void FlushLoop();
+  void FlushBuffer(std::unique_lock<std::mutex> &lock);
+  void WaitForRoom(uint64_t reserve);
+  static void SerializeLogRecord(const LogRecord &log_record, char *data);
 
-  // atomic counter, record the next log sequence number
-  std::atomic<lsn_t> next_lsn_;
+  // reserve_ packs the next lsn (high 32 bits), the buffer appended to (bit
+  // 31) and the bytes of it handed out so far (low 31 bits)
+  static const uint64_t OFFSET_MASK = (1ULL << 31) - 1;
+  static inline lsn_t LsnOf(uint64_t reserve) { return reserve >> 32; }
+  static inline int BufferOf(uint64_t reserve) { return (reserve >> 31) & 1; }
+  static inline size_t OffsetOf(uint64_t reserve) {
+    return reserve & OFFSET_MASK;
+  }
+  static inline uint64_t Reserve(lsn_t lsn, int buffer, size_t offset) {
+    return (static_cast<uint64_t>(lsn) << 32) |
+           (static_cast<uint64_t>(buffer) << 31) | offset;
+  }
+
+  // next lsn and the free space of the log buffer, taken in one step
+  std::atomic<uint64_t> reserve_;
   // log records before & include persistent_lsn_ have been written to disk
   std::atomic<lsn_t> persistent_lsn_;
-  // log buffer related
-  char *log_buffer_;
-  char *flush_buffer_;
+  // log buffer related, sized in pages of the database file
+  size_t log_buffer_size_;
+  char *buffers_[2];
+  // bytes of each buffer whose records are completely serialized
+  std::atomic<size_t> filled_[2];
+  // somebody waits for the log buffer to be written
+  bool flush_requested_;
+  // the closed buffer is being written
+  bool flushing_;
+  bool running_;
   // latch to protect shared member variables
   std::mutex latch_;
   // flush thread
   std::thread *flush_thread_;
   // for notifying flush thread
   std::condition_variable cv_;
+  // the log buffer has room again
+  std::condition_variable append_cv_;
+  // persistent_lsn_ moved on
+  std::condition_variable flushed_cv_;
   // disk manager
   DiskManager *disk_manager_;
+  // log file size and the offsets of the first records of some buffers
+  // written, by lsn. Updated under the latch
+  std::atomic<size_t> log_size_;
+  std::map<lsn_t, size_t> log_offsets_;
 };
 
 } // namespace cmudb
@@ -21,11 +21,18 @@
  *------------------------------------------------------------------------------
  * For new page type log record
  *-------------------------------------------------------------
- * | HEADER | prev_page_id |
+ * | HEADER | prev_page_id | page_id |
  *-------------------------------------------------------------
+ * For checkpoint type log record, log_offset (8 bytes) is where redo starts
+ *------------------------------------------------------------------------------
+ * | HEADER | begin_lsn | log_offset | txn_count | (txn_id, last_lsn)* |
+ * | page_count | (page_id, rec_lsn)* |
+ *------------------------------------------------------------------------------
  */
 #pragma once
 #include <cassert>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "table/tuple.h"
@@ -44,6 +51,8 @@ enum class LogRecordType {
   ABORT,
   // when create a new page in heap table
   NEWPAGE,
+  // active transactions and dirty pages as of a fuzzy checkpoint
+  CHECKPOINT,
 };
 
 class LogRecord {
@@ -93,12 +102,27 @@ public:
 
   // constructor for NEWPAGE type
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type,
-            page_id_t page_id)
+            page_id_t prev_page_id, page_id_t page_id)
       : size_(HEADER_SIZE), lsn_(INVALID_LSN), txn_id_(txn_id),
         prev_lsn_(prev_lsn), log_record_type_(log_record_type),
-        prev_page_id_(page_id) {
+        prev_page_id_(prev_page_id), page_id_(page_id) {
+    // calculate log record size
+    size_ = HEADER_SIZE + 2 * sizeof(page_id_t);
+  }
+
+  // constructor for CHECKPOINT type
+  LogRecord(lsn_t begin_lsn, size_t log_offset,
+            const std::vector<std::pair<txn_id_t, lsn_t>> &active_txns,
+            const std::vector<std::pair<page_id_t, lsn_t>> &dirty_pages)
+      : lsn_(INVALID_LSN), txn_id_(INVALID_TXN_ID), prev_lsn_(INVALID_LSN),
+        log_record_type_(LogRecordType::CHECKPOINT), begin_lsn_(begin_lsn),
+        log_offset_(log_offset), active_txns_(active_txns),
+        dirty_pages_(dirty_pages) {
     // calculate log record size
-    size_ = HEADER_SIZE + sizeof(page_id_t);
+    size_ = HEADER_SIZE + sizeof(lsn_t) + sizeof(uint64_t) +
+            2 * sizeof(int32_t) +
+            active_txns.size() * (sizeof(txn_id_t) + sizeof(lsn_t)) +
+            dirty_pages.size() * (sizeof(page_id_t) + sizeof(lsn_t));
   }
 
   ~LogRecord() {}
@@ -111,6 +135,20 @@ public:
 
   inline page_id_t GetNewPageRecord() { return prev_page_id_; }
 
+  inline page_id_t GetNewPageId() { return page_id_; }
+
+  inline lsn_t GetBeginLSN() { return begin_lsn_; }
+
+  inline size_t GetLogOffset() { return log_offset_; }
+
+  inline std::vector<std::pair<txn_id_t, lsn_t>> &GetActiveTxns() {
+    return active_txns_;
+  }
+
+  inline std::vector<std::pair<page_id_t, lsn_t>> &GetDirtyPages() {
+    return dirty_pages_;
+  }
+
   inline int32_t GetSize() { return size_; }
 
   inline lsn_t GetLSN() { return lsn_; }
@@ -158,6 +196,14 @@ private:
 
   // case4: for new page opeartion
   page_id_t prev_page_id_ = INVALID_PAGE_ID;
+  page_id_t page_id_ = INVALID_PAGE_ID;
+
+  // case5: for checkpoint, the lsn when it began, where redo starts, and the
+  // active transaction and dirty page tables
+  lsn_t begin_lsn_ = INVALID_LSN;
+  uint64_t log_offset_ = 0;
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txns_;
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages_;
   const static int HEADER_SIZE = 20;
 }; // namespace cmudb
 
@@ -1,12 +1,31 @@
 /**
  * recovery_manager.h
  * Read log file from disk, redo and undo
+ *
+ * Redo can run in parallel. The calling thread reads the log in large
+ * chunks, deserializes the records and hands every one of them to the redo
+ * worker owning its page (page id modulo the number of workers). A worker
+ * applies the records of its pages in log order, so every page ends up as
+ * if the whole log was replayed by one thread. The active transaction table
+ * is kept by the reading thread.
+ *
+ * With a master record, redo starts where the last checkpoint says, and a
+ * change from before the checkpoint is only applied to a page of its dirty
+ * page table that has been dirty since at least that change.
+ *
+ * The log ends at the first bytes that are not a log record, or at a record
+ * whose lsn does not follow the one before it. If the log was appended to
+ * again after a restart, reading resumes at the next run of appends (see
+ * SegmentedLog).
  */
 
 #pragma once
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/lock_manager.h"
@@ -14,14 +33,20 @@
 
 namespace cmudb {
 
+class TablePage;
+
 class LogRecovery {
 public:
   LogRecovery(DiskManager *disk_manager,
                     BufferPoolManager *buffer_pool_manager)
       : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager),
-        offset_(0) {
+        begin_lsn_(INVALID_LSN), next_lsn_(0), expected_lsn_(INVALID_LSN),
+        offset_(0), pos_(0), end_(0),
+        log_buffer_size_(std::max<size_t>(
+            RECOVERY_READ_SIZE,
+            LOG_BUFFER_PAGES * disk_manager->GetPageSize())) {
     // global transaction through recovery phase
-    log_buffer_ = new char[LOG_BUFFER_SIZE];
+    log_buffer_ = new char[log_buffer_size_];
   }
 
   ~LogRecovery() {
@@ -29,21 +54,62 @@ public:
     log_buffer_ = nullptr;
   }
 
-  void Redo();
+  // num_workers = 0 applies the log in the calling thread
+  void Redo(size_t num_workers = REDO_WORKERS);
   void Undo();
-  bool DeserializeLogRecord(const char *data, LogRecord &log_record);
+  // lsn after the last record of the log, as of the last Redo
+  inline lsn_t GetNextLSN() const { return next_lsn_; }
+  bool DeserializeLogRecord(const char *data, size_t size,
+                            LogRecord &log_record);
 
 private:
-  // TODO: you can add whatever member variable here
-  // Don't forget to initialize newly added variable in constructor
+  // log records for one redo worker, in log order
+  struct RedoQueue {
+    std::deque<std::vector<LogRecord *>> batches_;
+    bool done_ = false;
+    std::mutex latch_;
+    std::condition_variable cv_;
+  };
+
+  // where a record of an active transaction is, and the one before it
+  struct LogLocation {
+    size_t offset_;
+    lsn_t prev_lsn_;
+  };
+
+  bool ReadCheckpoint();
+  bool ReadNextLogRecord(LogRecord &log_record, size_t &offset);
+  void TrackTransaction(const LogRecord &log_record, size_t offset);
+  void Dispatch(RedoQueue &queue, std::vector<LogRecord *> &batch);
+  void RunRedoWorker(RedoQueue &queue, int partition, size_t num_partitions);
+  void RedoLogRecord(LogRecord &log_record, int partition,
+                     size_t num_partitions);
+  bool NeedsRedo(page_id_t page_id, lsn_t lsn) const;
+  void UndoLogRecord(LogRecord &log_record);
+  TablePage *FetchTablePage(page_id_t page_id);
+  void ReleaseTablePage(TablePage *page, bool is_dirty);
+  static RID &GetRID(LogRecord &log_record);
+
   DiskManager *disk_manager_;
   BufferPoolManager *buffer_pool_manager_;
   // maintain active transactions and its corresponds latest lsn
   std::unordered_map<txn_id_t, lsn_t> active_txn_;
-  // mapping log sequence number to log file offset, for undo purpose
-  std::unordered_map<lsn_t, int> lsn_mapping_;
-  // log buffer related
-  int offset_;
+  // mapping log sequence number to log file offset, for undo purpose, only
+  // kept for records of active transactions
+  std::unordered_map<lsn_t, LogLocation> lsn_mapping_;
+  // next lsn when the checkpoint redo starts from began, and its dirty page
+  // table, INVALID_LSN without a checkpoint
+  lsn_t begin_lsn_;
+  std::unordered_map<page_id_t, lsn_t> dirty_pages_;
+  lsn_t next_lsn_;
+  // lsn of the next record of the run being read, INVALID_LSN at its start
+  lsn_t expected_lsn_;
+  // log buffer related, it holds the log from offset_ on, end_ bytes of it
+  // are read and pos_ of them deserialized
+  size_t offset_;
+  size_t pos_;
+  size_t end_;
+  size_t log_buffer_size_;
   char *log_buffer_;
 };
 
@@ -0,0 +1,66 @@
+/**
+ * hash_table_bucket_page.h
+ *
+ * Bucket of a disk resident extendible hash index, stores indexed key and
+ * record id pairs in no particular order. Only support unique key.
+ *
+ * A bucket that can not split any more, because its local depth reached the
+ * max depth of the directory, grows a chain of overflow pages linked through
+ * NextPageId.
+ *
+ * Bucket page format:
+ *  ----------------------------------------------------------------------
+ * | HEADER | KEY(1) + RID(1) | KEY(2) + RID(2) | ... | KEY(n) + RID(n)
+ *  ----------------------------------------------------------------------
+ *
+ *  Header format (size in byte, 20 bytes in total):
+ *  ---------------------------------------------------------------------
+ * | PageId (4) | LSN (4) | CurrentSize (4) | MaxSize (4) | NextPageId (4) |
+ *  ---------------------------------------------------------------------
+ */
+#pragma once
+
+#include <utility>
+
+#include "page/b_plus_tree_page.h"
+
+namespace cmudb {
+#define HASH_TABLE_BUCKET_TYPE                                                 \
+  HashTableBucketPage<KeyType, ValueType, KeyComparator>
+
+INDEX_TEMPLATE_ARGUMENTS
+class HashTableBucketPage {
+
+public:
+  // After creating a new bucket page from buffer pool, must call initialize
+  // method to set default values
+  void Init(page_id_t page_id, size_t page_size = PAGE_SIZE);
+  // helper methods
+  page_id_t GetPageId() const;
+  void SetLSN(lsn_t lsn = INVALID_LSN);
+  int GetSize() const;
+  int GetMaxSize() const;
+  bool IsFull() const;
+  page_id_t GetNextPageId() const;
+  void SetNextPageId(page_id_t next_page_id);
+  KeyType KeyAt(int index) const;
+  const MappingType &GetItem(int index);
+
+  // insert and delete methods
+  void Insert(const KeyType &key, const ValueType &value);
+  bool Lookup(const KeyType &key, ValueType &value,
+              const KeyComparator &comparator) const;
+  bool Remove(const KeyType &key, const KeyComparator &comparator);
+  void RemoveAt(int index);
+
+private:
+  int KeyIndex(const KeyType &key, const KeyComparator &comparator) const;
+
+  page_id_t page_id_;
+  lsn_t lsn_;
+  int size_;
+  int max_size_;
+  page_id_t next_page_id_;
+  MappingType array[0];
+};
+} // namespace cmudb
@@ -0,0 +1,63 @@
+/**
+ * hash_table_directory_page.h
+ *
+ * Directory of a disk resident extendible hash index. Slot i points to the
+ * bucket page holding the keys whose hash ends with the GlobalDepth low bits
+ * of i, and records the local depth of that bucket. The directory has room
+ * for 2^MaxDepth slots, the most that fit in the page, and never moves.
+ *
+ * Directory page format (size in byte):
+ *  ----------------------------------------------------------------------------
+ * | PageId (4) | LSN (4) | GlobalDepth (4) | MaxDepth (4) |
+ *  ----------------------------------------------------------------------------
+ * | BucketPageId(0) (4) | ... | BucketPageId(2^MaxDepth - 1) (4) |
+ *  ----------------------------------------------------------------------------
+ * | LocalDepth(0) (1) | ... | LocalDepth(2^MaxDepth - 1) (1) |
+ *  ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+class HashTableDirectoryPage {
+public:
+  // After creating a new directory page from buffer pool, must call
+  // initialize method to set default values
+  void Init(page_id_t page_id, size_t page_size = PAGE_SIZE);
+
+  page_id_t GetPageId() const;
+  void SetPageId(page_id_t page_id);
+  void SetLSN(lsn_t lsn = INVALID_LSN);
+
+  int GetGlobalDepth() const;
+  int GetMaxDepth() const;
+  // mask selecting the hash bits that index the directory
+  uint32_t GetGlobalDepthMask() const;
+  // number of slots in use, 2^GlobalDepth
+  uint32_t Size() const;
+  // double the directory, the new upper half mirrors the lower half
+  void IncrGlobalDepth();
+
+  page_id_t GetBucketPageId(uint32_t slot) const;
+  void SetBucketPageId(uint32_t slot, page_id_t bucket_page_id);
+  int GetLocalDepth(uint32_t slot) const;
+  void SetLocalDepth(uint32_t slot, int local_depth);
+
+private:
+  const uint8_t *LocalDepths() const;
+  uint8_t *LocalDepths();
+
+  page_id_t page_id_;
+  lsn_t lsn_;
+  int global_depth_;
+  int max_depth_;
+  page_id_t bucket_page_ids_[0];
+};
+
+} // namespace cmudb
@@ -5,10 +5,19 @@
  * our case, we will contain information about table/index name (length less than
  * 32 bytes) and their corresponding root_id
  *
+ * It also records the page size the database file was created with, so
+ * that the file can be reopened before any page has been read. The page
+ * size is preceded by a format marker, a header page without it is of the
+ * older format that had no page size (the file has OLD_FORMAT_PAGE_SIZE
+ * pages) and whose records start right after RecordCount; such a page keeps
+ * its layout. The marker has no byte below 0x80, so the ASCII name of a
+ * first record in the older format never reads as one.
+ *
  * Format (size in byte):
- *  -----------------------------------------------------------------
- * | RecordCount (4) | Entry_1 name (32) | Entry_1 root_id (4) | ... |
- *  -----------------------------------------------------------------
+ *  ----------------------------------------------------------------------------
+ * | RecordCount (4) | Format (4) | PageSize (4) | Entry_1 name (32) |
+ * | Entry_1 root_id (4) | ...
+ *  ----------------------------------------------------------------------------
  */
 
 #pragma once
@@ -19,9 +28,18 @@
 
 namespace cmudb {
 
+// Format field of a header page that records its page size
+#define HEADER_PAGE_FORMAT 0xc3d8a5f1
+// bytes of a header page ReadPageSize looks at
+#define HEADER_PAGE_PREFIX_SIZE 12
+
 class HeaderPage : public Page {
 public:
-  void Init() { SetRecordCount(0); }
+  void Init() {
+    SetRecordCount(0);
+    SetFormat();
+    SetPageSize(GetPageSize());
+  }
   /**
    * Record related
    */
@@ -33,12 +51,24 @@ public:
   bool GetRootId(const std::string &name, page_id_t &root_id);
   int GetRecordCount();
 
+  // page size recorded in the first HEADER_PAGE_PREFIX_SIZE bytes of a
+  // header page, 0 if none (older format, or not a header page)
+  static size_t ReadPageSize(const char *data);
+  // whether the first OLD_FORMAT_PAGE_SIZE bytes of a file read as a header
+  // page of the older format: no marker, and at least one record that fits
+  // with a terminated name
+  static bool IsOlderFormat(const char *data);
+
 private:
   /**
    * helper functions
    */
   int FindRecord(const std::string &name);
+  // offset of the index-th record, depends on the format of the page
+  int RecordOffset(int index);
 
   void SetRecordCount(int record_count);
+  void SetFormat();
+  void SetPageSize(size_t page_size);
 };
 } // namespace cmudb
@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
 
@@ -16,14 +17,18 @@
 
 namespace cmudb {
 
+class BufferRing;
+
 class Page {
   friend class BufferPoolManager;
 
 public:
-  Page() { ResetMemory(); }
+  Page() {}
   ~Page(){};
   // get actual data page content
   inline char *GetData() { return data_; }
+  // size of the content in byte, the page size of the database
+  inline size_t GetPageSize() { return page_size_; }
   // get page id
   inline page_id_t GetPageId() { return page_id_; }
   // get page pin count
@@ -33,18 +38,35 @@ public:
   inline void WLatch() { rwlatch_.WLock(); }
   inline void RUnlatch() { rwlatch_.RUnlock(); }
   inline void RLatch() { rwlatch_.RLock(); }
+  inline bool TryRLatch() { return rwlatch_.TryRLock(); }
 
   inline lsn_t GetLSN() { return *reinterpret_cast<lsn_t *>(GetData() + 4); }
-  inline void SetLSN(lsn_t lsn) { memcpy(GetData() + 4, &lsn, 4); }
+  // the first change since the page was written back also sets its recovery
+  // lsn, caller holds the write latch
+  inline void SetLSN(lsn_t lsn) {
+    memcpy(GetData() + 4, &lsn, 4);
+    if (rec_lsn_ == INVALID_LSN) rec_lsn_ = lsn;
+  }
+  // lsn of the oldest change that is not on disk, INVALID_LSN if none
+  inline lsn_t GetRecLSN() { return rec_lsn_; }
 
 private:
   // method used by buffer pool manager
-  inline void ResetMemory() { memset(data_, 0, PAGE_SIZE); }
+  inline void ResetMemory() { memset(data_, 0, page_size_); }
   // members
-  char data_[PAGE_SIZE]; // actual data
-  page_id_t page_id_ = INVALID_PAGE_ID;
-  int pin_count_ = 0;
-  bool is_dirty_ = false;
+  char *data_ = nullptr; // actual data, a slice of the buffer pool's memory
+  size_t page_size_ = 0;
+  // bookkeeping is atomic so that a buffer pool hit can pin a page without
+  // taking any latch, pin_count_ < 0 means the frame is free or being replaced
+  std::atomic<page_id_t> page_id_{INVALID_PAGE_ID};
+  std::atomic<int> pin_count_{0};
+  std::atomic<bool> is_dirty_{false};
+  // reset whenever the page is written back under its read latch
+  std::atomic<lsn_t> rec_lsn_{INVALID_LSN};
+  // fetches since the page was loaded in this frame, for statistics only
+  std::atomic<uint32_t> access_count_{0};
+  // ring that recycles this frame, such a frame stays out of the replacer
+  std::atomic<BufferRing *> buffer_ring_{nullptr};
   RWMutex rwlatch_;
 };
 
@@ -42,6 +42,9 @@ public:
   page_id_t GetNextPageId();
   void SetPrevPageId(page_id_t prev_page_id);
   void SetNextPageId(page_id_t next_page_id);
+  // next page id stored in raw page content, used to follow the chain
+  // without a TablePage at hand (read-ahead)
+  static page_id_t ReadNextPageId(const char *data);
 
   /**
    * Tuple related
@@ -46,7 +46,9 @@ public:
 
   bool DeleteTableHeap();
 
-  TableIterator begin(Transaction *txn);
+  // bulk_read: scan through a private ring of SCAN_RING_SIZE frames, so the
+  // scan does not evict the rest of the buffer pool
+  TableIterator begin(Transaction *txn, bool bulk_read = false);
 
   TableIterator end();
 
@@ -7,7 +7,9 @@
 #pragma once
 
 #include <cassert>
+#include <memory>
 
+#include "buffer/buffer_ring.h"
 #include "common/rid.h"
 #include "table/tuple.h"
 
@@ -19,7 +21,10 @@ class TableIterator {
   friend class Cursor;
 
 public:
-  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn);
+  // pages are read through buffer_ring when one is given, copies of the
+  // iterator share it
+  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn,
+                std::shared_ptr<BufferRing> buffer_ring = nullptr);
 
   ~TableIterator() { delete tuple_; }
 
@@ -40,9 +45,14 @@ public:
   TableIterator operator++(int);
 
 private:
+  void ReadAhead(page_id_t next_page_id);
+
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
+  std::shared_ptr<BufferRing> buffer_ring_;
+  // pages left before the next read-ahead is issued
+  size_t pages_until_read_ahead_ = 0;
 };
 
 } // namespace cmudb
\ No newline at end of file
@@ -8,6 +8,8 @@
 #include "catalog/schema.h"
 #include "concurrency/transaction_manager.h"
 #include "index/b_plus_tree_index.h"
+#include "index/extendible_hash_index.h"
+#include "logging/checkpoint_manager.h"
 #include "logging/log_manager.h"
 #include "sqlite/sqlite3ext.h"
 #include "table/table_heap.h"
@@ -59,32 +61,76 @@ int VtabCommit(sqlite3_vtab *pVTab);
 
 int VtabBegin(sqlite3_vtab *pVTab);
 
+/* Read only buffer pool statistics tables */
+int StatsConnect(sqlite3 *db, void *pAux, int argc, const char *const *argv,
+                 sqlite3_vtab **ppVtab, char **pzErr);
+
+int StatsBestIndex(sqlite3_vtab *tab, sqlite3_index_info *pIdxInfo);
+
+int StatsDisconnect(sqlite3_vtab *pVtab);
+
+int StatsOpen(sqlite3_vtab *pVtab, sqlite3_vtab_cursor **ppCursor);
+
+int StatsClose(sqlite3_vtab_cursor *cur);
+
+int StatsFilter(sqlite3_vtab_cursor *pVtabCursor, int idxNum,
+                const char *idxStr, int argc, sqlite3_value **argv);
+
+int StatsNext(sqlite3_vtab_cursor *cur);
+
+int StatsEof(sqlite3_vtab_cursor *cur);
+
+int StatsColumn(sqlite3_vtab_cursor *cur, sqlite3_context *ctx, int i);
+
+int StatsRowid(sqlite3_vtab_cursor *cur, sqlite3_int64 *pRowid);
+
+void StatsReset(sqlite3_context *ctx, int argc, sqlite3_value **argv);
+
+/* durability_mode([mode]): sets the durability mode of the database file if
+ * given one of none, batched or sync, returns the mode in use */
+void DurabilityModeFunc(sqlite3_context *ctx, int argc, sqlite3_value **argv);
+
 // storage engine
 class StorageEngine {
 public:
-  StorageEngine(std::string db_file_name) {
+  // page_size only applies to a new database file
+  StorageEngine(std::string db_file_name, size_t pool_size = BUFFER_POOL_SIZE,
+                size_t page_size = PAGE_SIZE) {
     ENABLE_LOGGING = false;
 
     // storage related
-    disk_manager_ = new DiskManager(db_file_name);
+    disk_manager_ = new DiskManager(db_file_name, page_size);
+    // hot pages of the last clean shutdown, next to the database file
+    resident_pages_file_name_ =
+        db_file_name.substr(0, db_file_name.find('.')) + ".warm";
 
     // log related
     log_manager_ = new LogManager(disk_manager_);
 
     buffer_pool_manager_ =
-        new BufferPoolManager(BUFFER_POOL_SIZE, disk_manager_, log_manager_);
+        new BufferPoolManager(pool_size, disk_manager_, log_manager_);
+    buffer_pool_manager_->RunPageCleaner();
 
     // txn related
     lock_manager_ = new LockManager(true); // S2PL
     transaction_manager_ = new TransactionManager(lock_manager_, log_manager_);
+    checkpoint_manager_ =
+        new CheckpointManager(transaction_manager_, log_manager_,
+                              buffer_pool_manager_, disk_manager_);
   }
 
   ~StorageEngine() {
+    checkpoint_manager_->StopCheckpointThread();
+    buffer_pool_manager_->StopPageCleaner();
+    buffer_pool_manager_->SaveResidentPages(resident_pages_file_name_);
     if (ENABLE_LOGGING)
       log_manager_->StopFlushThread();
-    delete disk_manager_;
+    delete checkpoint_manager_;
+    // waits for the warm-up and the prefetches in flight, which read through
+    // the disk manager
     delete buffer_pool_manager_;
     delete log_manager_;
+    delete disk_manager_;
     delete lock_manager_;
     delete transaction_manager_;
   }
@@ -94,6 +140,8 @@ public:
   LockManager *lock_manager_;
   TransactionManager *transaction_manager_;
   LogManager *log_manager_;
+  CheckpointManager *checkpoint_manager_;
+  std::string resident_pages_file_name_;
 };
 
 StorageEngine *storage_engine_;
@@ -172,7 +220,10 @@ public:
     return table_heap_->UpdateTuple(tuple, rid, GetTransaction());
   }
 
-  inline TableIterator begin() { return table_heap_->begin(GetTransaction()); }
+  // sequential scans read through a buffer ring
+  inline TableIterator begin() {
+    return table_heap_->begin(GetTransaction(), true);
+  }
 
   inline TableIterator end() { return table_heap_->end(); }
 
@@ -264,4 +315,56 @@ private:
   VirtualTable *virtual_table_;
 }; // namespace cmudb
 
-} // namespace cmudb
\ No newline at end of file
+/*
+ * Statistics of the buffer pool, as eponymous virtual tables:
+ *  bpm_stats(name, value): counters, and count/p50/p99/max of every latency
+ *  bpm_frames(frame, page_id, pin_count, dirty, accesses): one row per frame
+ */
+enum class StatsTableType { POOL, FRAMES };
+
+class StatsTable {
+public:
+  StatsTable(StatsTableType type) : type_(type) {}
+
+  inline StatsTableType GetType() { return type_; }
+
+private:
+  sqlite3_vtab base_;
+  StatsTableType type_;
+};
+
+class StatsCursor {
+public:
+  StatsCursor(StatsTable *stats_table) : stats_table_(stats_table) {}
+
+  // copy the current statistics, rows are stable for the rest of the scan
+  void Load(BufferPoolManager *buffer_pool_manager);
+
+  inline bool isEof() { return offset_ == values_.size(); }
+
+  inline void Next() { ++offset_; }
+
+  inline int64_t GetCurrentRowid() { return offset_; }
+
+  // bpm_stats has a leading name column
+  inline bool HasName() {
+    return stats_table_->GetType() == StatsTableType::POOL;
+  }
+
+  inline const std::string &GetCurrentName() { return names_[offset_]; }
+
+  inline int64_t GetCurrentValue(int column) {
+    return values_[offset_][HasName() ? column - 1 : column];
+  }
+
+private:
+  void AddRow(const std::string &name, int64_t value);
+
+  sqlite3_vtab_cursor base_; /* Base class - must be first */
+  StatsTable *stats_table_;
+  std::vector<std::string> names_;
+  std::vector<std::vector<int64_t>> values_;
+  size_t offset_ = 0;
+};
+
+} // namespace cmudb
@@ -1,6 +1,7 @@
 /**
  * b_plus_tree.cpp
  */
+#include <fstream>
 #include <iostream>
 #include <string>
 
@@ -73,7 +74,8 @@ INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {
     Page *page = buffer_pool_manager_->NewPage(root_page_id_);
     B_PLUS_TREE_LEAF_PAGE_TYPE *root = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
-    root->Init(root_page_id_, INVALID_PAGE_ID);
+    root->Init(root_page_id_, INVALID_PAGE_ID,
+               buffer_pool_manager_->GetPageSize());
     root->Insert(key, value, comparator_);
     UpdateRootPageId(true);
     buffer_pool_manager_->UnpinPage(root->GetPageId(), true);
@@ -115,9 +117,11 @@ bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N> N *BPLUSTREE_TYPE::Split(N *node) {
     page_id_t id;
-    Page *page = buffer_pool_manager_->NewPage(id);
+    // keep siblings close together in the file
+    Page *page = buffer_pool_manager_->NewPage(id, node->GetPageId());
     N *newNode = reinterpret_cast<N *>(page->GetData());
-    newNode->Init(id, node->GetParentPageId());
+    newNode->Init(id, node->GetParentPageId(),
+                  buffer_pool_manager_->GetPageSize());
     node->MoveHalfTo(newNode, buffer_pool_manager_);
     return newNode;
 }
@@ -140,7 +144,8 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node,
         // if old_node is root
         Page *page = buffer_pool_manager_->NewPage(root_page_id_);
         B_PLUS_TREE_INTERNAL_PAGE *root = reinterpret_cast<B_PLUS_TREE_INTERNAL_PAGE *>(page->GetData());
-        root->Init(root_page_id_, INVALID_PAGE_ID);
+        root->Init(root_page_id_, INVALID_PAGE_ID,
+                   buffer_pool_manager_->GetPageSize());
         root->PopulateNewRoot(old_node->GetPageId(), key, new_node->GetPageId());
         UpdateRootPageId(false);
         old_node->SetParentPageId(root_page_id_);
@@ -348,6 +353,26 @@ B_PLUS_TREE_LEAF_PAGE_TYPE *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key,
     return static_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page);
 }
 
+/*
+ * Count the levels on the leftmost path, the leaf level included
+ */
+INDEX_TEMPLATE_ARGUMENTS
+int BPLUSTREE_TYPE::GetDepth() {
+    if (IsEmpty()) return 0;
+    int depth = 1;
+    page_id_t page_id = root_page_id_;
+    BPlusTreePage *page = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(page_id)->GetData());
+    while (!page->IsLeafPage()) {
+        page_id_t child_id = static_cast<B_PLUS_TREE_INTERNAL_PAGE *>(page)->ValueAt(0);
+        buffer_pool_manager_->UnpinPage(page_id, false);
+        page_id = child_id;
+        page = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(page_id)->GetData());
+        ++depth;
+    }
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    return depth;
+}
+
 /*
  * Update/Insert root page id in header page(where page_id = 0, header_page is
  * defined under include/page/header_page.h)
@@ -0,0 +1,321 @@
+/**
+ * extendible_hash_table.cpp
+ */
+#include <cassert>
+#include <string>
+
+#include "common/exception.h"
+#include "common/rid.h"
+#include "index/extendible_hash_table.h"
+#include "page/header_page.h"
+
+namespace cmudb {
+
+INDEX_TEMPLATE_ARGUMENTS
+HASH_TABLE_TYPE::ExtendibleHashTable(const std::string &name,
+                                     BufferPoolManager *buffer_pool_manager,
+                                     const KeyComparator &comparator,
+                                     page_id_t directory_page_id)
+    : index_name_(name), directory_page_id_(directory_page_id),
+      buffer_pool_manager_(buffer_pool_manager), comparator_(comparator) {
+    if (directory_page_id_ != INVALID_PAGE_ID) return;
+    Page *page = buffer_pool_manager_->NewPage(directory_page_id_);
+    if (page == nullptr) {
+        throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+    }
+    auto directory = reinterpret_cast<HashTableDirectoryPage *>(page->GetData());
+    directory->Init(directory_page_id_, buffer_pool_manager_->GetPageSize());
+    Page *bucket = NewBucket();
+    directory->SetBucketPageId(0, bucket->GetPageId());
+    buffer_pool_manager_->UnpinPage(bucket->GetPageId(), true);
+    buffer_pool_manager_->UnpinPage(directory_page_id_, true);
+    UpdateDirectoryPageId();
+}
+
+/*
+ * Helper function to hash the key bytes: FNV-1a, then mixed so that the low
+ * bits indexing the directory depend on every byte
+ */
+INDEX_TEMPLATE_ARGUMENTS
+uint32_t HASH_TABLE_TYPE::Hash(const KeyType &key) const {
+    auto bytes = reinterpret_cast<const unsigned char *>(&key);
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < sizeof(KeyType); ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return static_cast<uint32_t>(hash);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+Page *HASH_TABLE_TYPE::FetchPage(page_id_t page_id) {
+    Page *page = buffer_pool_manager_->FetchPage(page_id);
+    if (page == nullptr) {
+        throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+    }
+    return page;
+}
+
+/*
+ * Allocate and initialize an empty bucket page, returned pinned
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *HASH_TABLE_TYPE::NewBucket() {
+    page_id_t page_id;
+    Page *page = buffer_pool_manager_->NewPage(page_id);
+    if (page == nullptr) {
+        throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+    }
+    BucketOf(page)->Init(page_id, buffer_pool_manager_->GetPageSize());
+    return page;
+}
+
+/*****************************************************************************
+ * SEARCH
+ *****************************************************************************/
+/*
+ * Return the only value that associated with input key
+ * This method is used for point query
+ * @return : true means key exists
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool HASH_TABLE_TYPE::GetValue(const KeyType &key,
+                               std::vector<ValueType> &result,
+                               Transaction *transaction) {
+    uint32_t hash = Hash(key);
+    Page *directory_page = FetchPage(directory_page_id_);
+    auto directory = reinterpret_cast<HashTableDirectoryPage *>(directory_page->GetData());
+    directory_page->RLatch();
+    Page *head = FetchPage(directory->GetBucketPageId(hash & directory->GetGlobalDepthMask()));
+    head->RLatch();
+    directory_page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
+
+    ValueType value;
+    bool found = BucketOf(head)->Lookup(key, value, comparator_);
+    // overflow pages are covered by the latch of the first page
+    page_id_t next_page_id = BucketOf(head)->GetNextPageId();
+    while (!found && next_page_id != INVALID_PAGE_ID) {
+        Page *page = FetchPage(next_page_id);
+        found = BucketOf(page)->Lookup(key, value, comparator_);
+        next_page_id = BucketOf(page)->GetNextPageId();
+        buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    }
+    head->RUnlatch();
+    buffer_pool_manager_->UnpinPage(head->GetPageId(), false);
+    if (found) result.push_back(value);
+    return found;
+}
+
+/*****************************************************************************
+ * INSERTION
+ *****************************************************************************/
+/*
+ * Insert constant key & value pair into the hash table
+ * First try with the directory read latch, which is enough when the bucket
+ * has room. Otherwise take the directory write latch and split the bucket
+ * until the key's half has room, or chain an overflow page to it once it is
+ * at the max depth of the directory.
+ * @return: since we only support unique key, if user try to insert duplicate
+ * keys return false, otherwise return true.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool HASH_TABLE_TYPE::Insert(const KeyType &key, const ValueType &value,
+                             Transaction *transaction) {
+    uint32_t hash = Hash(key);
+    Page *directory_page = FetchPage(directory_page_id_);
+    auto directory = reinterpret_cast<HashTableDirectoryPage *>(directory_page->GetData());
+    directory_page->RLatch();
+    Page *head = FetchPage(directory->GetBucketPageId(hash & directory->GetGlobalDepthMask()));
+    head->WLatch();
+    directory_page->RUnlatch();
+    InsertResult result = InsertIntoBucket(head, key, value, false);
+    head->WUnlatch();
+    buffer_pool_manager_->UnpinPage(head->GetPageId(), result == InsertResult::INSERTED);
+    if (result != InsertResult::FULL) {
+        buffer_pool_manager_->UnpinPage(directory_page_id_, false);
+        return result == InsertResult::INSERTED;
+    }
+
+    directory_page->WLatch();
+    bool split = false;
+    for (;;) {
+        uint32_t slot = hash & directory->GetGlobalDepthMask();
+        head = FetchPage(directory->GetBucketPageId(slot));
+        head->WLatch();
+        bool overflow = directory->GetLocalDepth(slot) == directory->GetMaxDepth();
+        result = InsertIntoBucket(head, key, value, overflow);
+        head->WUnlatch();
+        buffer_pool_manager_->UnpinPage(head->GetPageId(), result == InsertResult::INSERTED);
+        if (result != InsertResult::FULL) break;
+        SplitBucket(directory, slot);
+        split = true;
+    }
+    directory_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(directory_page_id_, split);
+    return result == InsertResult::INSERTED;
+}
+
+/*
+ * Insert key & value pair into the first page of the bucket chain with room,
+ * chaining a new overflow page if none has room and overflow is set
+ * Caller must hold the write latch of head, the first page of the bucket
+ */
+INDEX_TEMPLATE_ARGUMENTS
+typename HASH_TABLE_TYPE::InsertResult
+HASH_TABLE_TYPE::InsertIntoBucket(Page *head, const KeyType &key,
+                                  const ValueType &value, bool overflow) {
+    ValueType existing;
+    if (BucketOf(head)->Lookup(key, existing, comparator_)) {
+        return InsertResult::DUPLICATE;
+    }
+    page_id_t room_page_id = BucketOf(head)->IsFull() ? INVALID_PAGE_ID : head->GetPageId();
+    page_id_t last_page_id = head->GetPageId();
+    page_id_t next_page_id = BucketOf(head)->GetNextPageId();
+    while (next_page_id != INVALID_PAGE_ID) {
+        Page *page = FetchPage(next_page_id);
+        bool found = BucketOf(page)->Lookup(key, existing, comparator_);
+        if (room_page_id == INVALID_PAGE_ID && !BucketOf(page)->IsFull()) {
+            room_page_id = next_page_id;
+        }
+        last_page_id = next_page_id;
+        next_page_id = BucketOf(page)->GetNextPageId();
+        buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+        if (found) return InsertResult::DUPLICATE;
+    }
+
+    if (room_page_id == INVALID_PAGE_ID) {
+        if (!overflow) return InsertResult::FULL;
+        Page *page = NewBucket();
+        room_page_id = page->GetPageId();
+        buffer_pool_manager_->UnpinPage(room_page_id, true);
+        Page *last = last_page_id == head->GetPageId() ? head : FetchPage(last_page_id);
+        BucketOf(last)->SetNextPageId(room_page_id);
+        if (last != head) buffer_pool_manager_->UnpinPage(last_page_id, true);
+    }
+    Page *page = room_page_id == head->GetPageId() ? head : FetchPage(room_page_id);
+    BucketOf(page)->Insert(key, value);
+    if (page != head) buffer_pool_manager_->UnpinPage(room_page_id, true);
+    return InsertResult::INSERTED;
+}
+
+/*
+ * Split the bucket of slot into itself and a new bucket taking the pairs
+ * whose next hash bit is set, doubling the directory first if the bucket is
+ * at the global depth. Only a bucket without overflow pages can split.
+ * Caller must hold the directory write latch
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void HASH_TABLE_TYPE::SplitBucket(HashTableDirectoryPage *directory,
+                                  uint32_t slot) {
+    int local_depth = directory->GetLocalDepth(slot);
+    if (local_depth == directory->GetGlobalDepth()) directory->IncrGlobalDepth();
+    page_id_t old_page_id = directory->GetBucketPageId(slot);
+    Page *old_page = FetchPage(old_page_id);
+    Page *new_page = NewBucket();
+    auto old_bucket = BucketOf(old_page);
+    auto new_bucket = BucketOf(new_page);
+    assert(old_bucket->GetNextPageId() == INVALID_PAGE_ID);
+
+    uint32_t high_bit = 1u << local_depth;
+    // readers that left the directory may still be in the bucket
+    old_page->WLatch();
+    for (int i = 0; i < old_bucket->GetSize();) {
+        if (Hash(old_bucket->KeyAt(i)) & high_bit) {
+            new_bucket->Insert(old_bucket->GetItem(i).first, old_bucket->GetItem(i).second);
+            old_bucket->RemoveAt(i);
+        } else ++i;
+    }
+    old_page->WUnlatch();
+
+    for (uint32_t i = 0; i < directory->Size(); ++i) {
+        if (directory->GetBucketPageId(i) != old_page_id) continue;
+        directory->SetLocalDepth(i, local_depth + 1);
+        if (i & high_bit) directory->SetBucketPageId(i, new_page->GetPageId());
+    }
+    buffer_pool_manager_->UnpinPage(new_page->GetPageId(), true);
+    buffer_pool_manager_->UnpinPage(old_page_id, true);
+}
+
+/*****************************************************************************
+ * REMOVE
+ *****************************************************************************/
+/*
+ * Delete key & value pair associated with input key
+ * If current hash table does not hold the key, return immdiately. An
+ * overflow page emptied by the removal is unlinked and deleted, buckets
+ * themselves are never merged.
+ * @return: true if the key was removed
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool HASH_TABLE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
+    uint32_t hash = Hash(key);
+    Page *directory_page = FetchPage(directory_page_id_);
+    auto directory = reinterpret_cast<HashTableDirectoryPage *>(directory_page->GetData());
+    directory_page->RLatch();
+    Page *head = FetchPage(directory->GetBucketPageId(hash & directory->GetGlobalDepthMask()));
+    head->WLatch();
+    directory_page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
+
+    bool removed = BucketOf(head)->Remove(key, comparator_);
+    Page *prev = head;
+    bool prev_dirty = removed;
+    while (!removed) {
+        page_id_t next_page_id = BucketOf(prev)->GetNextPageId();
+        if (next_page_id == INVALID_PAGE_ID) break;
+        Page *page = FetchPage(next_page_id);
+        removed = BucketOf(page)->Remove(key, comparator_);
+        if (removed && BucketOf(page)->GetSize() == 0) {
+            BucketOf(prev)->SetNextPageId(BucketOf(page)->GetNextPageId());
+            prev_dirty = true;
+            buffer_pool_manager_->UnpinPage(next_page_id, false);
+            buffer_pool_manager_->DeletePage(next_page_id);
+            break;
+        }
+        if (prev != head) buffer_pool_manager_->UnpinPage(prev->GetPageId(), false);
+        prev = page;
+        prev_dirty = removed;
+    }
+    if (prev != head) buffer_pool_manager_->UnpinPage(prev->GetPageId(), prev_dirty);
+    head->WUnlatch();
+    buffer_pool_manager_->UnpinPage(head->GetPageId(), prev == head && prev_dirty);
+    return removed;
+}
+
+/*****************************************************************************
+ * UTILITIES AND DEBUG
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+int HASH_TABLE_TYPE::GetGlobalDepth() {
+    Page *directory_page = FetchPage(directory_page_id_);
+    directory_page->RLatch();
+    int global_depth =
+        reinterpret_cast<HashTableDirectoryPage *>(directory_page->GetData())->GetGlobalDepth();
+    directory_page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
+    return global_depth;
+}
+
+/*
+ * Record the directory page id in header page, under the index name
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void HASH_TABLE_TYPE::UpdateDirectoryPageId() {
+  HeaderPage *header_page = static_cast<HeaderPage *>(
+      buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  if (!header_page->InsertRecord(index_name_, directory_page_id_))
+    header_page->UpdateRecord(index_name_, directory_page_id_);
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+}
+
+template class ExtendibleHashTable<GenericKey<4>, RID, GenericComparator<4>>;
+template class ExtendibleHashTable<GenericKey<8>, RID, GenericComparator<8>>;
+template class ExtendibleHashTable<GenericKey<16>, RID, GenericComparator<16>>;
+template class ExtendibleHashTable<GenericKey<32>, RID, GenericComparator<32>>;
+template class ExtendibleHashTable<GenericKey<64>, RID, GenericComparator<64>>;
+
+} // namespace cmudb
@@ -14,7 +14,9 @@ namespace cmudb {
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE::IndexIterator(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf, int index,
                                   BufferPoolManager *bufferPoolManager)
-                                  : leaf_(leaf), index_(index), bufferPoolManager_(bufferPoolManager) {}
+                                  : leaf_(leaf), index_(index), bufferPoolManager_(bufferPoolManager) {
+    if (leaf_) ReadAhead();
+}
 
 
 INDEX_TEMPLATE_ARGUMENTS
@@ -22,6 +24,27 @@ INDEXITERATOR_TYPE::~IndexIterator() {
     if (leaf_) bufferPoolManager_->UnpinPage(leaf_->GetPageId(), false);
 }
 
+/*
+ * Every READ_AHEAD_PAGES / 2 leaves, prefetch the next READ_AHEAD_PAGES
+ * leaves along the sibling chain
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::ReadAhead() {
+    if (READ_AHEAD_PAGES == 0 || leaf_->GetNextPageId() == INVALID_PAGE_ID) return;
+    if (pagesUntilReadAhead_ > 0) {
+        --pagesUntilReadAhead_;
+        return;
+    }
+    bufferPoolManager_->PrefetchChain(leaf_->GetNextPageId(), READ_AHEAD_PAGES,
+                                      &INDEXITERATOR_TYPE::ReadNextPageId);
+    pagesUntilReadAhead_ = READ_AHEAD_PAGES / 2;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t INDEXITERATOR_TYPE::ReadNextPageId(const char *data) {
+    return reinterpret_cast<const B_PLUS_TREE_LEAF_PAGE_TYPE *>(data)->GetNextPageId();
+}
+
 template class IndexIterator<GenericKey<4>, RID, GenericComparator<4>>;
 template class IndexIterator<GenericKey<8>, RID, GenericComparator<8>>;
 template class IndexIterator<GenericKey<16>, RID, GenericComparator<16>>;
@@ -0,0 +1,99 @@
+/**
+ * checkpoint_manager.cpp
+ */
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "logging/checkpoint_manager.h"
+
+namespace cmudb {
+
+/*
+ * Take a fuzzy checkpoint, see checkpoint_manager.h. Transactions and the
+ * buffer pool keep going meanwhile: a change logged before begin_lsn is on
+ * its page when the dirty page table reads the page, as the page is write
+ * latched from the log append until its lsn is set.
+ */
+lsn_t CheckpointManager::Checkpoint() {
+  if (!ENABLE_LOGGING) return INVALID_LSN;
+  std::lock_guard<std::mutex> guard(checkpoint_latch_);
+  lsn_t begin_lsn = log_manager_->GetNextLSN();
+  if (last_begin_lsn_ != INVALID_LSN)
+    buffer_pool_manager_->FlushAllPages(last_begin_lsn_);
+
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txns;
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages;
+  lsn_t redo_lsn = transaction_manager_->GetActiveTransactions(active_txns);
+  buffer_pool_manager_->GetDirtyPageTable(dirty_pages);
+  if (redo_lsn == INVALID_LSN || redo_lsn > begin_lsn) redo_lsn = begin_lsn;
+  for (auto &page : dirty_pages) {
+    redo_lsn = std::min(redo_lsn, page.second);
+  }
+
+  LogRecord log_record(begin_lsn, log_manager_->GetLogOffset(redo_lsn),
+                       active_txns, dirty_pages);
+  if (static_cast<size_t>(log_record.GetSize()) >
+      log_manager_->GetLogBufferSize()) {
+    // too many to log: recovery redoes everything from redo_lsn on, and
+    // finds the active transactions there
+    active_txns.clear();
+    dirty_pages.clear();
+    log_record = LogRecord(redo_lsn, log_record.GetLogOffset(), active_txns,
+                           dirty_pages);
+  }
+  lsn_t lsn = log_manager_->AppendLogRecord(log_record);
+  log_manager_->Flush(lsn);
+  if (!disk_manager_->WriteMasterRecord(lsn, log_manager_->GetLogOffset(lsn)))
+    return INVALID_LSN;
+  // recovery starts reading at the offset of redo_lsn from now on
+  if (truncate_log_) disk_manager_->TruncateLog(log_record.GetLogOffset());
+  last_begin_lsn_ = begin_lsn;
+  last_log_size_ = log_manager_->GetLogSize();
+  ++num_checkpoints_;
+  return lsn;
+}
+
+/*
+ * Start a thread that takes a checkpoint every interval, or once log_size
+ * bytes were logged since the last one. The log size is looked at every
+ * LOG_TIMEOUT at least.
+ */
+void CheckpointManager::RunCheckpointThread(std::chrono::milliseconds interval,
+                                            size_t log_size) {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (running_) return;
+  running_ = true;
+  last_log_size_ = log_manager_->GetLogSize();
+  checkpoint_thread_ = new std::thread([this, interval, log_size] {
+    auto poll = std::min<std::chrono::milliseconds>(interval, LOG_TIMEOUT);
+    auto last = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(latch_);
+    while (running_) {
+      cv_.wait_for(lock, poll, [this] { return !running_; });
+      if (!running_) break;
+      if (std::chrono::steady_clock::now() - last < interval &&
+          log_manager_->GetLogSize() - last_log_size_ < log_size)
+        continue;
+      lock.unlock();
+      Checkpoint();
+      last = std::chrono::steady_clock::now();
+      lock.lock();
+    }
+  });
+}
+
+void CheckpointManager::StopCheckpointThread() {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    if (!running_) return;
+    running_ = false;
+  }
+  cv_.notify_all();
+  checkpoint_thread_->join();
+  delete checkpoint_thread_;
+  checkpoint_thread_ = nullptr;
+}
+
+} // namespace cmudb
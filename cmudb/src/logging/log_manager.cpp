@@ -12,35 +12,231 @@ namespace cmudb {
  * manager wants to force flush (it only happens when the flushed page has a
  * larger LSN than persistent LSN)
  */
-void LogManager::RunFlushThread() {}
+void LogManager::RunFlushThread() {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (running_) return;
+  running_ = true;
+  ENABLE_LOGGING = true;
+  flush_thread_ = new std::thread([this] { FlushLoop(); });
+}
+
 /*
  * Stop and join the flush thread, set ENABLE_LOGGING = false
+ * The records appended so far are written before the thread exits.
  */
-void LogManager::StopFlushThread() {}
+void LogManager::StopFlushThread() {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    if (!running_) return;
+    running_ = false;
+    ENABLE_LOGGING = false;
+  }
+  cv_.notify_all();
+  flush_thread_->join();
+  delete flush_thread_;
+  flush_thread_ = nullptr;
+}
 
 /*
  * append a log record into log buffer
  * you MUST set the log record's lsn within this method
  * @return: lsn that is assigned to this log record
- *
- *
- * example below
- * // First, serialize the must have fields(20 bytes in total)
- * log_record.lsn_ = next_lsn_++;
- * memcpy(log_buffer_ + offset_, &log_record, 20);
- * int pos = offset_ + 20;
- *
- * if (log_record.log_record_type_ == LogRecordType::INSERT) {
- *    memcpy(log_buffer_ + pos, &log_record.insert_rid_, sizeof(RID));
- *    pos += sizeof(RID);
- *    // we have provided serialize function for tuple class
- *    log_record.insert_tuple_.SerializeTo(log_buffer_ + pos);
- *  }
- *
+ * The lsn and the slot are reserved together without the latch, and the
+ * record is serialized into its slot concurrently with other appenders. If
+ * the record does not fit, the caller waits for the buffers to be swapped.
  */
 lsn_t LogManager::AppendLogRecord(LogRecord &log_record) {
+  size_t size = log_record.size_;
+  assert(size <= log_buffer_size_);
+  // one more lsn and size more bytes
+  const uint64_t step = (1ULL << 32) + size;
+  uint64_t reserve = reserve_.load();
+  while (true) {
+    if (OffsetOf(reserve) + size > log_buffer_size_) {
+      WaitForRoom(reserve);
+      reserve = reserve_.load();
+    } else if (reserve_.compare_exchange_weak(reserve, reserve + step)) {
+      break;
+    }
+  }
+  int buffer = BufferOf(reserve);
+  log_record.lsn_ = LsnOf(reserve);
+  SerializeLogRecord(log_record, buffers_[buffer] + OffsetOf(reserve));
+  // publish the record to the flush thread
+  filled_[buffer].fetch_add(size, std::memory_order_release);
+  return log_record.lsn_;
+}
+
+/*
+ * The log buffer is full as of reserve. Wake the flush thread and wait for
+ * the buffers to be swapped, or write the buffer without a flush thread.
+ */
+void LogManager::WaitForRoom(uint64_t reserve) {
+  std::unique_lock<std::mutex> lock(latch_);
+  if (reserve_ != reserve) return;
+  if (!running_) {
+    FlushBuffer(lock);
+    return;
+  }
+  flush_requested_ = true;
+  cv_.notify_one();
+  append_cv_.wait(lock, [this, reserve] { return reserve_ != reserve; });
+}
+
+/*
+ * Force the log out up to lsn and wait until it is on disk. Used by
+ * committing transactions and by the buffer pool before it writes a page
+ * whose changes are not in the log file yet. Callers that force the log
+ * while the flush thread is writing all wait for its next flush, which
+ * writes their records at once.
+ */
+void LogManager::Flush(lsn_t lsn) {
+  std::unique_lock<std::mutex> lock(latch_);
+  // nothing beyond the last record appended will ever be written
+  lsn = std::min<lsn_t>(lsn, LsnOf(reserve_) - 1);
+  if (persistent_lsn_ >= lsn) return;
+  if (!running_) {
+    FlushBuffer(lock);
+    return;
+  }
+  flush_requested_ = true;
+  cv_.notify_one();
+  flushed_cv_.wait(lock, [this, lsn] { return persistent_lsn_ >= lsn; });
+}
+
+/*
+ * After recovery, so that new records have higher lsns than the pages and
+ * the records already in the log
+ */
+void LogManager::SetNextLSN(lsn_t lsn) {
+  std::lock_guard<std::mutex> guard(latch_);
+  assert(OffsetOf(reserve_) == 0);
+  reserve_ = Reserve(lsn, BufferOf(reserve_), 0);
+  persistent_lsn_ = lsn - 1;
+  log_offsets_.clear();
+  log_offsets_[lsn] = log_size_;
+}
+
+/*
+ * The log file offset of the closest remembered lsn at or before lsn, the
+ * record with lsn is at most a few RECOVERY_READ_SIZE further
+ */
+size_t LogManager::GetLogOffset(lsn_t lsn) {
+  std::lock_guard<std::mutex> guard(latch_);
+  auto it = log_offsets_.upper_bound(lsn);
+  // older than this log manager, the whole log file
+  if (it == log_offsets_.begin()) return 0;
+  return (--it)->second;
+}
 
-  return INVALID_LSN;
+/*
+ * Body of the flush thread: flush every LOG_TIMEOUT, or as soon as
+ * somebody asks for it, until stopped and the log buffer is empty
+ */
+void LogManager::FlushLoop() {
+  std::unique_lock<std::mutex> lock(latch_);
+  while (running_ || OffsetOf(reserve_) > 0) {
+    cv_.wait_for(lock, LOG_TIMEOUT,
+                 [this] { return !running_ || flush_requested_; });
+    FlushBuffer(lock);
+  }
+}
+
+/*
+ * Close the log buffer, direct appenders to the other one and write the
+ * closed buffer out once every record reserved in it is serialized. The
+ * latch is released during the write. Caller holds the latch.
+ */
+void LogManager::FlushBuffer(std::unique_lock<std::mutex> &lock) {
+  // one write at a time, the other buffer is in use until then
+  flushed_cv_.wait(lock, [this] { return !flushing_; });
+  flush_requested_ = false;
+  uint64_t reserve = reserve_.load();
+  do {
+    if (OffsetOf(reserve) == 0) return;
+  } while (!reserve_.compare_exchange_weak(
+      reserve, Reserve(LsnOf(reserve), 1 - BufferOf(reserve), 0)));
+  int buffer = BufferOf(reserve);
+  size_t size = OffsetOf(reserve);
+  // no more lsns go to the closed buffer, it ends with this one
+  lsn_t last_lsn = LsnOf(reserve) - 1;
+  flushing_ = true;
+  append_cv_.notify_all();
+  lock.unlock();
+  // appenders that reserved their slot are copying their record
+  while (filled_[buffer].load(std::memory_order_acquire) != size) {
+    std::this_thread::yield();
+  }
+  disk_manager_->WriteLog(buffers_[buffer], size);
+  filled_[buffer] = 0;
+  lock.lock();
+  flushing_ = false;
+  persistent_lsn_ = last_lsn;
+  // the next buffer written starts with the next lsn
+  log_size_ += size;
+  if (log_size_ - log_offsets_.rbegin()->second >= RECOVERY_READ_SIZE)
+    log_offsets_[last_lsn + 1] = log_size_;
+  flushed_cv_.notify_all();
+}
+
+/*
+ * Write a log record in the format described in log_record.h
+ */
+void LogManager::SerializeLogRecord(const LogRecord &log_record, char *data) {
+  // the header fields are the first members of a log record
+  memcpy(data, &log_record, LogRecord::HEADER_SIZE);
+  int pos = LogRecord::HEADER_SIZE;
+  switch (log_record.log_record_type_) {
+  case LogRecordType::INSERT:
+    memcpy(data + pos, &log_record.insert_rid_, sizeof(RID));
+    pos += sizeof(RID);
+    log_record.insert_tuple_.SerializeTo(data + pos);
+    break;
+  case LogRecordType::MARKDELETE:
+  case LogRecordType::APPLYDELETE:
+  case LogRecordType::ROLLBACKDELETE:
+    memcpy(data + pos, &log_record.delete_rid_, sizeof(RID));
+    pos += sizeof(RID);
+    log_record.delete_tuple_.SerializeTo(data + pos);
+    break;
+  case LogRecordType::UPDATE:
+    memcpy(data + pos, &log_record.update_rid_, sizeof(RID));
+    pos += sizeof(RID);
+    log_record.old_tuple_.SerializeTo(data + pos);
+    pos += sizeof(int32_t) + log_record.old_tuple_.GetLength();
+    log_record.new_tuple_.SerializeTo(data + pos);
+    break;
+  case LogRecordType::NEWPAGE:
+    memcpy(data + pos, &log_record.prev_page_id_, sizeof(page_id_t));
+    memcpy(data + pos + sizeof(page_id_t), &log_record.page_id_,
+           sizeof(page_id_t));
+    break;
+  case LogRecordType::CHECKPOINT: {
+    memcpy(data + pos, &log_record.begin_lsn_, sizeof(lsn_t));
+    pos += sizeof(lsn_t);
+    memcpy(data + pos, &log_record.log_offset_, sizeof(uint64_t));
+    pos += sizeof(uint64_t);
+    int32_t count = log_record.active_txns_.size();
+    memcpy(data + pos, &count, sizeof(int32_t));
+    pos += sizeof(int32_t);
+    for (auto &txn : log_record.active_txns_) {
+      memcpy(data + pos, &txn.first, sizeof(txn_id_t));
+      memcpy(data + pos + sizeof(txn_id_t), &txn.second, sizeof(lsn_t));
+      pos += sizeof(txn_id_t) + sizeof(lsn_t);
+    }
+    count = log_record.dirty_pages_.size();
+    memcpy(data + pos, &count, sizeof(int32_t));
+    pos += sizeof(int32_t);
+    for (auto &page : log_record.dirty_pages_) {
+      memcpy(data + pos, &page.first, sizeof(page_id_t));
+      memcpy(data + pos + sizeof(page_id_t), &page.second, sizeof(lsn_t));
+      pos += sizeof(page_id_t) + sizeof(lsn_t);
+    }
+    break;
+  }
+  default:
+    break;
+  }
 }
 
 } // namespace cmudb
@@ -2,18 +2,119 @@
  * log_recovey.cpp
  */
 
+#include <queue>
+#include <thread>
+
 #include "logging/log_recovery.h"
 #include "page/table_page.h"
 
 namespace cmudb {
+
+// the redo worker applying the records of page_id, a negative partition
+// applies them all
+static inline bool OwnsPage(page_id_t page_id, int partition,
+                            size_t num_partitions) {
+  return partition < 0 ||
+         static_cast<size_t>(page_id) % num_partitions ==
+             static_cast<size_t>(partition);
+}
+
+// a tuple as serialized by Tuple::SerializeTo, within [data, end)
+static bool DeserializeTuple(const char *&data, const char *end,
+                             Tuple &tuple) {
+  if (end - data < static_cast<ptrdiff_t>(sizeof(int32_t))) return false;
+  int32_t size = *reinterpret_cast<const int32_t *>(data);
+  if (size < 0 || end - data - sizeof(int32_t) < static_cast<size_t>(size))
+    return false;
+  tuple.DeserializeFrom(data);
+  data += sizeof(int32_t) + size;
+  return true;
+}
+
 /*
  * deserialize a log record from log buffer
  * @return: true means deserialize succeed, otherwise can't deserialize cause
  * incomplete log record
+ * Only the size bytes at data are looked at. A record that does not make
+ * sense (the zeroed or torn end of the log) can't be deserialized either.
  */
-bool LogRecovery::DeserializeLogRecord(const char *data,
-                                             LogRecord &log_record) {
-  return false;
+bool LogRecovery::DeserializeLogRecord(const char *data, size_t size,
+                                       LogRecord &log_record) {
+  if (size < static_cast<size_t>(LogRecord::HEADER_SIZE)) return false;
+  const int32_t *header = reinterpret_cast<const int32_t *>(data);
+  if (header[0] < LogRecord::HEADER_SIZE ||
+      static_cast<size_t>(header[0]) > size)
+    return false;
+  if (header[4] <= static_cast<int32_t>(LogRecordType::INVALID) ||
+      header[4] > static_cast<int32_t>(LogRecordType::CHECKPOINT))
+    return false;
+  log_record.size_ = header[0];
+  log_record.lsn_ = header[1];
+  log_record.txn_id_ = header[2];
+  log_record.prev_lsn_ = header[3];
+  log_record.log_record_type_ = static_cast<LogRecordType>(header[4]);
+
+  const char *pos = data + LogRecord::HEADER_SIZE;
+  const char *end = data + log_record.size_;
+  switch (log_record.log_record_type_) {
+  case LogRecordType::INSERT:
+  case LogRecordType::MARKDELETE:
+  case LogRecordType::APPLYDELETE:
+  case LogRecordType::ROLLBACKDELETE:
+  case LogRecordType::UPDATE:
+    if (end - pos < static_cast<ptrdiff_t>(sizeof(RID))) return false;
+    memcpy(&GetRID(log_record), pos, sizeof(RID));
+    pos += sizeof(RID);
+    if (log_record.log_record_type_ == LogRecordType::INSERT)
+      return DeserializeTuple(pos, end, log_record.insert_tuple_);
+    if (log_record.log_record_type_ == LogRecordType::UPDATE)
+      return DeserializeTuple(pos, end, log_record.old_tuple_) &&
+             DeserializeTuple(pos, end, log_record.new_tuple_);
+    return DeserializeTuple(pos, end, log_record.delete_tuple_);
+  case LogRecordType::NEWPAGE:
+    if (end - pos < static_cast<ptrdiff_t>(2 * sizeof(page_id_t)))
+      return false;
+    memcpy(&log_record.prev_page_id_, pos, sizeof(page_id_t));
+    memcpy(&log_record.page_id_, pos + sizeof(page_id_t), sizeof(page_id_t));
+    return true;
+  case LogRecordType::CHECKPOINT: {
+    int32_t count;
+    if (end - pos < static_cast<ptrdiff_t>(sizeof(lsn_t) + sizeof(uint64_t) +
+                                           sizeof(int32_t)))
+      return false;
+    memcpy(&log_record.begin_lsn_, pos, sizeof(lsn_t));
+    memcpy(&log_record.log_offset_, pos + sizeof(lsn_t), sizeof(uint64_t));
+    pos += sizeof(lsn_t) + sizeof(uint64_t);
+    memcpy(&count, pos, sizeof(int32_t));
+    pos += sizeof(int32_t);
+    log_record.active_txns_.clear();
+    for (; count > 0; --count) {
+      if (end - pos < static_cast<ptrdiff_t>(sizeof(txn_id_t) + sizeof(lsn_t)))
+        return false;
+      std::pair<txn_id_t, lsn_t> txn;
+      memcpy(&txn.first, pos, sizeof(txn_id_t));
+      memcpy(&txn.second, pos + sizeof(txn_id_t), sizeof(lsn_t));
+      log_record.active_txns_.push_back(txn);
+      pos += sizeof(txn_id_t) + sizeof(lsn_t);
+    }
+    if (end - pos < static_cast<ptrdiff_t>(sizeof(int32_t))) return false;
+    memcpy(&count, pos, sizeof(int32_t));
+    pos += sizeof(int32_t);
+    log_record.dirty_pages_.clear();
+    for (; count > 0; --count) {
+      if (end - pos < static_cast<ptrdiff_t>(sizeof(page_id_t) + sizeof(lsn_t)))
+        return false;
+      std::pair<page_id_t, lsn_t> page;
+      memcpy(&page.first, pos, sizeof(page_id_t));
+      memcpy(&page.second, pos + sizeof(page_id_t), sizeof(lsn_t));
+      log_record.dirty_pages_.push_back(page);
+      pos += sizeof(page_id_t) + sizeof(lsn_t);
+    }
+    return true;
+  }
+  default:
+    return true;
+  }
 }
 
 /*
@@ -22,13 +123,432 @@ bool LogRecovery::DeserializeLogRecord(const char *data,
  *log buffer to reduce unnecessary I/O operations), remember to compare page's
  *LSN with log_record's sequence number, and also build active_txn_ table &
  *lsn_mapping_ table
+ * With num_workers > 0 the records are applied by that many threads, each
+ * one owning the pages whose id modulo num_workers is its number. A NEWPAGE
+ * record goes to the owner of the new page and to the owner of the page it
+ * is linked from.
+ * The log is read from the start of the last checkpoint if there is one.
  */
-void LogRecovery::Redo() {}
+void LogRecovery::Redo(size_t num_workers) {
+  active_txn_.clear();
+  lsn_mapping_.clear();
+  dirty_pages_.clear();
+  begin_lsn_ = INVALID_LSN;
+  next_lsn_ = 0;
+  expected_lsn_ = INVALID_LSN;
+  offset_ = pos_ = end_ = 0;
+  ReadCheckpoint();
+
+  std::vector<RedoQueue> queues(num_workers);
+  std::vector<std::vector<LogRecord *>> batches(num_workers);
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < num_workers; ++i) {
+    workers.push_back(std::thread([this, &queues, i, num_workers] {
+      RunRedoWorker(queues[i], i, num_workers);
+    }));
+  }
+
+  LogRecord *log_record = new LogRecord;
+  size_t offset;
+  while (ReadNextLogRecord(*log_record, offset)) {
+    next_lsn_ = std::max(next_lsn_, log_record->lsn_ + 1);
+    TrackTransaction(*log_record, offset);
+    if (num_workers == 0) {
+      RedoLogRecord(*log_record, -1, 0);
+      continue;
+    }
+    size_t partition;
+    switch (log_record->log_record_type_) {
+    case LogRecordType::BEGIN:
+    case LogRecordType::COMMIT:
+    case LogRecordType::ABORT:
+    case LogRecordType::CHECKPOINT:
+      continue;
+    case LogRecordType::NEWPAGE:
+      partition = log_record->page_id_ % num_workers;
+      if (log_record->prev_page_id_ != INVALID_PAGE_ID &&
+          log_record->prev_page_id_ % num_workers != partition) {
+        size_t prev_partition = log_record->prev_page_id_ % num_workers;
+        batches[prev_partition].push_back(new LogRecord(*log_record));
+        Dispatch(queues[prev_partition], batches[prev_partition]);
+      }
+      break;
+    default:
+      partition = GetRID(*log_record).GetPageId() % num_workers;
+      break;
+    }
+    batches[partition].push_back(log_record);
+    Dispatch(queues[partition], batches[partition]);
+    log_record = new LogRecord;
+  }
+  delete log_record;
+
+  for (size_t i = 0; i < num_workers; ++i) {
+    {
+      std::lock_guard<std::mutex> guard(queues[i].latch_);
+      if (!batches[i].empty())
+        queues[i].batches_.push_back(std::move(batches[i]));
+      queues[i].done_ = true;
+    }
+    queues[i].cv_.notify_all();
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
 
 /*
  *undo phase on TABLE PAGE level(table/table_page.h)
  *iterate through active txn map and undo each operation
+ * The records of all active transactions are undone latest first. Records
+ * are read back from the log around the latest one, so that undoing a tail
+ * of the log takes few reads.
+ */
+void LogRecovery::Undo() {
+  std::priority_queue<lsn_t> lsns;
+  for (auto &txn : active_txn_) {
+    lsns.push(txn.second);
+  }
+  offset_ = pos_ = end_ = 0;
+  while (!lsns.empty()) {
+    lsn_t lsn = lsns.top();
+    lsns.pop();
+    auto location = lsn_mapping_.find(lsn);
+    if (location == lsn_mapping_.end()) continue;
+    size_t offset = location->second.offset_;
+    LogRecord log_record;
+    if (offset < offset_ ||
+        !DeserializeLogRecord(log_buffer_ + (offset - offset_),
+                              end_ - std::min(end_, offset - offset_),
+                              log_record)) {
+      // the record ends up in the second half of the buffer
+      offset_ = offset > log_buffer_size_ / 2 ? offset - log_buffer_size_ / 2
+                                              : 0;
+      end_ = disk_manager_->ReadLog(log_buffer_, log_buffer_size_, offset_)
+                 ? log_buffer_size_
+                 : 0;
+      bool complete = DeserializeLogRecord(log_buffer_ + (offset - offset_),
+                                           end_ - (offset - offset_),
+                                           log_record);
+      assert(complete);
+      (void)complete;
+    }
+    assert(log_record.lsn_ == lsn);
+    UndoLogRecord(log_record);
+    if (location->second.prev_lsn_ != INVALID_LSN)
+      lsns.push(location->second.prev_lsn_);
+  }
+  active_txn_.clear();
+  lsn_mapping_.clear();
+}
+
+/*
+ * Find the checkpoint record the master record points to, take over its
+ * active transaction and dirty page tables and position the log buffer at
+ * the start of redo.
+ * @return: false without a master record or if the record is not in the
+ * log, the whole log is read then
+ */
+bool LogRecovery::ReadCheckpoint() {
+  lsn_t checkpoint_lsn;
+  size_t offset;
+  if (!disk_manager_->ReadMasterRecord(checkpoint_lsn, offset)) return false;
+  offset_ = offset;
+  LogRecord log_record;
+  while (ReadNextLogRecord(log_record, offset) &&
+         log_record.lsn_ <= checkpoint_lsn) {
+    if (log_record.lsn_ != checkpoint_lsn ||
+        log_record.log_record_type_ != LogRecordType::CHECKPOINT)
+      continue;
+    begin_lsn_ = log_record.begin_lsn_;
+    for (auto &txn : log_record.active_txns_) {
+      active_txn_[txn.first] = txn.second;
+    }
+    for (auto &page : log_record.dirty_pages_) {
+      dirty_pages_[page.first] = page.second;
+    }
+    offset_ = log_record.log_offset_;
+    pos_ = end_ = 0;
+    expected_lsn_ = INVALID_LSN;
+    return true;
+  }
+  LOG_DEBUG("checkpoint %d not found", checkpoint_lsn);
+  offset_ = pos_ = end_ = 0;
+  expected_lsn_ = INVALID_LSN;
+  return false;
+}
+
+/*
+ * The next record of the log and its offset in the log file, reading ahead
+ * RECOVERY_READ_SIZE at a time. A record cut by the end of the log buffer is
+ * moved to its front and the rest read after it. The log ends where a run
+ * of appends ends, reading goes on with the next run if there is one.
+ * The lsns of a run are dense: a record that does not have the lsn after
+ * the one before it is what a recycled segment held before, left behind a
+ * torn write of the end of the log, and ends the run as well.
+ * @return: false at the end of the log
+ */
+bool LogRecovery::ReadNextLogRecord(LogRecord &log_record, size_t &offset) {
+  while (!DeserializeLogRecord(log_buffer_ + pos_, end_ - pos_, log_record) ||
+         (expected_lsn_ != INVALID_LSN && log_record.lsn_ != expected_lsn_)) {
+    // a whole buffer that does not start with a record
+    if (pos_ == 0 && end_ == log_buffer_size_) {
+      size_t next_run = disk_manager_->GetNextLogRun(offset_);
+      if (next_run <= offset_) return false;
+      offset_ = next_run;
+      end_ = 0;
+      expected_lsn_ = INVALID_LSN;
+      continue;
+    }
+    memmove(log_buffer_, log_buffer_ + pos_, end_ - pos_);
+    offset_ += pos_;
+    end_ -= pos_;
+    pos_ = 0;
+    if (!disk_manager_->ReadLog(log_buffer_ + end_, log_buffer_size_ - end_,
+                                offset_ + end_))
+      return false;
+    end_ = log_buffer_size_;
+  }
+  offset = offset_ + pos_;
+  pos_ += log_record.size_;
+  expected_lsn_ = log_record.lsn_ + 1;
+  return true;
+}
+
+/*
+ * Maintain active_txn_ and lsn_mapping_ with a record read by redo. The
+ * records of a transaction are forgotten once it commits or aborts.
+ */
+void LogRecovery::TrackTransaction(const LogRecord &log_record,
+                                   size_t offset) {
+  txn_id_t txn_id = log_record.txn_id_;
+  if (log_record.log_record_type_ == LogRecordType::CHECKPOINT) return;
+  if (log_record.log_record_type_ == LogRecordType::COMMIT ||
+      log_record.log_record_type_ == LogRecordType::ABORT) {
+    lsn_t lsn = log_record.prev_lsn_;
+    for (auto location = lsn_mapping_.find(lsn);
+         location != lsn_mapping_.end(); location = lsn_mapping_.find(lsn)) {
+      lsn = location->second.prev_lsn_;
+      lsn_mapping_.erase(location);
+    }
+    active_txn_.erase(txn_id);
+    return;
+  }
+  active_txn_[txn_id] = log_record.lsn_;
+  lsn_mapping_[log_record.lsn_] = {offset, log_record.prev_lsn_};
+}
+
+/*
+ * Queue a full batch of records to its redo worker, waits while the worker
+ * is REDO_QUEUE_DEPTH batches behind
  */
-void LogRecovery::Undo() {}
+void LogRecovery::Dispatch(RedoQueue &queue, std::vector<LogRecord *> &batch) {
+  if (batch.size() < REDO_BATCH_SIZE) return;
+  {
+    std::unique_lock<std::mutex> lock(queue.latch_);
+    queue.cv_.wait(lock, [&queue] {
+      return queue.batches_.size() < REDO_QUEUE_DEPTH;
+    });
+    queue.batches_.push_back(std::move(batch));
+  }
+  queue.cv_.notify_all();
+  batch.clear();
+  batch.reserve(REDO_BATCH_SIZE);
+}
+
+/*
+ * Body of a redo worker: apply the batches of its queue until it is done
+ */
+void LogRecovery::RunRedoWorker(RedoQueue &queue, int partition,
+                                size_t num_partitions) {
+  while (true) {
+    std::vector<LogRecord *> batch;
+    {
+      std::unique_lock<std::mutex> lock(queue.latch_);
+      queue.cv_.wait(lock,
+                     [&queue] { return !queue.batches_.empty() || queue.done_; });
+      if (queue.batches_.empty()) return;
+      batch = std::move(queue.batches_.front());
+      queue.batches_.pop_front();
+    }
+    queue.cv_.notify_all();
+    for (LogRecord *log_record : batch) {
+      RedoLogRecord(*log_record, partition, num_partitions);
+      delete log_record;
+    }
+  }
+}
+
+/*
+ * A change at lsn to the page is not known to be on disk, see above
+ */
+bool LogRecovery::NeedsRedo(page_id_t page_id, lsn_t lsn) const {
+  if (begin_lsn_ == INVALID_LSN || lsn >= begin_lsn_) return true;
+  auto page = dirty_pages_.find(page_id);
+  return page != dirty_pages_.end() && lsn >= page->second;
+}
+
+/*
+ * Apply a record to the pages of partition, unless the page has it already
+ */
+void LogRecovery::RedoLogRecord(LogRecord &log_record, int partition,
+                                size_t num_partitions) {
+  lsn_t lsn = log_record.lsn_;
+  switch (log_record.log_record_type_) {
+  case LogRecordType::BEGIN:
+  case LogRecordType::COMMIT:
+  case LogRecordType::ABORT:
+  case LogRecordType::CHECKPOINT:
+    return;
+  case LogRecordType::NEWPAGE: {
+    page_id_t page_id = log_record.page_id_;
+    page_id_t prev_page_id = log_record.prev_page_id_;
+    if (OwnsPage(page_id, partition, num_partitions) &&
+        NeedsRedo(page_id, lsn)) {
+      TablePage *page = FetchTablePage(page_id);
+      bool redo = page->GetLSN() < lsn;
+      if (redo) {
+        page->Init(page_id, disk_manager_->GetPageSize(), prev_page_id,
+                   nullptr, nullptr);
+        page->SetLSN(lsn);
+      }
+      ReleaseTablePage(page, redo);
+    }
+    // the link from the previous page is not logged on its own, the
+    // previous page takes the lsn of the record
+    if (prev_page_id != INVALID_PAGE_ID &&
+        OwnsPage(prev_page_id, partition, num_partitions) &&
+        NeedsRedo(prev_page_id, lsn)) {
+      TablePage *prev_page = FetchTablePage(prev_page_id);
+      bool redo = prev_page->GetLSN() < lsn;
+      if (redo) {
+        prev_page->SetNextPageId(page_id);
+        prev_page->SetLSN(lsn);
+      }
+      ReleaseTablePage(prev_page, redo);
+    }
+    return;
+  }
+  default:
+    break;
+  }
+
+  RID &rid = GetRID(log_record);
+  if (!NeedsRedo(rid.GetPageId(), lsn)) return;
+  TablePage *page = FetchTablePage(rid.GetPageId());
+  if (page->GetLSN() >= lsn) {
+    ReleaseTablePage(page, false);
+    return;
+  }
+  switch (log_record.log_record_type_) {
+  case LogRecordType::INSERT: {
+    RID insert_rid;
+    bool inserted = page->InsertTuple(log_record.insert_tuple_, insert_rid,
+                                      nullptr, nullptr, nullptr);
+    assert(inserted && insert_rid == rid);
+    (void)inserted;
+    break;
+  }
+  case LogRecordType::MARKDELETE:
+    page->MarkDelete(rid, nullptr, nullptr, nullptr);
+    break;
+  case LogRecordType::APPLYDELETE:
+    page->ApplyDelete(rid, nullptr, nullptr);
+    break;
+  case LogRecordType::ROLLBACKDELETE:
+    page->RollbackDelete(rid, nullptr, nullptr);
+    break;
+  case LogRecordType::UPDATE: {
+    Tuple old_tuple;
+    page->UpdateTuple(log_record.new_tuple_, old_tuple, rid, nullptr, nullptr,
+                      nullptr);
+    break;
+  }
+  default:
+    break;
+  }
+  page->SetLSN(lsn);
+  ReleaseTablePage(page, true);
+}
+
+/*
+ * Revert the change of a record of a transaction that did not finish
+ */
+void LogRecovery::UndoLogRecord(LogRecord &log_record) {
+  switch (log_record.log_record_type_) {
+  case LogRecordType::INSERT:
+  case LogRecordType::MARKDELETE:
+  case LogRecordType::APPLYDELETE:
+  case LogRecordType::ROLLBACKDELETE:
+  case LogRecordType::UPDATE:
+    break;
+  default:
+    // a new page stays in its table, empty
+    return;
+  }
+
+  RID &rid = GetRID(log_record);
+  TablePage *page = FetchTablePage(rid.GetPageId());
+  switch (log_record.log_record_type_) {
+  case LogRecordType::INSERT:
+    page->ApplyDelete(rid, nullptr, nullptr);
+    break;
+  case LogRecordType::MARKDELETE:
+    page->RollbackDelete(rid, nullptr, nullptr);
+    break;
+  case LogRecordType::APPLYDELETE: {
+    RID insert_rid;
+    page->InsertTuple(log_record.delete_tuple_, insert_rid, nullptr, nullptr,
+                      nullptr);
+    break;
+  }
+  case LogRecordType::ROLLBACKDELETE:
+    page->MarkDelete(rid, nullptr, nullptr, nullptr);
+    break;
+  case LogRecordType::UPDATE: {
+    Tuple new_tuple;
+    page->UpdateTuple(log_record.old_tuple_, new_tuple, rid, nullptr, nullptr,
+                      nullptr);
+    break;
+  }
+  default:
+    break;
+  }
+  ReleaseTablePage(page, true);
+}
+
+/*
+ * Pin and write latch a table page. Every redo worker pins one page at a
+ * time, so the buffer pool only runs out of frames if it is smaller than
+ * the number of workers.
+ */
+TablePage *LogRecovery::FetchTablePage(page_id_t page_id) {
+  TablePage *page =
+      static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  assert(page != nullptr);
+  page->WLatch();
+  return page;
+}
+
+void LogRecovery::ReleaseTablePage(TablePage *page, bool is_dirty) {
+  // the frame's page id, the one in the data may not be written yet
+  page_id_t page_id = page->Page::GetPageId();
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, is_dirty);
+}
+
+/*
+ * The tuple a record of a tuple operation is about
+ */
+RID &LogRecovery::GetRID(LogRecord &log_record) {
+  switch (log_record.log_record_type_) {
+  case LogRecordType::INSERT:
+    return log_record.insert_rid_;
+  case LogRecordType::UPDATE:
+    return log_record.update_rid_;
+  default:
+    return log_record.delete_rid_;
+  }
+}
 
 } // namespace cmudb
@@ -14,16 +14,17 @@ namespace cmudb {
 /*
  * Init method after creating a new internal page
  * Including set page type, set current size, set page id, set parent id and set
- * max page size
+ * max page size (fill the page_size bytes of the page)
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id,
-                                          page_id_t parent_id) {
+                                          page_id_t parent_id,
+                                          size_t page_size) {
     SetSize(0);
     SetPageId(page_id);
     SetParentPageId(parent_id);
     SetPageType(IndexPageType::INTERNAL_PAGE);
-    SetMaxSize((PAGE_SIZE - sizeof(BPlusTreeInternalPage)) /
+    SetMaxSize((page_size - sizeof(BPlusTreeInternalPage)) /
     (sizeof(KeyType) + sizeof(ValueType)) - 1);
 }
 /*
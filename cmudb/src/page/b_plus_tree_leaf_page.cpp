@@ -18,16 +18,17 @@ namespace cmudb {
 /**
  * Init method after creating a new leaf page
  * Including set page type, set current size to zero, set page id/parent id, set
- * next page id and set max size
+ * next page id and set max size (fill the page_size bytes of the page)
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id) {
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id,
+                                      size_t page_size) {
     SetSize(0);
     SetPageId(page_id);
     SetParentPageId(parent_id);
     SetNextPageId(INVALID_PAGE_ID);
     SetPageType(IndexPageType::LEAF_PAGE);
-    SetMaxSize((PAGE_SIZE - sizeof(BPlusTreeLeafPage)) / (sizeof(KeyType) + sizeof(ValueType))  - 1);
+    SetMaxSize((page_size - sizeof(BPlusTreeLeafPage)) / (sizeof(KeyType) + sizeof(ValueType))  - 1);
 }
 
 /**
@@ -0,0 +1,147 @@
+/**
+ * hash_table_bucket_page.cpp
+ */
+
+#include <cassert>
+
+#include "common/rid.h"
+#include "page/hash_table_bucket_page.h"
+
+namespace cmudb {
+
+/*****************************************************************************
+ * HELPER METHODS AND UTILITIES
+ *****************************************************************************/
+
+/**
+ * Init method after creating a new bucket page
+ * Including set page id, set current size to zero, set next page id and set
+ * max size (fill the page_size bytes of the page)
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void HASH_TABLE_BUCKET_TYPE::Init(page_id_t page_id, size_t page_size) {
+    page_id_ = page_id;
+    SetLSN();
+    size_ = 0;
+    max_size_ = (page_size - sizeof(HashTableBucketPage)) / sizeof(MappingType);
+    SetNextPageId(INVALID_PAGE_ID);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t HASH_TABLE_BUCKET_TYPE::GetPageId() const { return page_id_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+void HASH_TABLE_BUCKET_TYPE::SetLSN(lsn_t lsn) { lsn_ = lsn; }
+
+INDEX_TEMPLATE_ARGUMENTS
+int HASH_TABLE_BUCKET_TYPE::GetSize() const { return size_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+int HASH_TABLE_BUCKET_TYPE::GetMaxSize() const { return max_size_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+bool HASH_TABLE_BUCKET_TYPE::IsFull() const { return size_ >= max_size_; }
+
+/**
+ * Helper methods to set/get next page id of the overflow chain
+ */
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t HASH_TABLE_BUCKET_TYPE::GetNextPageId() const { return next_page_id_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+void HASH_TABLE_BUCKET_TYPE::SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+
+/*
+ * Helper method to find and return the key associated with input "index"(a.k.a
+ * array offset)
+ */
+INDEX_TEMPLATE_ARGUMENTS
+KeyType HASH_TABLE_BUCKET_TYPE::KeyAt(int index) const { return array[index].first; }
+
+/*
+ * Helper method to find and return the key & value pair associated with input
+ * "index"(a.k.a array offset)
+ */
+INDEX_TEMPLATE_ARGUMENTS
+const MappingType &HASH_TABLE_BUCKET_TYPE::GetItem(int index) { return array[index]; }
+
+/*
+ * Helper method to find the index of key, -1 if the page does not hold it
+ */
+INDEX_TEMPLATE_ARGUMENTS
+int HASH_TABLE_BUCKET_TYPE::KeyIndex(const KeyType &key,
+                                     const KeyComparator &comparator) const {
+    for (int i = 0; i < size_; ++i) {
+        if (!comparator(array[i].first, key)) return i;
+    }
+    return -1;
+}
+
+/*****************************************************************************
+ * INSERTION
+ *****************************************************************************/
+/*
+ * Append key & value pair, the caller checked that the page is not full and
+ * that the key is not in the bucket yet
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void HASH_TABLE_BUCKET_TYPE::Insert(const KeyType &key, const ValueType &value) {
+    assert(!IsFull());
+    array[size_].first = key;
+    array[size_].second = value;
+    ++size_;
+}
+
+/*****************************************************************************
+ * LOOKUP
+ *****************************************************************************/
+/*
+ * For the given key, check to see whether it exists in the bucket page. If it
+ * does, then store its corresponding value in input "value" and return true.
+ * If the key does not exist, then return false
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool HASH_TABLE_BUCKET_TYPE::Lookup(const KeyType &key, ValueType &value,
+                                    const KeyComparator &comparator) const {
+    int index = KeyIndex(key, comparator);
+    if (index < 0) return false;
+    value = array[index].second;
+    return true;
+}
+
+/*****************************************************************************
+ * REMOVE
+ *****************************************************************************/
+/*
+ * First look through the bucket page to see whether delete key exist or not.
+ * If exist, perform deletion, otherwise return immediately.
+ * @return  true if the key was removed
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool HASH_TABLE_BUCKET_TYPE::Remove(const KeyType &key,
+                                    const KeyComparator &comparator) {
+    int index = KeyIndex(key, comparator);
+    if (index < 0) return false;
+    RemoveAt(index);
+    return true;
+}
+
+/*
+ * Remove the pair at index, the last pair takes its place
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void HASH_TABLE_BUCKET_TYPE::RemoveAt(int index) {
+    array[index] = array[--size_];
+}
+
+template class HashTableBucketPage<GenericKey<4>, RID,
+                                   GenericComparator<4>>;
+template class HashTableBucketPage<GenericKey<8>, RID,
+                                   GenericComparator<8>>;
+template class HashTableBucketPage<GenericKey<16>, RID,
+                                   GenericComparator<16>>;
+template class HashTableBucketPage<GenericKey<32>, RID,
+                                   GenericComparator<32>>;
+template class HashTableBucketPage<GenericKey<64>, RID,
+                                   GenericComparator<64>>;
+} // namespace cmudb
@@ -0,0 +1,87 @@
+/**
+ * hash_table_directory_page.cpp
+ */
+
+#include <cassert>
+#include <cstring>
+
+#include "page/hash_table_directory_page.h"
+
+namespace cmudb {
+
+/**
+ * Init method after creating a new directory page
+ * Including set page id, set global depth to zero and set max depth (the
+ * largest directory whose slots fill the page_size bytes of the page)
+ */
+void HashTableDirectoryPage::Init(page_id_t page_id, size_t page_size) {
+    SetPageId(page_id);
+    SetLSN();
+    global_depth_ = 0;
+    max_depth_ = 0;
+    while (sizeof(HashTableDirectoryPage) +
+               (static_cast<size_t>(2) << max_depth_) *
+                   (sizeof(page_id_t) + sizeof(uint8_t)) <=
+           page_size) {
+        ++max_depth_;
+    }
+    SetBucketPageId(0, INVALID_PAGE_ID);
+    SetLocalDepth(0, 0);
+}
+
+/*
+ * Helper methods to get/set page id and lsn
+ */
+page_id_t HashTableDirectoryPage::GetPageId() const { return page_id_; }
+void HashTableDirectoryPage::SetPageId(page_id_t page_id) { page_id_ = page_id; }
+void HashTableDirectoryPage::SetLSN(lsn_t lsn) { lsn_ = lsn; }
+
+/*
+ * Helper methods to get global depth and its derived values
+ */
+int HashTableDirectoryPage::GetGlobalDepth() const { return global_depth_; }
+int HashTableDirectoryPage::GetMaxDepth() const { return max_depth_; }
+uint32_t HashTableDirectoryPage::GetGlobalDepthMask() const { return Size() - 1; }
+uint32_t HashTableDirectoryPage::Size() const { return 1u << global_depth_; }
+
+/*
+ * Double the directory: every new slot points to the bucket of the slot it
+ * differs from only in the new top bit
+ */
+void HashTableDirectoryPage::IncrGlobalDepth() {
+    assert(global_depth_ < max_depth_);
+    uint32_t size = Size();
+    memcpy(bucket_page_ids_ + size, bucket_page_ids_, size * sizeof(page_id_t));
+    memcpy(LocalDepths() + size, LocalDepths(), size);
+    ++global_depth_;
+}
+
+/*
+ * Helper methods to get/set the bucket page and local depth of a slot
+ */
+page_id_t HashTableDirectoryPage::GetBucketPageId(uint32_t slot) const {
+    return bucket_page_ids_[slot];
+}
+
+void HashTableDirectoryPage::SetBucketPageId(uint32_t slot, page_id_t bucket_page_id) {
+    bucket_page_ids_[slot] = bucket_page_id;
+}
+
+int HashTableDirectoryPage::GetLocalDepth(uint32_t slot) const { return LocalDepths()[slot]; }
+
+void HashTableDirectoryPage::SetLocalDepth(uint32_t slot, int local_depth) {
+    LocalDepths()[slot] = local_depth;
+}
+
+/*
+ * Local depths are stored right after the largest directory
+ */
+const uint8_t *HashTableDirectoryPage::LocalDepths() const {
+    return reinterpret_cast<const uint8_t *>(bucket_page_ids_ + (1u << max_depth_));
+}
+
+uint8_t *HashTableDirectoryPage::LocalDepths() {
+    return reinterpret_cast<uint8_t *>(bucket_page_ids_ + (1u << max_depth_));
+}
+
+} // namespace cmudb
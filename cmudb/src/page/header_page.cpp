@@ -17,7 +17,7 @@ bool HeaderPage::InsertRecord(const std::string &name,
   assert(root_id > INVALID_PAGE_ID);
 
   int record_num = GetRecordCount();
-  int offset = 4 + record_num * 36;
+  int offset = RecordOffset(record_num);
   // check for duplicate name
   if (FindRecord(name) != -1)
     return false;
@@ -37,7 +37,7 @@ bool HeaderPage::DeleteRecord(const std::string &name) {
   // record does not exsit
   if (index == -1)
     return false;
-  int offset = index * 36 + 4;
+  int offset = RecordOffset(index);
   memmove(GetData() + offset, GetData() + offset + 36,
           (record_num - index - 1) * 36);
 
@@ -53,7 +53,7 @@ bool HeaderPage::UpdateRecord(const std::string &name,
   // record does not exsit
   if (index == -1)
     return false;
-  int offset = index * 36 + 4;
+  int offset = RecordOffset(index);
   // update record content, only root_id
   memcpy((GetData() + offset + 32), &root_id, 4);
 
@@ -67,7 +67,7 @@ bool HeaderPage::GetRootId(const std::string &name, page_id_t &root_id) {
   // record does not exsit
   if (index == -1)
     return false;
-  int offset = (index + 1) * 36;
+  int offset = RecordOffset(index) + 32;
   root_id = *reinterpret_cast<page_id_t *>(GetData() + offset);
 
   return true;
@@ -83,11 +83,46 @@ void HeaderPage::SetRecordCount(int record_count) {
   memcpy(GetData(), &record_count, 4);
 }
 
+// format and page size
+size_t HeaderPage::ReadPageSize(const char *data) {
+  if (*reinterpret_cast<const uint32_t *>(data + 4) != HEADER_PAGE_FORMAT)
+    return 0;
+  return *reinterpret_cast<const uint32_t *>(data + 8);
+}
+
+bool HeaderPage::IsOlderFormat(const char *data) {
+  if (ReadPageSize(data) != 0)
+    return false;
+  int record_count = *reinterpret_cast<const int *>(data);
+  if (record_count <= 0 || 4 + record_count * 36 > OLD_FORMAT_PAGE_SIZE)
+    return false;
+  for (int i = 0; i < record_count; i++) {
+    const char *name = data + 4 + i * 36;
+    if (name[0] == '\0' || memchr(name, '\0', 32) == nullptr)
+      return false;
+  }
+  return true;
+}
+void HeaderPage::SetFormat() {
+  uint32_t format = HEADER_PAGE_FORMAT;
+  memcpy(GetData() + 4, &format, 4);
+}
+
+void HeaderPage::SetPageSize(size_t page_size) {
+  uint32_t size = page_size;
+  memcpy(GetData() + 8, &size, 4);
+}
+
+int HeaderPage::RecordOffset(int index) {
+  int first = ReadPageSize(GetData()) == 0 ? 4 : HEADER_PAGE_PREFIX_SIZE;
+  return first + index * 36;
+}
+
 int HeaderPage::FindRecord(const std::string &name) {
   int record_num = GetRecordCount();
 
   for (int i = 0; i < record_num; i++) {
-    char *raw_name = reinterpret_cast<char *>(GetData() + (4 + i * 36));
+    char *raw_name = reinterpret_cast<char *>(GetData() + RecordOffset(i));
     if (strcmp(raw_name, name.c_str()) == 0)
       return i;
   }
@@ -15,7 +15,11 @@ void TablePage::Init(page_id_t page_id, size_t page_size,
                      Transaction *txn) {
   memcpy(GetData(), &page_id, 4); // set page_id
   if (ENABLE_LOGGING) {
-    // TODO: add your logging logic here
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::NEWPAGE, prev_page_id, page_id);
+    lsn_t lsn = log_manager->AppendLogRecord(log_record);
+    txn->SetPrevLSN(lsn);
+    SetLSN(lsn);
   }
   SetPrevPageId(prev_page_id);
   SetNextPageId(INVALID_PAGE_ID);
@@ -35,6 +39,10 @@ page_id_t TablePage::GetNextPageId() {
   return *reinterpret_cast<page_id_t *>(GetData() + 12);
 }
 
+page_id_t TablePage::ReadNextPageId(const char *data) {
+  return *reinterpret_cast<const page_id_t *>(data + 12);
+}
+
 void TablePage::SetPrevPageId(page_id_t prev_page_id) {
   memcpy(GetData() + 8, &prev_page_id, 4);
 }
@@ -87,7 +95,11 @@ bool TablePage::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn,
   if (ENABLE_LOGGING) {
     // acquire the exclusive lock
     assert(lock_manager->LockExclusive(txn, rid.Get()));
-    // TODO: add your logging logic here
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::INSERT, rid, tuple);
+    lsn_t lsn = log_manager->AppendLogRecord(log_record);
+    txn->SetPrevLSN(lsn);
+    SetLSN(lsn);
   }
   // LOG_DEBUG("Tuple inserted");
   return true;
@@ -128,7 +140,18 @@ bool TablePage::MarkDelete(const RID &rid, Transaction *txn,
                !lock_manager->LockExclusive(txn, rid)) { // no shared lock
       return false;
     }
-    // TODO: add your logging logic here
+    // the tuple is logged for undo
+    Tuple delete_tuple;
+    delete_tuple.size_ = tuple_size;
+    delete_tuple.data_ = new char[tuple_size];
+    memcpy(delete_tuple.data_, GetData() + GetTupleOffset(slot_num), tuple_size);
+    delete_tuple.rid_ = rid;
+    delete_tuple.allocated_ = true;
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::MARKDELETE, rid, delete_tuple);
+    lsn_t lsn = log_manager->AppendLogRecord(log_record);
+    txn->SetPrevLSN(lsn);
+    SetLSN(lsn);
   }
 
   // set tuple size to negative value
@@ -182,7 +205,11 @@ bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple,
                !lock_manager->LockExclusive(txn, rid)) { // no shared lock
       return false;
     }
-    // TODO: add your logging logic here
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::UPDATE, rid, old_tuple, new_tuple);
+    lsn_t lsn = log_manager->AppendLogRecord(log_record);
+    txn->SetPrevLSN(lsn);
+    SetLSN(lsn);
   }
 
   // update
@@ -234,7 +261,11 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn,
     // must already grab the exclusive lock
     assert(txn->GetExclusiveLockSet()->find(rid) !=
            txn->GetExclusiveLockSet()->end());
-    // TODO: add your logging logic here
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::APPLYDELETE, rid, delete_tuple);
+    lsn_t lsn = log_manager->AppendLogRecord(log_record);
+    txn->SetPrevLSN(lsn);
+    SetLSN(lsn);
   }
 
   int32_t free_space_pointer =
@@ -265,14 +296,28 @@ void TablePage::RollbackDelete(const RID &rid, Transaction *txn,
     // must have already grab the exclusive lock
     assert(txn->GetExclusiveLockSet()->find(rid) !=
            txn->GetExclusiveLockSet()->end());
-
-    // TODO: add your logging logic here
   }
 
   int slot_num = rid.GetSlotNum();
   assert(slot_num < GetTupleCount());
   int32_t tuple_size = GetTupleSize(slot_num);
 
+  if (ENABLE_LOGGING) {
+    // the tuple is logged for redo
+    int32_t size = tuple_size < 0 ? -tuple_size : tuple_size;
+    Tuple delete_tuple;
+    delete_tuple.size_ = size;
+    delete_tuple.data_ = new char[size];
+    memcpy(delete_tuple.data_, GetData() + GetTupleOffset(slot_num), size);
+    delete_tuple.rid_ = rid;
+    delete_tuple.allocated_ = true;
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::ROLLBACKDELETE, rid, delete_tuple);
+    lsn_t lsn = log_manager->AppendLogRecord(log_record);
+    txn->SetPrevLSN(lsn);
+    SetLSN(lsn);
+  }
+
   // set tuple size to positive value
   if (tuple_size < 0)
     SetTupleSize(slot_num, -tuple_size);
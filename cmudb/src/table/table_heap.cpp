@@ -28,13 +28,16 @@ TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager,
   first_page->WLatch();
   LOG_DEBUG("new table page created %d", first_page_id_);
 
-  first_page->Init(first_page_id_, PAGE_SIZE, INVALID_LSN, log_manager_, txn);
+  first_page->Init(first_page_id_, buffer_pool_manager_->GetPageSize(),
+                   INVALID_LSN, log_manager_, txn);
   first_page->WUnlatch();
   buffer_pool_manager_->UnpinPage(first_page_id_, true);
 }
 
 bool TableHeap::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn) {
-  if (tuple.size_ + 32 > PAGE_SIZE) { // larger than one page size
+  if (static_cast<size_t>(tuple.size_) + 32 >
+      buffer_pool_manager_->GetPageSize()) {
+    // larger than one page size
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
@@ -58,8 +61,8 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn) {
           buffer_pool_manager_->FetchPage(next_page_id));
       cur_page->WLatch();
     } else { // create new page
-      auto new_page =
-          static_cast<TablePage *>(buffer_pool_manager_->NewPage(next_page_id));
+      auto new_page = static_cast<TablePage *>(
+          buffer_pool_manager_->NewPage(next_page_id, cur_page->GetPageId()));
       if (new_page == nullptr) {
         cur_page->WUnlatch();
         buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), false);
@@ -70,8 +73,10 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn) {
       // std::cout << "new table page " << next_page_id << " created" <<
       // std::endl;
       cur_page->SetNextPageId(next_page_id);
-      new_page->Init(next_page_id, PAGE_SIZE, cur_page->GetPageId(),
-                     log_manager_, txn);
+      new_page->Init(next_page_id, buffer_pool_manager_->GetPageSize(),
+                     cur_page->GetPageId(), log_manager_, txn);
+      // the link to the new page is a change of this page as well
+      if (ENABLE_LOGGING) cur_page->SetLSN(new_page->GetLSN());
       cur_page->WUnlatch();
       buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), true);
       cur_page = new_page;
@@ -159,17 +164,25 @@ bool TableHeap::DeleteTableHeap() {
   return true;
 }
 
-TableIterator TableHeap::begin(Transaction *txn) {
-  auto page =
-      static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
+TableIterator TableHeap::begin(Transaction *txn, bool bulk_read) {
+  std::shared_ptr<BufferRing> buffer_ring;
+  if (bulk_read) {
+    buffer_ring =
+        std::make_shared<BufferRing>(buffer_pool_manager_, SCAN_RING_SIZE);
+  }
+  auto page = static_cast<TablePage *>(
+      buffer_pool_manager_->FetchPage(first_page_id_, buffer_ring.get()));
   page->RLatch();
   RID rid;
   // if failed (no tuple), rid will be the result of default
   // constructor, which means eof
   page->GetFirstTupleRid(rid);
+  // start reading ahead, the iterator keeps it going
+  buffer_pool_manager_->PrefetchChain(page->GetNextPageId(), READ_AHEAD_PAGES,
+                                      &TablePage::ReadNextPageId, buffer_ring);
   page->RUnlatch();
   buffer_pool_manager_->UnpinPage(first_page_id_, false);
-  return TableIterator(this, rid, txn);
+  return TableIterator(this, rid, txn, buffer_ring);
 }
 
 TableIterator TableHeap::end() {
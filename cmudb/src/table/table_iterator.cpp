@@ -8,8 +8,10 @@
 
 namespace cmudb {
 
-TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn)
-    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn) {
+TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn,
+                             std::shared_ptr<BufferRing> buffer_ring)
+    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn),
+      buffer_ring_(buffer_ring) {
   if (rid.GetPageId() != INVALID_PAGE_ID) {
     table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_);
   }
@@ -28,7 +30,8 @@ Tuple *TableIterator::operator->() {
 TableIterator &TableIterator::operator++() {
   BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
   auto cur_page = static_cast<TablePage *>(
-      buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
+      buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId(),
+                                     buffer_ring_.get()));
   cur_page->RLatch();
   assert(cur_page != nullptr); // all pages are pinned
 
@@ -37,11 +40,13 @@ TableIterator &TableIterator::operator++() {
                                  next_tuple_rid)) { // end of this page
     while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
       auto next_page = static_cast<TablePage *>(
-          buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
+          buffer_pool_manager->FetchPage(cur_page->GetNextPageId(),
+                                         buffer_ring_.get()));
       cur_page->RUnlatch();
       buffer_pool_manager->UnpinPage(cur_page->GetPageId(), false);
       cur_page = next_page;
       cur_page->RLatch();
+      ReadAhead(cur_page->GetNextPageId());
       if (cur_page->GetFirstTupleRid(next_tuple_rid))
         break;
     }
@@ -54,9 +59,28 @@ TableIterator &TableIterator::operator++() {
   // release until copy the tuple
   cur_page->RUnlatch();
   buffer_pool_manager->UnpinPage(cur_page->GetPageId(), false);
+  // hand the ring's frames back as soon as the scan is over
+  if (*this == table_heap_->end()) {
+    buffer_ring_.reset();
+  }
   return *this;
 }
 
+/*
+ * Every READ_AHEAD_PAGES / 2 pages, prefetch the next READ_AHEAD_PAGES pages
+ * of the heap, so the pages are resident by the time the scan gets there
+ */
+void TableIterator::ReadAhead(page_id_t next_page_id) {
+  if (READ_AHEAD_PAGES == 0 || next_page_id == INVALID_PAGE_ID) return;
+  if (pages_until_read_ahead_ > 0) {
+    --pages_until_read_ahead_;
+    return;
+  }
+  table_heap_->buffer_pool_manager_->PrefetchChain(
+      next_page_id, READ_AHEAD_PAGES, &TablePage::ReadNextPageId, buffer_ring_);
+  pages_until_read_ahead_ = READ_AHEAD_PAGES / 2;
+}
+
 TableIterator TableIterator::operator++(int) {
   TableIterator clone(*this);
   ++(*this);
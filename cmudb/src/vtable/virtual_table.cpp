@@ -2,6 +2,8 @@
  * virtual_table.cpp
  */
 #include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <sys/stat.h>
@@ -153,6 +155,7 @@ int VtabDisconnect(sqlite3_vtab *pVtab) {
   delete virtual_table;
   // delete all the global managers
   delete storage_engine_;
+  storage_engine_ = nullptr;
   return SQLITE_OK;
 }
 
@@ -348,6 +351,173 @@ sqlite3_module VtableModule = {
     0,              /* xRollbackTo */
 };
 
+/* Statistics tables implementation */
+static StatsTableType POOL_STATS_TABLE = StatsTableType::POOL;
+static StatsTableType FRAME_STATS_TABLE = StatsTableType::FRAMES;
+
+int StatsConnect(sqlite3 *db, void *pAux, int argc, const char *const *argv,
+                 sqlite3_vtab **ppVtab, char **pzErr) {
+  StatsTableType type = *reinterpret_cast<StatsTableType *>(pAux);
+  int rc = sqlite3_declare_vtab(
+      db, type == StatsTableType::POOL
+              ? "CREATE TABLE X(name VARCHAR, value BIGINT);"
+              : "CREATE TABLE X(frame BIGINT, page_id BIGINT, pin_count "
+                "BIGINT, dirty BIGINT, accesses BIGINT);");
+  if (rc != SQLITE_OK)
+    return rc;
+  *ppVtab = reinterpret_cast<sqlite3_vtab *>(new StatsTable(type));
+  return SQLITE_OK;
+}
+
+int StatsBestIndex(sqlite3_vtab *tab, sqlite3_index_info *pIdxInfo) {
+  // always a full scan, the tables are small
+  pIdxInfo->estimatedCost = 100;
+  return SQLITE_OK;
+}
+
+int StatsDisconnect(sqlite3_vtab *pVtab) {
+  delete reinterpret_cast<StatsTable *>(pVtab);
+  return SQLITE_OK;
+}
+
+int StatsOpen(sqlite3_vtab *pVtab, sqlite3_vtab_cursor **ppCursor) {
+  StatsTable *stats_table = reinterpret_cast<StatsTable *>(pVtab);
+  StatsCursor *cursor = new StatsCursor(stats_table);
+  *ppCursor = reinterpret_cast<sqlite3_vtab_cursor *>(cursor);
+  return SQLITE_OK;
+}
+
+int StatsClose(sqlite3_vtab_cursor *cur) {
+  delete reinterpret_cast<StatsCursor *>(cur);
+  return SQLITE_OK;
+}
+
+int StatsFilter(sqlite3_vtab_cursor *pVtabCursor, int idxNum,
+                const char *idxStr, int argc, sqlite3_value **argv) {
+  StatsCursor *cursor = reinterpret_cast<StatsCursor *>(pVtabCursor);
+  if (storage_engine_ == nullptr)
+    return SQLITE_ERROR;
+  cursor->Load(storage_engine_->buffer_pool_manager_);
+  return SQLITE_OK;
+}
+
+int StatsNext(sqlite3_vtab_cursor *cur) {
+  reinterpret_cast<StatsCursor *>(cur)->Next();
+  return SQLITE_OK;
+}
+
+int StatsEof(sqlite3_vtab_cursor *cur) {
+  return reinterpret_cast<StatsCursor *>(cur)->isEof();
+}
+
+int StatsColumn(sqlite3_vtab_cursor *cur, sqlite3_context *ctx, int i) {
+  StatsCursor *cursor = reinterpret_cast<StatsCursor *>(cur);
+  if (cursor->HasName() && i == 0) {
+    sqlite3_result_text(ctx, cursor->GetCurrentName().c_str(), -1,
+                        SQLITE_TRANSIENT);
+  } else {
+    sqlite3_result_int64(ctx, (sqlite3_int64)cursor->GetCurrentValue(i));
+  }
+  return SQLITE_OK;
+}
+
+int StatsRowid(sqlite3_vtab_cursor *cur, sqlite3_int64 *pRowid) {
+  *pRowid = reinterpret_cast<StatsCursor *>(cur)->GetCurrentRowid();
+  return SQLITE_OK;
+}
+
+// SELECT bpm_stats_reset(): zero the counters and latency histograms
+void StatsReset(sqlite3_context *ctx, int argc, sqlite3_value **argv) {
+  if (storage_engine_ != nullptr)
+    storage_engine_->buffer_pool_manager_->ResetStats();
+  sqlite3_result_null(ctx);
+}
+
+void DurabilityModeFunc(sqlite3_context *ctx, int argc, sqlite3_value **argv) {
+  if (storage_engine_ == nullptr) {
+    sqlite3_result_null(ctx);
+    return;
+  }
+  DiskManager *disk_manager = storage_engine_->disk_manager_;
+  if (argc == 1) {
+    const char *name =
+        reinterpret_cast<const char *>(sqlite3_value_text(argv[0]));
+    DurabilityMode mode;
+    if (name == nullptr || !DiskManager::ParseDurabilityMode(name, mode)) {
+      sqlite3_result_error(ctx, "durability mode is none, batched or sync",
+                           -1);
+      return;
+    }
+    disk_manager->SetDurabilityMode(mode);
+  }
+  sqlite3_result_text(
+      ctx, DiskManager::GetDurabilityModeName(disk_manager->GetDurabilityMode()),
+      -1, SQLITE_STATIC);
+}
+
+void StatsCursor::AddRow(const std::string &name, int64_t value) {
+  names_.push_back(name);
+  values_.push_back({value});
+}
+
+void StatsCursor::Load(BufferPoolManager *buffer_pool_manager) {
+  names_.clear();
+  values_.clear();
+  offset_ = 0;
+  if (stats_table_->GetType() == StatsTableType::FRAMES) {
+    std::vector<FrameStats> frames;
+    buffer_pool_manager->GetFrameStats(frames);
+    for (size_t i = 0; i < frames.size(); ++i) {
+      values_.push_back({static_cast<int64_t>(i), frames[i].page_id_,
+                         frames[i].pin_count_, frames[i].is_dirty_,
+                         frames[i].access_count_});
+    }
+    return;
+  }
+
+  BufferPoolStatsSnapshot stats = buffer_pool_manager->GetStats();
+  for (size_t i = 0; i < NUM_POOL_COUNTERS; ++i) {
+    BufferPoolCounter counter = static_cast<BufferPoolCounter>(i);
+    AddRow(BufferPoolStats::GetName(counter), stats.Get(counter));
+  }
+  for (size_t i = 0; i < NUM_POOL_LATENCIES; ++i) {
+    BufferPoolLatency latency = static_cast<BufferPoolLatency>(i);
+    const LatencyHistogram &histogram = stats.Get(latency);
+    std::string name = BufferPoolStats::GetName(latency);
+    AddRow(name + "_count", histogram.Count());
+    AddRow(name + "_p50_ns", histogram.Percentile(0.5));
+    AddRow(name + "_p99_ns", histogram.Percentile(0.99));
+    AddRow(name + "_max_ns", histogram.Max());
+  }
+}
+
+// eponymous only (no xCreate) and read only (no xUpdate)
+sqlite3_module StatsModule = {
+    0,               /* iVersion */
+    0,               /* xCreate */
+    StatsConnect,    /* xConnect */
+    StatsBestIndex,  /* xBestIndex */
+    StatsDisconnect, /* xDisconnect */
+    StatsDisconnect, /* xDestroy */
+    StatsOpen,       /* xOpen - open a cursor */
+    StatsClose,      /* xClose - close a cursor */
+    StatsFilter,     /* xFilter - configure scan constraints */
+    StatsNext,       /* xNext - advance a cursor */
+    StatsEof,        /* xEof - check for end of scan */
+    StatsColumn,     /* xColumn - read data */
+    StatsRowid,      /* xRowid - read data */
+    0,               /* xUpdate */
+    0,               /* xBegin */
+    0,               /* xSync */
+    0,               /* xCommit */
+    0,               /* xRollback */
+    0,               /* xFindMethod */
+    0,               /* xRename */
+    0,               /* xSavepoint */
+    0,               /* xRelease */
+    0,               /* xRollbackTo */
+};
+
 #ifdef _WIN32
 __declspec(dllexport)
 #endif
@@ -358,20 +528,68 @@ __declspec(dllexport)
   struct stat buffer;
   bool is_file_exist = (stat(db_file_name.c_str(), &buffer) == 0);
 
+  // pool and page size can be overridden from the environment, the page size
+  // of an existing database file is the one it was created with
+  size_t pool_size = BUFFER_POOL_SIZE;
+  size_t page_size = PAGE_SIZE;
+  if (const char *env = getenv("CMUDB_BUFFER_POOL_SIZE")) {
+    pool_size = strtoul(env, nullptr, 10);
+  }
+  if (const char *env = getenv("CMUDB_PAGE_SIZE")) {
+    page_size = strtoul(env, nullptr, 10);
+  }
+  if (pool_size == 0 || !DiskManager::IsValidPageSize(page_size)) {
+    *pzErrMsg = sqlite3_mprintf("invalid buffer pool size %zu or page size %zu",
+                                pool_size, page_size);
+    return SQLITE_ERROR;
+  }
+  // and so can the durability mode, see durability_mode()
+  DurabilityMode durability_mode = DurabilityMode::NONE;
+  if (const char *env = getenv("CMUDB_DURABILITY")) {
+    if (!DiskManager::ParseDurabilityMode(env, durability_mode)) {
+      *pzErrMsg = sqlite3_mprintf("invalid durability mode %s", env);
+      return SQLITE_ERROR;
+    }
+  }
+
   // init storage engine
-  storage_engine_ = new StorageEngine(db_file_name);
+  storage_engine_ = new StorageEngine(db_file_name, pool_size, page_size);
+  storage_engine_->disk_manager_->SetDurabilityMode(durability_mode);
   // start the logging
   storage_engine_->log_manager_->RunFlushThread();
+  // reload the hot pages of the last run while queries are served, a new
+  // database file has none
+  if (is_file_exist) {
+    storage_engine_->buffer_pool_manager_->LoadResidentPages(
+        storage_engine_->resident_pages_file_name_);
+  } else {
+    remove(storage_engine_->resident_pages_file_name_.c_str());
+  }
   // create header page from BufferPoolManager if necessary
   if (!is_file_exist) {
     page_id_t header_page_id;
-    storage_engine_->buffer_pool_manager_->NewPage(header_page_id);
+    HeaderPage *header_page = static_cast<HeaderPage *>(
+        storage_engine_->buffer_pool_manager_->NewPage(header_page_id));
 
     assert(header_page_id == HEADER_PAGE_ID);
+    // records the page size of the file
+    header_page->Init();
     storage_engine_->buffer_pool_manager_->UnpinPage(header_page_id, true);
   }
 
   int rc = sqlite3_create_module(db, "vtable", &VtableModule, nullptr);
+  if (rc == SQLITE_OK)
+    rc = sqlite3_create_module(db, "bpm_stats", &StatsModule,
+                               &POOL_STATS_TABLE);
+  if (rc == SQLITE_OK)
+    rc = sqlite3_create_module(db, "bpm_frames", &StatsModule,
+                               &FRAME_STATS_TABLE);
+  if (rc == SQLITE_OK)
+    rc = sqlite3_create_function(db, "bpm_stats_reset", 0, SQLITE_UTF8,
+                                 nullptr, StatsReset, nullptr, nullptr);
+  for (int num_args = 0; num_args <= 1 && rc == SQLITE_OK; ++num_args)
+    rc = sqlite3_create_function(db, "durability_mode", num_args, SQLITE_UTF8,
+                                 nullptr, DurabilityModeFunc, nullptr, nullptr);
   return rc;
 }
 
@@ -436,6 +654,9 @@ Schema *ParseCreateStatement(const std::string &sql_base) {
   return schema;
 }
 
+/*
+ * index statement: "<index name> <column>[, <column>...] [using btree|hash]"
+ */
 IndexMetadata *ParseIndexStatement(std::string &sql,
                                    const std::string &table_name,
                                    Schema *schema) {
@@ -443,6 +664,7 @@ IndexMetadata *ParseIndexStatement(std::string &sql,
   std::string index_name;
   std::vector<int> key_attrs;
   int column_id = -1;
+  IndexType index_type = IndexType::BPLUS_TREE_INDEX;
   // prepocess, transform sql string into lower case
   std::transform(sql.begin(), sql.end(), sql.begin(), ::tolower);
   n = sql.find_first_of(' ');
@@ -451,6 +673,18 @@ IndexMetadata *ParseIndexStatement(std::string &sql,
   index_name = sql.substr(0, n);
   sql = sql.substr(n + 1);
 
+  n = sql.find(" using ");
+  if (n != std::string::npos) {
+    std::string method = sql.substr(n + 7);
+    StringUtility::Trim(method);
+    if (method == "hash")
+      index_type = IndexType::HASH_INDEX;
+    else if (method != "btree")
+      throw Exception(EXCEPTION_TYPE_INDEX,
+                      "can't create index, unknown method " + method);
+    sql = sql.substr(0, n);
+  }
+
   std::vector<std::string> tok = StringUtility::Split(sql, ',');
   // iterate through returned result
   for (std::string &t : tok) {
@@ -463,7 +697,7 @@ IndexMetadata *ParseIndexStatement(std::string &sql,
     throw Exception(EXCEPTION_TYPE_INDEX, "can't create index, format error");
 
   IndexMetadata *metadata =
-      new IndexMetadata(index_name, table_name, schema, key_attrs);
+      new IndexMetadata(index_name, table_name, schema, key_attrs, index_type);
 
   // LOG_DEBUG("%s", metadata->ToString().c_str());
   return metadata;
@@ -514,6 +748,29 @@ Index *ConstructIndex(IndexMetadata *metadata,
   // for each varchar attribute, we assume the largest size is 16 bytes
   key_size += 16 * key_schema->GetUnlinedColumnCount();
 
+  // root_id is the directory page of a hash index
+  if (metadata->GetIndexType() == IndexType::HASH_INDEX) {
+    if (key_size <= 4) {
+      return new ExtendibleHashIndex<GenericKey<4>, RID, GenericComparator<4>>(
+          metadata, buffer_pool_manager, root_id);
+    } else if (key_size <= 8) {
+      return new ExtendibleHashIndex<GenericKey<8>, RID, GenericComparator<8>>(
+          metadata, buffer_pool_manager, root_id);
+    } else if (key_size <= 16) {
+      return new ExtendibleHashIndex<GenericKey<16>, RID,
+                                     GenericComparator<16>>(
+          metadata, buffer_pool_manager, root_id);
+    } else if (key_size <= 32) {
+      return new ExtendibleHashIndex<GenericKey<32>, RID,
+                                     GenericComparator<32>>(
+          metadata, buffer_pool_manager, root_id);
+    } else {
+      return new ExtendibleHashIndex<GenericKey<64>, RID,
+                                     GenericComparator<64>>(
+          metadata, buffer_pool_manager, root_id);
+    }
+  }
+
   if (key_size <= 4) {
     return new BPlusTreeIndex<GenericKey<4>, RID, GenericComparator<4>>(
         metadata, buffer_pool_manager, root_id);
@@ -2,7 +2,14 @@
  * buffer_pool_manager_test.cpp
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdio>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "gtest/gtest.h"
@@ -48,4 +55,642 @@ TEST(BufferPoolManagerTest, SampleTest) {
   remove("test.db");
 }
 
+TEST(BufferPoolManagerTest, ShardedTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(10, disk_manager, nullptr, 4);
+  EXPECT_EQ(4, bpm.GetNumInstances());
+
+  // fill every frame of every shard
+  std::vector<page_id_t> page_ids;
+  Page *page;
+  while ((page = bpm.NewPage(temp_page_id)) != nullptr) {
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", temp_page_id);
+    page_ids.push_back(temp_page_id);
+  }
+  EXPECT_EQ(10, page_ids.size());
+
+  // once unpinned, pages are evicted and read back through their own shard
+  for (auto id : page_ids) {
+    EXPECT_TRUE(bpm.UnpinPage(id, true));
+  }
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_NE(nullptr, bpm.NewPage(temp_page_id));
+    EXPECT_TRUE(bpm.UnpinPage(temp_page_id, false));
+  }
+  char expected[PAGE_SIZE];
+  for (auto id : page_ids) {
+    page = bpm.FetchPage(id);
+    ASSERT_NE(nullptr, page);
+    snprintf(expected, PAGE_SIZE, "page %d", id);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_TRUE(bpm.UnpinPage(id, false));
+  }
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+// a new page id that hashes to a shard with every frame pinned moves on to
+// another shard
+TEST(BufferPoolManagerTest, NewPageFullShardTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(4, disk_manager, nullptr, 2);
+  // 0 and 2 pin both frames of shard 0, 1 and 3 go through shard 1
+  for (page_id_t page_id = 0; page_id < 4; ++page_id) {
+    ASSERT_NE(nullptr, bpm.NewPage(temp_page_id));
+    EXPECT_EQ(page_id, temp_page_id);
+    if (page_id % 2 == 1) {
+      EXPECT_TRUE(bpm.UnpinPage(page_id, false));
+    }
+  }
+
+  // 4 hashes to the full shard
+  Page *page = bpm.NewPage(temp_page_id);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(1, temp_page_id % 2);
+  EXPECT_EQ(temp_page_id, page->GetPageId());
+  EXPECT_TRUE(bpm.UnpinPage(temp_page_id, false));
+  // the id that got no frame is not lost
+  EXPECT_EQ(1, disk_manager->GetNumFreePages());
+
+  // with both shards full there is no new page
+  ASSERT_NE(nullptr, bpm.FetchPage(1));
+  ASSERT_NE(nullptr, bpm.FetchPage(3));
+  size_t num_free_pages = disk_manager->GetNumFreePages();
+  EXPECT_EQ(nullptr, bpm.NewPage(temp_page_id));
+  EXPECT_LE(num_free_pages, disk_manager->GetNumFreePages());
+  // and the ids it tried are free again
+  EXPECT_TRUE(bpm.UnpinPage(0, false));
+  ASSERT_NE(nullptr, bpm.NewPage(temp_page_id));
+  EXPECT_EQ(4, temp_page_id);
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.fsm");
+}
+
+// hits race with evictions of the same frames, every pinned page must still
+// hold its own content
+TEST(BufferPoolManagerTest, ConcurrentFetchTest) {
+  const int num_pages = 40;
+  const int num_threads = 8;
+  const int num_ops = 5000;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(16, disk_manager, nullptr, 2);
+  page_id_t temp_page_id;
+  for (int i = 0; i < num_pages; ++i) {
+    Page *page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    memcpy(page->GetData(), &temp_page_id, sizeof(page_id_t));
+    bpm.UnpinPage(temp_page_id, true);
+  }
+
+  // the page cleaner races with evictions of the pages it writes
+  bpm.RunPageCleaner(8, 4, std::chrono::milliseconds(1));
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([&bpm, tid]() {
+      std::mt19937 gen(tid);
+      // half of the accesses go to a small hot set that stays resident
+      std::uniform_int_distribution<page_id_t> hot(0, 3);
+      std::uniform_int_distribution<page_id_t> cold(0, num_pages - 1);
+      for (int i = 0; i < num_ops; ++i) {
+        page_id_t page_id = (i % 2) ? hot(gen) : cold(gen);
+        Page *page = bpm.FetchPage(page_id);
+        if (page == nullptr) {
+          continue; // all frames of the shard pinned by other threads
+        }
+        EXPECT_EQ(page_id, page->GetPageId());
+        EXPECT_EQ(page_id, *reinterpret_cast<page_id_t *>(page->GetData()));
+        EXPECT_TRUE(bpm.UnpinPage(page_id, i % 4 == 0));
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  bpm.StopPageCleaner();
+
+  for (int i = 0; i < num_pages; ++i) {
+    Page *page = bpm.FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(0, page->GetPinCount() - 1);
+    EXPECT_TRUE(bpm.UnpinPage(i, false));
+  }
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, ReplacerTypeTest) {
+  for (ReplacerType replacer_type : {ReplacerType::CLOCK, ReplacerType::LRU_K}) {
+    page_id_t temp_page_id;
+    std::vector<page_id_t> page_ids;
+
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager bpm(4, disk_manager, nullptr, 2, replacer_type);
+
+    for (int i = 0; i < 4; ++i) {
+      auto page = bpm.NewPage(temp_page_id);
+      ASSERT_NE(nullptr, page);
+      sprintf(page->GetData(), "page %d", temp_page_id);
+      page_ids.push_back(temp_page_id);
+    }
+    // every shard is full and pinned
+    EXPECT_EQ(nullptr, bpm.NewPage(temp_page_id));
+
+    for (page_id_t page_id : page_ids) {
+      EXPECT_EQ(true, bpm.UnpinPage(page_id, true));
+    }
+    // cycle more pages than frames through the pool
+    for (int i = 0; i < 8; ++i) {
+      auto page = bpm.NewPage(temp_page_id);
+      ASSERT_NE(nullptr, page);
+      sprintf(page->GetData(), "page %d", temp_page_id);
+      page_ids.push_back(temp_page_id);
+      EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+    }
+    for (page_id_t page_id : page_ids) {
+      auto page = bpm.FetchPage(page_id);
+      ASSERT_NE(nullptr, page);
+      char expected[20];
+      sprintf(expected, "page %d", page_id);
+      EXPECT_EQ(0, strcmp(page->GetData(), expected));
+      EXPECT_EQ(true, bpm.UnpinPage(page_id, false));
+    }
+
+    delete disk_manager;
+    remove("test.db");
+  }
+}
+
+TEST(BufferPoolManagerTest, BufferRingTest) {
+  const int hot_pages = 4;
+  const int scan_pages = 40;
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(10, disk_manager);
+
+  for (int i = 0; i < hot_pages + scan_pages; ++i) {
+    auto page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    sprintf(page->GetData(), "page %d", temp_page_id);
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+    EXPECT_EQ(true, bpm.FlushPage(temp_page_id));
+  }
+
+  // change the hot pages in memory only, they read back differently once
+  // they have been evicted
+  for (int i = 0; i < hot_pages; ++i) {
+    auto page = bpm.FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    sprintf(page->GetData(), "hot %d", i);
+    EXPECT_EQ(true, bpm.UnpinPage(i, false));
+  }
+
+  {
+    BufferRing buffer_ring(&bpm, 3);
+    for (int i = hot_pages; i < hot_pages + scan_pages; ++i) {
+      auto page = bpm.FetchPage(i, &buffer_ring);
+      ASSERT_NE(nullptr, page);
+      char expected[20];
+      sprintf(expected, "page %d", i);
+      EXPECT_EQ(0, strcmp(page->GetData(), expected));
+      EXPECT_EQ(true, bpm.UnpinPage(i, false));
+    }
+  }
+
+  // the scan did not push the hot pages out
+  for (int i = 0; i < hot_pages; ++i) {
+    auto page = bpm.FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    char expected[20];
+    sprintf(expected, "hot %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_EQ(true, bpm.UnpinPage(i, false));
+  }
+
+  // ring frames went back to the replacer, the whole pool is usable
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_NE(nullptr, bpm.NewPage(temp_page_id));
+  }
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, PageCleanerTest) {
+  page_id_t temp_page_id;
+  std::vector<page_id_t> page_ids;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(10, disk_manager, nullptr, 2);
+
+  for (int i = 0; i < 10; ++i) {
+    auto page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    sprintf(page->GetData(), "page %d", temp_page_id);
+    page_ids.push_back(temp_page_id);
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+  }
+
+  // keep every frame clean
+  bpm.RunPageCleaner(10, 4, std::chrono::milliseconds(1));
+  for (int i = 0; i < 1000 && bpm.GetCleanerWriteCount() < 10; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  bpm.StopPageCleaner();
+  EXPECT_EQ(10, bpm.GetCleanerWriteCount());
+
+  // evicting the cleaned pages does not write
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_NE(nullptr, bpm.NewPage(temp_page_id));
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, false));
+  }
+  EXPECT_EQ(10, bpm.GetEvictionCount());
+  EXPECT_EQ(0, bpm.GetForegroundWriteCount());
+
+  // and the cleaner wrote the right content
+  for (page_id_t page_id : page_ids) {
+    auto page = bpm.FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    char expected[20];
+    sprintf(expected, "page %d", page_id);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_EQ(true, bpm.UnpinPage(page_id, false));
+  }
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, FlushAllPagesTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(64, disk_manager, nullptr, 4);
+
+  // a run of 40 pages spread over the shards, then a gap
+  for (int i = 0; i < 48; ++i) {
+    auto page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    sprintf(page->GetData(), "page %d", temp_page_id);
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, i < 40 || i >= 44));
+  }
+  // dirty pages that stay pinned are written too
+  auto pinned = bpm.FetchPage(2);
+  ASSERT_NE(nullptr, pinned);
+
+  bpm.ResetStats();
+  EXPECT_EQ(44, bpm.FlushAllPages());
+  auto stats = bpm.GetStats();
+  EXPECT_EQ(44, stats.Get(BufferPoolCounter::FLUSH_WRITE));
+  EXPECT_EQ(2, stats.Get(BufferPoolCounter::WRITE_RUN));
+  EXPECT_EQ(0, bpm.FlushAllPages());
+
+  std::vector<FrameStats> frames;
+  bpm.GetFrameStats(frames);
+  for (auto &frame : frames) {
+    EXPECT_FALSE(frame.is_dirty_);
+    EXPECT_EQ(frame.page_id_ == 2 ? 1 : 0, frame.pin_count_);
+  }
+  EXPECT_EQ(true, bpm.UnpinPage(2, false));
+
+  char data[PAGE_SIZE];
+  char expected[20];
+  for (page_id_t page_id = 0; page_id < 48; ++page_id) {
+    if (page_id >= 40 && page_id < 44) continue;
+    disk_manager->ReadPage(page_id, data);
+    sprintf(expected, "page %d", page_id);
+    EXPECT_EQ(0, strcmp(data, expected));
+  }
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, EvictionWriteRunTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(EVICTION_WRITE_RUN + 4, disk_manager);
+
+  for (int i = 0; i < EVICTION_WRITE_RUN + 4; ++i) {
+    auto page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    sprintf(page->GetData(), "page %d", temp_page_id);
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+  }
+  // page 1 stays pinned, the first run is pages 2 to EVICTION_WRITE_RUN + 1
+  ASSERT_NE(nullptr, bpm.FetchPage(1));
+  ASSERT_NE(nullptr, bpm.FetchPage(0));
+  EXPECT_EQ(true, bpm.UnpinPage(0, false));
+
+  // evicting page 2 writes its dirty neighbours along
+  bpm.ResetStats();
+  ASSERT_NE(nullptr, bpm.NewPage(temp_page_id));
+  EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, false));
+  EXPECT_EQ(EVICTION_WRITE_RUN, bpm.GetForegroundWriteCount());
+  EXPECT_EQ(1, bpm.GetStats().Get(BufferPoolCounter::WRITE_RUN));
+
+  // the rest of the run is evicted without writes
+  for (int i = 1; i < EVICTION_WRITE_RUN; ++i) {
+    ASSERT_NE(nullptr, bpm.NewPage(temp_page_id));
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, false));
+  }
+  EXPECT_EQ(EVICTION_WRITE_RUN, bpm.GetEvictionCount());
+  EXPECT_EQ(EVICTION_WRITE_RUN, bpm.GetForegroundWriteCount());
+  EXPECT_EQ(true, bpm.UnpinPage(1, false));
+
+  char data[PAGE_SIZE];
+  char expected[20];
+  for (page_id_t page_id = 2; page_id < EVICTION_WRITE_RUN + 2; ++page_id) {
+    disk_manager->ReadPage(page_id, data);
+    sprintf(expected, "page %d", page_id);
+    EXPECT_EQ(0, strcmp(data, expected));
+  }
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+// each test page stores the id of the next one
+static page_id_t ReadTestNextPageId(const char *data) {
+  return *reinterpret_cast<const page_id_t *>(data);
+}
+
+TEST(BufferPoolManagerTest, PrefetchTest) {
+  const int num_pages = 30;
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(10, disk_manager, nullptr, 2);
+
+  for (int i = 0; i < num_pages; ++i) {
+    auto page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    page_id_t next_page_id = i + 1 < num_pages ? i + 1 : INVALID_PAGE_ID;
+    memcpy(page->GetData(), &next_page_id, sizeof(page_id_t));
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+  }
+
+  // pages 0..3 have been evicted, read them back along the chain
+  bpm.PrefetchChain(0, 4, ReadTestNextPageId);
+  // and 10, 11 directly
+  bpm.PrefetchBatch({10, 11});
+  for (int i = 0; i < 1000 && bpm.GetPrefetchCount() < 6; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(6, bpm.GetPrefetchCount());
+
+  // prefetched pages are resident and not pinned: clobber them on disk, the
+  // buffer pool still serves what was read
+  char garbage[PAGE_SIZE];
+  memset(garbage, 0xff, PAGE_SIZE);
+  for (page_id_t page_id : {0, 1, 2, 3, 10, 11}) {
+    disk_manager->WritePage(page_id, garbage);
+  }
+  for (page_id_t page_id : {0, 1, 2, 3, 10, 11}) {
+    auto page = bpm.FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(1, page->GetPinCount());
+    EXPECT_EQ(page_id + 1, ReadTestNextPageId(page->GetData()));
+    EXPECT_EQ(true, bpm.UnpinPage(page_id, false));
+  }
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+// a prefetch that has read its page stops here until the test lets it go
+// on, or for 100 ms at most
+static std::atomic<bool> prefetch_read{false};
+static std::atomic<bool> prefetch_released{false};
+static page_id_t StallPrefetch(const char *data) {
+  prefetch_read = true;
+  for (int i = 0; i < 100 && !prefetch_released; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return INVALID_PAGE_ID;
+}
+
+// a page is fetched, changed and evicted while a prefetch of it is in
+// flight. The prefetch must not publish the content it read before the
+// change.
+TEST(BufferPoolManagerTest, PrefetchRaceTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(4, disk_manager);
+  for (int i = 0; i < 8; ++i) {
+    ASSERT_NE(nullptr, bpm.NewPage(temp_page_id));
+    EXPECT_TRUE(bpm.UnpinPage(temp_page_id, true));
+  }
+
+  // page 0 was evicted, the prefetch reads it and stalls
+  bpm.PrefetchChain(0, 2, StallPrefetch);
+  while (!prefetch_read) {
+    std::this_thread::yield();
+  }
+  // the fetch waits for the prefetch instead of reading its own copy
+  Page *page = bpm.FetchPage(0);
+  ASSERT_NE(nullptr, page);
+  strcpy(page->GetData(), "changed");
+  EXPECT_TRUE(bpm.UnpinPage(0, true));
+  // write page 0 back and drop it from the pool
+  for (page_id_t page_id = 1; page_id < 5; ++page_id) {
+    ASSERT_NE(nullptr, bpm.FetchPage(page_id));
+    EXPECT_TRUE(bpm.UnpinPage(page_id, false));
+  }
+  prefetch_released = true;
+  for (int i = 0; i < 1000 && bpm.GetPrefetchCount() < 1; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  page = bpm.FetchPage(0);
+  ASSERT_NE(nullptr, page);
+  EXPECT_STREQ("changed", page->GetData());
+  EXPECT_TRUE(bpm.UnpinPage(0, false));
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, StatsTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(4, disk_manager, nullptr, 2);
+  page_id_t page_ids[6];
+
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_NE(nullptr, bpm.NewPage(page_ids[i]));
+    bpm.UnpinPage(page_ids[i], true);
+  }
+  // hits
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_NE(nullptr, bpm.FetchPage(page_ids[0]));
+    bpm.UnpinPage(page_ids[0], false);
+  }
+  // two more pages evict two dirty ones, reading them back misses
+  for (int i = 4; i < 6; ++i) {
+    ASSERT_NE(nullptr, bpm.NewPage(page_ids[i]));
+    bpm.UnpinPage(page_ids[i], false);
+  }
+  size_t misses = 0;
+  for (int i = 0; i < 4; ++i) {
+    std::vector<FrameStats> frames;
+    bpm.GetFrameStats(frames);
+    bool resident = false;
+    for (auto &frame : frames) {
+      resident = resident || frame.page_id_ == page_ids[i];
+    }
+    misses += resident ? 0 : 1;
+    ASSERT_NE(nullptr, bpm.FetchPage(page_ids[i]));
+    bpm.UnpinPage(page_ids[i], false);
+  }
+  EXPECT_LE(2, misses);
+
+  BufferPoolStatsSnapshot stats = bpm.GetStats();
+  EXPECT_EQ(6, stats.Get(BufferPoolCounter::NEW_PAGE));
+  EXPECT_EQ(3 + 4 - misses, stats.Get(BufferPoolCounter::FETCH_HIT));
+  EXPECT_EQ(misses, stats.Get(BufferPoolCounter::FETCH_MISS));
+  EXPECT_EQ(bpm.GetEvictionCount(), stats.Get(BufferPoolCounter::EVICTION));
+  EXPECT_LE(2, stats.Get(BufferPoolCounter::FOREGROUND_WRITE));
+  EXPECT_EQ(3 + 4 - misses, stats.Get(BufferPoolLatency::FETCH_HIT).Count());
+  EXPECT_EQ(misses, stats.Get(BufferPoolLatency::FETCH_MISS).Count());
+  EXPECT_EQ(6, stats.Get(BufferPoolLatency::NEW_PAGE).Count());
+  const LatencyHistogram &hits = stats.Get(BufferPoolLatency::FETCH_HIT);
+  EXPECT_LE(hits.Percentile(0.5), hits.Percentile(0.99));
+  EXPECT_LE(hits.Percentile(0.99), hits.Max());
+
+  // every resident page has been fetched since it was loaded
+  std::vector<FrameStats> frames;
+  bpm.GetFrameStats(frames);
+  EXPECT_EQ(4, frames.size());
+  for (auto &frame : frames) {
+    EXPECT_EQ(0, frame.pin_count_);
+    EXPECT_LE(1, frame.access_count_);
+  }
+
+  bpm.ResetStats();
+  stats = bpm.GetStats();
+  for (size_t i = 0; i < NUM_POOL_COUNTERS; ++i) {
+    EXPECT_EQ(0, stats.counters_[i]);
+  }
+  EXPECT_EQ(0, stats.Get(BufferPoolLatency::FETCH_HIT).Count());
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, WarmRestartTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(8, disk_manager);
+  page_id_t temp_page_id;
+  for (int i = 0; i < 16; ++i) {
+    Page *page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", temp_page_id);
+    bpm->UnpinPage(temp_page_id, true);
+    bpm->FlushPage(temp_page_id);
+  }
+  // 8..15 are resident, 3 and 5 evict 8 and 10. From coldest to hottest:
+  // 11 13 14 15 3 9 12 5
+  for (page_id_t page_id : {3, 9, 12, 5}) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+    bpm->UnpinPage(page_id, false);
+  }
+  EXPECT_TRUE(bpm->SaveResidentPages("test.warm"));
+  delete bpm;
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db");
+  bpm = new BufferPoolManager(8, disk_manager);
+  EXPECT_EQ(8, bpm->LoadResidentPages("test.warm").get());
+  std::vector<FrameStats> frames;
+  bpm->GetFrameStats(frames);
+  std::vector<page_id_t> resident;
+  for (auto &frame : frames) {
+    resident.push_back(frame.page_id_);
+  }
+  std::sort(resident.begin(), resident.end());
+  EXPECT_EQ(std::vector<page_id_t>({3, 5, 9, 11, 12, 13, 14, 15}), resident);
+
+  // the saved order is restored: the coldest pages go first
+  for (page_id_t evicted : {11, 13}) {
+    ASSERT_NE(nullptr, bpm->NewPage(temp_page_id));
+    bpm->UnpinPage(temp_page_id, false);
+    bpm->GetFrameStats(frames);
+    for (auto &frame : frames) {
+      EXPECT_NE(evicted, frame.page_id_);
+    }
+  }
+  bpm->ResetStats();
+  char expected[PAGE_SIZE];
+  for (page_id_t page_id : {3, 5, 9, 12, 14, 15}) {
+    Page *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(expected, PAGE_SIZE, "page %d", page_id);
+    EXPECT_STREQ(expected, page->GetData());
+    bpm->UnpinPage(page_id, false);
+  }
+  EXPECT_EQ(6, bpm->GetStats().Get(BufferPoolCounter::FETCH_HIT));
+
+  // a malformed or missing file loads nothing
+  EXPECT_EQ(0, bpm->LoadResidentPages("test.db").get());
+  EXPECT_EQ(0, bpm->LoadResidentPages("missing.warm").get());
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.warm");
+}
+
+// FetchPage hit throughput of the single latch pool versus a sharded pool
+TEST(BufferPoolManagerTest, FetchPageScalingBenchmark) {
+  const int num_pages = 64;
+  const int num_ops = 20000;
+
+  for (size_t num_instances : {1, 16}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager bpm(num_pages, disk_manager, nullptr, num_instances);
+    page_id_t temp_page_id;
+    for (int i = 0; i < num_pages; ++i) {
+      ASSERT_NE(nullptr, bpm.NewPage(temp_page_id));
+      bpm.UnpinPage(temp_page_id, false);
+    }
+
+    for (int num_threads = 1; num_threads <= 64; num_threads *= 2) {
+      std::vector<std::thread> threads;
+      auto start = std::chrono::steady_clock::now();
+      for (int tid = 0; tid < num_threads; ++tid) {
+        threads.push_back(std::thread([&bpm, tid]() {
+          std::mt19937 gen(tid);
+          std::uniform_int_distribution<page_id_t> dist(0, num_pages - 1);
+          for (int i = 0; i < num_ops; ++i) {
+            page_id_t page_id = dist(gen);
+            EXPECT_NE(nullptr, bpm.FetchPage(page_id));
+            bpm.UnpinPage(page_id, false);
+          }
+        }));
+      }
+      for (auto &thread : threads) {
+        thread.join();
+      }
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      std::cout << "shards: " << num_instances << " threads: " << num_threads
+                << " fetch/s: "
+                << static_cast<long>(num_threads * num_ops / elapsed.count())
+                << std::endl;
+    }
+    delete disk_manager;
+    remove("test.db");
+  }
+}
+
 } // namespace cmudb
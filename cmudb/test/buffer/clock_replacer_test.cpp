@@ -0,0 +1,119 @@
+/**
+ * clock_replacer_test.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "gtest/gtest.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+TEST(ClockReplacerTest, SampleTest) {
+  ClockReplacer<int> clock_replacer(7);
+
+  // push element into replacer
+  clock_replacer.Insert(1);
+  clock_replacer.Insert(2);
+  clock_replacer.Insert(3);
+  clock_replacer.Insert(4);
+  clock_replacer.Insert(5);
+  clock_replacer.Insert(6);
+  clock_replacer.Insert(1);
+  EXPECT_EQ(6, clock_replacer.Size());
+  int order[6];
+  EXPECT_EQ(6, clock_replacer.PeekVictims(order, 6));
+  EXPECT_EQ(1, order[0]);
+  EXPECT_EQ(6, order[5]);
+
+  // the first sweep clears every reference bit
+  int value;
+  clock_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+  // a referenced frame gets a second chance
+  clock_replacer.Insert(2);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(3, value);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(4, value);
+
+  // remove element from replacer
+  EXPECT_EQ(false, clock_replacer.Erase(4));
+  EXPECT_EQ(true, clock_replacer.Erase(6));
+  EXPECT_EQ(2, clock_replacer.Size());
+
+  // pop element from replacer after removal
+  clock_replacer.Victim(value);
+  EXPECT_EQ(5, value);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(2, value);
+  EXPECT_EQ(0, clock_replacer.Size());
+  EXPECT_EQ(false, clock_replacer.Victim(value));
+}
+
+TEST(ClockReplacerTest, PageTest) {
+  Page pages[4];
+  ClockReplacer<Page *> clock_replacer(4, pages);
+
+  clock_replacer.Insert(&pages[2]);
+  clock_replacer.Insert(&pages[0]);
+  EXPECT_EQ(true, clock_replacer.Erase(&pages[2]));
+
+  Page *page;
+  EXPECT_EQ(true, clock_replacer.Victim(page));
+  EXPECT_EQ(&pages[0], page);
+  EXPECT_EQ(false, clock_replacer.Victim(page));
+}
+
+// Insert/Victim/Erase cost of a replacer tracking num_frames ints
+static void BenchmarkReplacer(const std::string &name, Replacer<int> &replacer,
+                              int num_frames) {
+  const int num_ops = 1000000;
+  auto report = [&](const char *op,
+                    std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << name << " " << op << " ns/op: " << elapsed.count() / num_ops
+              << std::endl;
+  };
+
+  for (int i = 0; i < num_frames; ++i) {
+    replacer.Insert(i);
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_ops; ++i) {
+    replacer.Insert(i % num_frames);
+  }
+  report("Insert", start);
+
+  int value;
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_ops; ++i) {
+    replacer.Victim(value);
+    replacer.Insert(value);
+  }
+  report("Victim+Insert", start);
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_ops; ++i) {
+    replacer.Erase(i % num_frames);
+    replacer.Insert(i % num_frames);
+  }
+  report("Erase+Insert", start);
+  EXPECT_EQ(static_cast<size_t>(num_frames), replacer.Size());
+}
+
+TEST(ClockReplacerTest, BenchmarkAgainstLRU) {
+  const int num_frames = 1024;
+  LRUReplacer<int> lru_replacer(num_frames);
+  ClockReplacer<int> clock_replacer(num_frames);
+  BenchmarkReplacer("lru", lru_replacer, num_frames);
+  BenchmarkReplacer("clock", clock_replacer, num_frames);
+}
+
+} // namespace cmudb
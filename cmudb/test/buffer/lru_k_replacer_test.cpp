@@ -0,0 +1,142 @@
+/**
+ * lru_k_replacer_test.cpp
+ */
+
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(LRUKReplacerTest, SampleTest) {
+  LRUKReplacer<int> lru_k_replacer(7);
+
+  // push element into replacer
+  lru_k_replacer.Insert(1);
+  lru_k_replacer.Insert(2);
+  lru_k_replacer.Insert(3);
+  lru_k_replacer.Insert(4);
+  lru_k_replacer.Insert(5);
+  lru_k_replacer.Insert(6);
+  lru_k_replacer.Insert(1);
+  EXPECT_EQ(6, lru_k_replacer.Size());
+
+  // frames referenced once go first, oldest first
+  int value;
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(2, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(3, value);
+  lru_k_replacer.Insert(4);
+  int order[4];
+  EXPECT_EQ(4, lru_k_replacer.PeekVictims(order, 4));
+  EXPECT_EQ(5, order[0]);
+  EXPECT_EQ(6, order[1]);
+  EXPECT_EQ(1, order[2]);
+  EXPECT_EQ(4, order[3]);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(5, value);
+
+  // remove element from replacer
+  EXPECT_EQ(false, lru_k_replacer.Erase(5));
+  EXPECT_EQ(true, lru_k_replacer.Erase(6));
+  EXPECT_EQ(2, lru_k_replacer.Size());
+
+  // then by oldest second to last reference
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(4, value);
+  EXPECT_EQ(false, lru_k_replacer.Victim(value));
+}
+
+TEST(LRUKReplacerTest, CorrelatedReferenceTest) {
+  LRUKReplacer<int> lru_k_replacer(3, 0, 2, 1);
+
+  // back to back references of 0 count once
+  lru_k_replacer.Insert(0);
+  lru_k_replacer.Insert(0);
+  lru_k_replacer.Insert(1);
+  lru_k_replacer.Insert(2);
+  lru_k_replacer.Insert(1);
+
+  // 1 and 2 were referenced within the period, 0 was not
+  int value;
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(0, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(2, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+}
+
+// Replay trace through a pool of num_frames frames managed by replacer, the
+// same way BufferPoolManager drives it, and return the hit rate
+static double ReplayTrace(Replacer<int> &replacer, int num_frames,
+                          const std::vector<int> &trace) {
+  std::unordered_map<int, int> page_table;
+  std::vector<int> frame_page(num_frames, -1);
+  int next_free = 0, hits = 0;
+  for (int page_id : trace) {
+    auto it = page_table.find(page_id);
+    if (it != page_table.end()) {
+      ++hits;
+      replacer.Insert(it->second);
+      continue;
+    }
+    int frame;
+    if (next_free < num_frames) {
+      frame = next_free++;
+    } else {
+      EXPECT_EQ(true, replacer.Victim(frame));
+      replacer.Erase(frame);
+      page_table.erase(frame_page[frame]);
+    }
+    frame_page[frame] = page_id;
+    page_table[page_id] = frame;
+    replacer.Insert(frame);
+  }
+  return static_cast<double>(hits) / trace.size();
+}
+
+/*
+ * Point lookups over a small hot set (think B+ tree inner pages) mixed with
+ * a sequential scan over a table much larger than the pool
+ */
+TEST(LRUKReplacerTest, ScanHitRateTest) {
+  const int num_frames = 64;
+  const int hot_pages = 48;
+  const int table_pages = 10000;
+
+  std::vector<int> trace;
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> dist(0, hot_pages - 1);
+  for (int i = 0; i < table_pages; ++i) {
+    trace.push_back(dist(gen));
+    trace.push_back(hot_pages + i);
+  }
+
+  LRUReplacer<int> lru_replacer(num_frames);
+  ClockReplacer<int> clock_replacer(num_frames);
+  LRUKReplacer<int> lru_k_replacer(num_frames);
+  double lru = ReplayTrace(lru_replacer, num_frames, trace);
+  double clock = ReplayTrace(clock_replacer, num_frames, trace);
+  double lru_k = ReplayTrace(lru_k_replacer, num_frames, trace);
+  std::cout << "hit rate lru: " << lru << " clock: " << clock
+            << " lru-k: " << lru_k << std::endl;
+
+  // every scan page is a compulsory miss, so 0.5 is the best possible
+  EXPECT_GT(lru_k, 0.45);
+  EXPECT_GT(lru_k, lru);
+  EXPECT_GT(lru_k, clock);
+}
+
+} // namespace cmudb
@@ -6,11 +6,12 @@
 
 #include "buffer/lru_replacer.h"
 #include "gtest/gtest.h"
+#include "page/page.h"
 
 namespace cmudb {
 
 TEST(LRUReplacerTest, SampleTest) {
-  LRUReplacer<int> lru_replacer;
+  LRUReplacer<int> lru_replacer(7);
   
   // push element into replacer
   lru_replacer.Insert(1);
@@ -21,6 +22,10 @@ TEST(LRUReplacerTest, SampleTest) {
   lru_replacer.Insert(6);
   lru_replacer.Insert(1);
   EXPECT_EQ(6, lru_replacer.Size());
+  int order[2];
+  EXPECT_EQ(2, lru_replacer.PeekVictims(order, 2));
+  EXPECT_EQ(2, order[0]);
+  EXPECT_EQ(3, order[1]);
   
   // pop element from replacer
   int value;
@@ -41,6 +46,27 @@ TEST(LRUReplacerTest, SampleTest) {
   EXPECT_EQ(5, value);
   lru_replacer.Victim(value);
   EXPECT_EQ(1, value);
+  EXPECT_EQ(0, lru_replacer.Size());
+  EXPECT_EQ(false, lru_replacer.Victim(value));
+}
+
+TEST(LRUReplacerTest, PageTest) {
+  Page pages[4];
+  LRUReplacer<Page *> lru_replacer(4, pages);
+
+  lru_replacer.Insert(&pages[2]);
+  lru_replacer.Insert(&pages[0]);
+  lru_replacer.Insert(&pages[3]);
+  lru_replacer.Insert(&pages[2]);
+  EXPECT_EQ(true, lru_replacer.Erase(&pages[0]));
+  EXPECT_EQ(false, lru_replacer.Erase(&pages[1]));
+
+  Page *page;
+  EXPECT_EQ(true, lru_replacer.Victim(page));
+  EXPECT_EQ(&pages[3], page);
+  EXPECT_EQ(true, lru_replacer.Victim(page));
+  EXPECT_EQ(&pages[2], page);
+  EXPECT_EQ(false, lru_replacer.Victim(page));
 }
 
 } // namespace cmudb
@@ -0,0 +1,153 @@
+/**
+ * page_table_test.cpp
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "buffer/page_table.h"
+#include "gtest/gtest.h"
+#include "hash/extendible_hash.h"
+
+namespace cmudb {
+
+TEST(PageTableTest, SampleTest) {
+  const size_t num_frames = 100;
+  Page *frames = new Page[num_frames];
+  PageTable page_table(frames, num_frames);
+  EXPECT_EQ(256, page_table.GetNumSlots());
+
+  // sequential ids, every frame in use
+  for (size_t i = 0; i < num_frames; ++i) {
+    page_table.Insert(i, &frames[i]);
+  }
+  Page *page = nullptr;
+  for (size_t i = 0; i < num_frames; ++i) {
+    EXPECT_TRUE(page_table.Find(i, page));
+    EXPECT_EQ(&frames[i], page);
+  }
+  EXPECT_FALSE(page_table.Find(num_frames, page));
+  EXPECT_FALSE(page_table.Find(INVALID_PAGE_ID, page));
+
+  // removing shifts entries back, the others stay reachable
+  std::mt19937 gen(0);
+  std::vector<page_id_t> ids;
+  for (size_t i = 0; i < num_frames; ++i) {
+    ids.push_back(i);
+  }
+  std::shuffle(ids.begin(), ids.end(), gen);
+  for (size_t i = 0; i < num_frames / 2; ++i) {
+    EXPECT_TRUE(page_table.Remove(ids[i]));
+    EXPECT_FALSE(page_table.Remove(ids[i]));
+  }
+  for (size_t i = 0; i < num_frames; ++i) {
+    EXPECT_EQ(i >= num_frames / 2, page_table.Find(ids[i], page));
+  }
+
+  // frames get reused for other pages
+  for (size_t i = 0; i < num_frames / 2; ++i) {
+    page_table.Insert(1000 + i, &frames[ids[i]]);
+  }
+  for (size_t i = 0; i < num_frames / 2; ++i) {
+    EXPECT_TRUE(page_table.Find(1000 + i, page));
+    EXPECT_EQ(&frames[ids[i]], page);
+  }
+  delete[] frames;
+}
+
+// a page id that keeps moving between two frames, probed by readers
+TEST(PageTableTest, ConcurrentFindTest) {
+  const size_t num_frames = 64;
+  Page *frames = new Page[num_frames];
+  PageTable page_table(frames, num_frames);
+  for (size_t i = 0; i < num_frames - 1; ++i) {
+    page_table.Insert(i, &frames[i]);
+  }
+
+  std::atomic<bool> done{false};
+  std::vector<std::thread> readers;
+  for (int tid = 0; tid < 4; ++tid) {
+    readers.push_back(std::thread([&]() {
+      Page *page = nullptr;
+      while (!done) {
+        for (size_t i = 0; i < num_frames - 1; ++i) {
+          if (page_table.Find(i, page)) {
+            EXPECT_TRUE(page >= frames && page < frames + num_frames);
+          }
+        }
+      }
+    }));
+  }
+  for (int round = 0; round < 10000; ++round) {
+    page_id_t page_id = round % (num_frames - 1);
+    EXPECT_TRUE(page_table.Remove(page_id));
+    page_table.Insert(page_id, &frames[num_frames - 1 - (round & 1)]);
+    EXPECT_TRUE(page_table.Remove(page_id));
+    page_table.Insert(page_id, &frames[page_id]);
+  }
+  done = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  Page *page = nullptr;
+  for (size_t i = 0; i < num_frames - 1; ++i) {
+    EXPECT_TRUE(page_table.Find(i, page));
+    EXPECT_EQ(&frames[i], page);
+  }
+  delete[] frames;
+}
+
+static double MeasureLookups(HashTable<page_id_t, Page *> &table,
+                             const std::vector<page_id_t> &probes,
+                             int rounds) {
+  Page *page = nullptr;
+  size_t found = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < rounds; ++round) {
+    for (page_id_t page_id : probes) {
+      found += table.Find(page_id, page) ? 1 : 0;
+    }
+  }
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  EXPECT_EQ(probes.size() * rounds, found);
+  return elapsed.count() / (probes.size() * rounds);
+}
+
+// lookup latency of the page table against the extendible hash table
+TEST(PageTableTest, LookupBenchmark) {
+  for (size_t num_frames : {1024, 262144}) {
+    Page *frames = new Page[num_frames];
+    for (bool sequential : {true, false}) {
+      std::mt19937 gen(1);
+      std::vector<page_id_t> ids(num_frames);
+      for (size_t i = 0; i < num_frames; ++i) {
+        // an odd multiplier scatters the ids without duplicates
+        ids[i] = sequential ? i : (i * 2654435761u) & 0x7fffffff;
+      }
+      PageTable page_table(frames, num_frames);
+      ExtendibleHash<page_id_t, Page *> extendible_hash(BUCKET_SIZE);
+      for (size_t i = 0; i < num_frames; ++i) {
+        page_table.Insert(ids[i], &frames[i]);
+        extendible_hash.Insert(ids[i], &frames[i]);
+      }
+      std::shuffle(ids.begin(), ids.end(), gen);
+      int rounds = 1 + (1 << 20) / num_frames;
+      std::cout << num_frames << " frames, "
+                << (sequential ? "sequential" : "random")
+                << " ids, ns/lookup: page table "
+                << MeasureLookups(page_table, ids, rounds)
+                << ", extendible hash "
+                << MeasureLookups(extendible_hash, ids, rounds) << std::endl;
+    }
+    delete[] frames;
+  }
+}
+
+} // namespace cmudb
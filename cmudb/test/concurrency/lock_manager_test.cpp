@@ -2,6 +2,7 @@
  * lock_manager_test.cpp
  */
 
+#include <chrono>
 #include <thread>
 
 #include "concurrency/transaction_manager.h"
@@ -40,4 +41,36 @@ TEST(LockManagerTest, BasicTest) {
   t0.join();
   t1.join();
 }
+
+// younger transactions die instead of waiting for older ones
+TEST(LockManagerTest, WaitDieTest) {
+  LockManager lock_mgr{true};
+  TransactionManager txn_mgr{&lock_mgr};
+  RID rid{0, 0};
+
+  Transaction older(0), younger(1);
+  EXPECT_TRUE(lock_mgr.LockExclusive(&younger, rid));
+  EXPECT_FALSE(lock_mgr.Unlock(&younger, rid));
+  younger.SetState(TransactionState::GROWING);
+
+  // the older one waits until the younger one commits
+  std::thread t0([&] {
+    EXPECT_TRUE(lock_mgr.LockShared(&older, rid));
+    EXPECT_TRUE(lock_mgr.LockUpgrade(&older, rid));
+    txn_mgr.Commit(&older);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  txn_mgr.Commit(&younger);
+  t0.join();
+  EXPECT_EQ(TransactionState::COMMITTED, older.GetState());
+
+  Transaction holder(2), dying(3);
+  EXPECT_TRUE(lock_mgr.LockShared(&holder, rid));
+  EXPECT_TRUE(lock_mgr.LockShared(&dying, rid));
+  EXPECT_FALSE(lock_mgr.LockUpgrade(&dying, rid));
+  EXPECT_EQ(TransactionState::ABORTED, dying.GetState());
+  txn_mgr.Abort(&dying);
+  EXPECT_TRUE(lock_mgr.LockUpgrade(&holder, rid));
+  txn_mgr.Commit(&holder);
+}
 } // namespace cmudb
@@ -0,0 +1,140 @@
+/**
+ * async_io_engine_test.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <unistd.h>
+#include <vector>
+
+#include "disk/async_io_engine.h"
+#include "disk/disk_manager.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// write num_pages pages in one batch, more than the queue depth, and read
+// them back the same way
+static void CheckEngine(AsyncIOEngine &engine, int num_pages) {
+  int fd = open("test.db", O_RDWR | O_CREAT | O_TRUNC, 0644);
+  ASSERT_LE(0, fd);
+  std::vector<char> data(num_pages * PAGE_SIZE);
+  for (int i = 0; i < num_pages; ++i) {
+    memset(data.data() + i * PAGE_SIZE, i + 1, PAGE_SIZE);
+  }
+
+  std::vector<std::future<bool>> futures;
+  for (int i = 0; i < num_pages; ++i) {
+    futures.push_back(engine.Write(fd, data.data() + i * PAGE_SIZE, PAGE_SIZE,
+                                   i * PAGE_SIZE));
+  }
+  engine.Submit();
+  for (auto &future : futures) {
+    EXPECT_TRUE(future.get());
+  }
+
+  // one page past the end of the file reads as zeros
+  std::vector<char> buffer((num_pages + 1) * PAGE_SIZE, 0x55);
+  futures.clear();
+  for (int i = num_pages; i >= 0; --i) {
+    futures.push_back(engine.Read(fd, buffer.data() + i * PAGE_SIZE, PAGE_SIZE,
+                                  i * PAGE_SIZE));
+  }
+  engine.Submit();
+  for (auto &future : futures) {
+    EXPECT_TRUE(future.get());
+  }
+  EXPECT_EQ(0, memcmp(buffer.data(), data.data(), data.size()));
+  EXPECT_EQ(0, buffer[num_pages * PAGE_SIZE]);
+  EXPECT_EQ(0, buffer.back());
+
+  // a write to a file descriptor that is not open fails
+  std::future<bool> bad_write = engine.Write(-1, data.data(), PAGE_SIZE, 0);
+  engine.Submit();
+  EXPECT_FALSE(bad_write.get());
+
+  close(fd);
+  remove("test.db");
+}
+
+TEST(AsyncIOEngineTest, IOUringTest) {
+  if (!IOUringEngine::IsSupported()) {
+    std::cout << "io_uring not available, skipped" << std::endl;
+    return;
+  }
+  IOUringEngine engine(8);
+  CheckEngine(engine, 50);
+}
+
+TEST(AsyncIOEngineTest, ThreadPoolTest) {
+  ThreadPoolIOEngine engine(2, 8);
+  CheckEngine(engine, 50);
+}
+
+TEST(AsyncIOEngineTest, DiskManagerTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  std::cout << "engine: " << disk_manager->GetAsyncIOEngineName() << std::endl;
+  char data[PAGE_SIZE], buffer[PAGE_SIZE];
+  std::strncpy(data, "A test string.", sizeof(data));
+  EXPECT_TRUE(disk_manager->WritePageAsync(3, data).get());
+  EXPECT_EQ(4, disk_manager->GetNumPages());
+  EXPECT_TRUE(disk_manager->ReadPageAsync(3, buffer).get());
+  EXPECT_EQ(0, memcmp(buffer, data, sizeof(buffer)));
+  disk_manager->ReadPage(3, buffer);
+  EXPECT_EQ(0, memcmp(buffer, data, sizeof(buffer)));
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// random page reads: one at a time, then a whole batch in flight
+TEST(AsyncIOEngineTest, BatchReadBenchmark) {
+  const int num_pages = 4096;
+  DiskManager *disk_manager = new DiskManager("test.db", PAGE_SIZE, true);
+  char *data = DiskManager::AllocateAligned(num_pages * PAGE_SIZE);
+  for (int i = 0; i < num_pages; ++i) {
+    disk_manager->WritePageAsync(i, data + i * PAGE_SIZE, false);
+  }
+  disk_manager->SubmitAsyncIO();
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db", PAGE_SIZE, true);
+  std::vector<page_id_t> page_ids;
+  for (int i = 0; i < num_pages; ++i) {
+    page_ids.push_back((i * 7919) % num_pages);
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (page_id_t page_id : page_ids) {
+    disk_manager->ReadPage(page_id, data + page_id * PAGE_SIZE);
+  }
+  std::chrono::duration<double, std::micro> sync_time =
+      std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  std::vector<std::future<bool>> reads;
+  for (page_id_t page_id : page_ids) {
+    reads.push_back(
+        disk_manager->ReadPageAsync(page_id, data + page_id * PAGE_SIZE, false));
+  }
+  disk_manager->SubmitAsyncIO();
+  for (auto &read : reads) {
+    EXPECT_TRUE(read.get());
+  }
+  std::chrono::duration<double, std::micro> async_time =
+      std::chrono::steady_clock::now() - start;
+  std::cout << disk_manager->GetAsyncIOEngineName()
+            << (disk_manager->IsDirectIO() ? ", O_DIRECT" : "")
+            << " us/page: sync " << sync_time.count() / num_pages << ", batch "
+            << async_time.count() / num_pages << std::endl;
+
+  DiskManager::FreeAligned(data);
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+} // namespace cmudb
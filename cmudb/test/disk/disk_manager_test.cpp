@@ -0,0 +1,406 @@
+/**
+ * disk_manager_test.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "disk/disk_manager.h"
+#include "disk/segmented_log.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(DiskManagerTest, ReadWritePageTest) {
+  char data[PAGE_SIZE], buffer[PAGE_SIZE];
+  DiskManager *disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(0, disk_manager->GetNumPages());
+
+  std::strncpy(data, "A test string.", sizeof(data));
+  disk_manager->WritePage(0, data);
+  disk_manager->ReadPage(0, buffer);
+  EXPECT_EQ(0, std::memcmp(buffer, data, sizeof(buffer)));
+
+  std::memset(buffer, 1, sizeof(buffer));
+  disk_manager->WritePage(5, data);
+  EXPECT_EQ(6, disk_manager->GetNumPages());
+  // pages in the hole read as zeros
+  disk_manager->ReadPage(3, buffer);
+  for (size_t i = 0; i < sizeof(buffer); ++i) {
+    ASSERT_EQ(0, buffer[i]);
+  }
+  // reads past the end of the file are cut to zeros
+  std::vector<char> pages(3 * PAGE_SIZE, 1);
+  disk_manager->ReadPages(5, 3, pages.data());
+  EXPECT_EQ(0, std::memcmp(pages.data(), data, PAGE_SIZE));
+  EXPECT_EQ(0, pages[PAGE_SIZE]);
+  EXPECT_EQ(0, pages.back());
+
+  delete disk_manager;
+  // the size of an existing file is picked up when it is opened
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(6, disk_manager->GetNumPages());
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, DirectIOTest) {
+  DiskManager *disk_manager = new DiskManager("test.db", PAGE_SIZE, true);
+  std::cout << "direct I/O: " << disk_manager->IsDirectIO() << std::endl;
+
+  char *aligned = DiskManager::AllocateAligned(2 * PAGE_SIZE);
+  std::vector<char> unaligned(PAGE_SIZE + 1);
+  for (int i = 0; i < PAGE_SIZE; ++i) {
+    aligned[i] = static_cast<char>(i);
+    unaligned[i + 1] = static_cast<char>(i * 7);
+  }
+  disk_manager->WritePage(0, aligned);
+  // goes through a bounce buffer
+  disk_manager->WritePage(1, unaligned.data() + 1);
+
+  std::vector<char> buffer(PAGE_SIZE + 1);
+  disk_manager->ReadPage(1, buffer.data() + 1);
+  EXPECT_EQ(0, std::memcmp(buffer.data() + 1, unaligned.data() + 1, PAGE_SIZE));
+  std::vector<char> expected(aligned, aligned + PAGE_SIZE);
+  disk_manager->ReadPages(0, 2, aligned);
+  EXPECT_EQ(0, std::memcmp(aligned, expected.data(), PAGE_SIZE));
+  EXPECT_EQ(0, std::memcmp(aligned + PAGE_SIZE, unaligned.data() + 1,
+                           PAGE_SIZE));
+  delete disk_manager;
+
+  // the same file through the page cache
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(2, disk_manager->GetNumPages());
+  disk_manager->ReadPage(0, buffer.data());
+  EXPECT_EQ(0, std::memcmp(buffer.data(), expected.data(), PAGE_SIZE));
+  delete disk_manager;
+
+  DiskManager::FreeAligned(aligned);
+  remove("test.db");
+  remove("test.log");
+}
+
+// threads write and read back their own pages at the same time
+TEST(DiskManagerTest, ConcurrentTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  const int num_threads = 4;
+  const int pages_per_thread = 200;
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([disk_manager, tid]() {
+      char data[PAGE_SIZE], buffer[PAGE_SIZE];
+      for (int round = 0; round < 2; ++round) {
+        for (int i = 0; i < pages_per_thread; ++i) {
+          page_id_t page_id = i * num_threads + tid;
+          std::memset(data, page_id + round, sizeof(data));
+          disk_manager->WritePage(page_id, data);
+          disk_manager->ReadPage(page_id, buffer);
+          EXPECT_EQ(0, std::memcmp(buffer, data, sizeof(data)));
+        }
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(num_threads * pages_per_thread, disk_manager->GetNumPages());
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, AllocatePageTest) {
+  remove("test.fsm");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  for (page_id_t page_id = 0; page_id < 200; ++page_id) {
+    EXPECT_EQ(page_id, disk_manager->AllocatePage());
+  }
+  for (page_id_t page_id : {3, 5, 7, 100}) {
+    disk_manager->DeallocatePage(page_id);
+  }
+  // twice is ignored
+  disk_manager->DeallocatePage(5);
+  EXPECT_EQ(4, disk_manager->GetNumFreePages());
+
+  // freed pages closest to the hint first, the file grows once none is left
+  EXPECT_EQ(7, disk_manager->AllocatePage(6));
+  EXPECT_EQ(100, disk_manager->AllocatePage(150));
+  EXPECT_EQ(3, disk_manager->AllocatePage());
+  char data[PAGE_SIZE] = {0};
+  disk_manager->WritePage(199, data);
+  delete disk_manager;
+
+  // allocation resumes where it stopped
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(1, disk_manager->GetNumFreePages());
+  EXPECT_EQ(5, disk_manager->AllocatePage(190));
+  EXPECT_EQ(200, disk_manager->AllocatePage());
+  delete disk_manager;
+
+  // without its map, every page of the file counts as allocated
+  remove("test.fsm");
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(0, disk_manager->GetNumFreePages());
+  EXPECT_EQ(200, disk_manager->AllocatePage());
+  delete disk_manager;
+
+  // a new database file starts over
+  remove("test.db");
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(0, disk_manager->AllocatePage());
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+  remove("test.fsm");
+}
+
+// pages deleted through the buffer pool are reused, the file stops growing
+TEST(DiskManagerTest, DeletePageReuseTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  page_id_t page_id;
+  std::vector<page_id_t> page_ids;
+  for (int round = 0; round < 5; ++round) {
+    for (int i = 0; i < 100; ++i) {
+      ASSERT_NE(nullptr, bpm->NewPage(page_id));
+      page_ids.push_back(page_id);
+      bpm->UnpinPage(page_id, true);
+    }
+    for (page_id_t page_id : page_ids) {
+      EXPECT_TRUE(bpm->DeletePage(page_id));
+    }
+    page_ids.clear();
+  }
+  EXPECT_LE(disk_manager->GetNumPages(), 100);
+  EXPECT_EQ(100, disk_manager->GetNumFreePages());
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+  remove("test.fsm");
+}
+
+TEST(DiskManagerTest, DurabilityModeTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  char data[PAGE_SIZE] = {0};
+  EXPECT_EQ(DurabilityMode::NONE, disk_manager->GetDurabilityMode());
+  for (page_id_t page_id = 0; page_id < 10; ++page_id) {
+    disk_manager->WritePage(page_id, data);
+  }
+  EXPECT_EQ(0, disk_manager->GetNumSyncs());
+
+  // every write, asynchronous ones too
+  disk_manager->SetDurabilityMode(DurabilityMode::SYNC);
+  EXPECT_EQ(1, disk_manager->GetNumSyncs());
+  for (page_id_t page_id = 0; page_id < 10; ++page_id) {
+    disk_manager->WritePage(page_id, data);
+  }
+  EXPECT_TRUE(disk_manager->WritePageAsync(10, data).get());
+  EXPECT_EQ(12, disk_manager->GetNumSyncs());
+
+  // a sync per 8 pages, the interval is too long to matter
+  disk_manager->SetDurabilityMode(DurabilityMode::BATCHED,
+                                  std::chrono::milliseconds(100000), 8);
+  std::vector<const char *> pages(64, data);
+  disk_manager->WritePages(0, 64, pages.data());
+  for (int i = 0; i < 1000 && disk_manager->GetNumSyncs() < 13; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(13, disk_manager->GetNumSyncs());
+  for (page_id_t page_id = 0; page_id < 3; ++page_id) {
+    disk_manager->WritePage(page_id, data);
+  }
+  EXPECT_EQ(13, disk_manager->GetNumSyncs());
+  // leaving the mode syncs what is left
+  disk_manager->SetDurabilityMode(DurabilityMode::NONE);
+  EXPECT_EQ(14, disk_manager->GetNumSyncs());
+
+  // or the interval runs out
+  disk_manager->SetDurabilityMode(DurabilityMode::BATCHED,
+                                  std::chrono::milliseconds(1), 1000);
+  disk_manager->WritePage(0, data);
+  for (int i = 0; i < 1000 && disk_manager->GetNumSyncs() < 15; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(15, disk_manager->GetNumSyncs());
+
+  DurabilityMode mode;
+  EXPECT_TRUE(DiskManager::ParseDurabilityMode("batched", mode));
+  EXPECT_EQ(DurabilityMode::BATCHED, mode);
+  EXPECT_FALSE(DiskManager::ParseDurabilityMode("always", mode));
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// page write throughput of every durability mode, 4 writer threads
+TEST(DiskManagerTest, DurabilityBenchmark) {
+  const int num_threads = 4;
+  const int pages_per_thread = 256;
+  for (DurabilityMode mode : {DurabilityMode::NONE, DurabilityMode::BATCHED,
+                              DurabilityMode::SYNC}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    disk_manager->SetDurabilityMode(mode);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_threads; ++tid) {
+      threads.push_back(std::thread([disk_manager, tid]() {
+        char data[PAGE_SIZE];
+        std::memset(data, tid, sizeof(data));
+        for (int i = 0; i < pages_per_thread; ++i) {
+          disk_manager->WritePage(i * num_threads + tid, data);
+        }
+      }));
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    // every mode ends with its pages on disk
+    disk_manager->Sync();
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << DiskManager::GetDurabilityModeName(mode) << ": "
+              << (int)(num_threads * pages_per_thread / elapsed.count())
+              << " pages/s, " << disk_manager->GetNumSyncs() << " syncs"
+              << std::endl;
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+  }
+}
+
+static void RemoveSegmentedLog(const std::string &name) {
+  remove(name.c_str());
+  for (int segment = 0; segment < 64; ++segment) {
+    remove((name + "." + std::to_string(segment)).c_str());
+  }
+}
+
+static ino_t GetInode(const std::string &name) {
+  struct stat stat_buf;
+  return stat(name.c_str(), &stat_buf) == 0 ? stat_buf.st_ino : 0;
+}
+
+TEST(DiskManagerTest, SegmentedLogTest) {
+  const size_t segment_size = 64 << 10;
+  RemoveSegmentedLog("seg.log");
+  SegmentedLog *log = new SegmentedLog("seg.log", segment_size, 2);
+  EXPECT_EQ(0, log->GetEnd());
+
+  // appends across segments read back as written
+  std::vector<char> data(4 * segment_size + (16 << 10));
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<char>(i % 251 + 1);
+  }
+  for (size_t offset = 0; offset < data.size(); offset += 5000) {
+    EXPECT_TRUE(log->Append(data.data() + offset,
+                            std::min<size_t>(5000, data.size() - offset)));
+  }
+  EXPECT_EQ(data.size(), log->GetEnd());
+  EXPECT_EQ(5, log->GetNumSegments());
+  std::vector<char> buffer(data.size() + 100, 1);
+  EXPECT_TRUE(log->Read(buffer.data(), buffer.size(), 0));
+  EXPECT_EQ(0, std::memcmp(buffer.data(), data.data(), data.size()));
+  EXPECT_EQ(0, buffer.back());
+  EXPECT_FALSE(log->Read(buffer.data(), 100, data.size()));
+
+  // the segments before the one holding the offset go, two are kept
+  ino_t recycled = GetInode("seg.log.1");
+  log->Truncate(3 * segment_size + 100);
+  EXPECT_EQ(3 * segment_size, log->GetStart());
+  EXPECT_EQ(2, log->GetNumSegments());
+  EXPECT_EQ(2, log->GetNumFreeSegments());
+  EXPECT_EQ(0, GetInode("seg.log.0"));
+  EXPECT_TRUE(log->Read(buffer.data(), 100, 3 * segment_size));
+  EXPECT_EQ(0, std::memcmp(buffer.data(), data.data() + 3 * segment_size, 100));
+
+  // the next segment is the oldest one kept, with its old content after
+  // the end of the log reading as zeros
+  size_t size = 5 * segment_size + 1000 - log->GetEnd();
+  EXPECT_TRUE(log->Append(data.data(), size));
+  EXPECT_EQ(recycled, GetInode("seg.log.5"));
+  EXPECT_EQ(1, log->GetNumFreeSegments());
+  EXPECT_TRUE(log->Read(buffer.data(), 2000, 5 * segment_size));
+  EXPECT_EQ(0, std::memcmp(buffer.data(), data.data() + size - 1000, 1000));
+  EXPECT_EQ(0, buffer[1000]);
+  size_t end = log->GetEnd();
+  delete log;
+
+  // opened again, the log goes on from the next segment
+  log = new SegmentedLog("seg.log", segment_size, 2);
+  EXPECT_EQ(3 * segment_size, log->GetStart());
+  EXPECT_EQ(6 * segment_size, log->GetEnd());
+  EXPECT_TRUE(log->Append(data.data(), 1000));
+  EXPECT_EQ(6 * segment_size + 1000, log->GetEnd());
+  EXPECT_EQ(6 * segment_size, log->GetNextRun(end));
+  EXPECT_EQ(6 * segment_size + 1000, log->GetNextRun(6 * segment_size));
+  EXPECT_TRUE(log->Read(buffer.data(), 1000, end));
+  EXPECT_EQ(0, buffer[0]);
+  EXPECT_TRUE(log->Read(buffer.data(), 1000, 6 * segment_size));
+  EXPECT_EQ(0, std::memcmp(buffer.data(), data.data(), 1000));
+  delete log;
+
+  // the segment size of an existing log wins
+  log = new SegmentedLog("seg.log", 2 * segment_size, 2);
+  EXPECT_EQ(segment_size, log->GetSegmentSize());
+  delete log;
+  RemoveSegmentedLog("seg.log");
+}
+
+// latency of a synced 4 KB log append, to a file that grows with every
+// append and to recycled segments
+TEST(DiskManagerTest, SegmentedLogBenchmark) {
+  const size_t num_appends = 1024;
+  const size_t segment_size = 1 << 20;
+  std::vector<char> data(4096, 'x');
+
+  remove("test.log");
+  int fd = open("test.log", O_WRONLY | O_APPEND | O_CREAT, 0644);
+  ASSERT_GE(fd, 0);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < num_appends; ++i) {
+    EXPECT_EQ(static_cast<ssize_t>(data.size()),
+              write(fd, data.data(), data.size()));
+    EXPECT_EQ(0, fdatasync(fd));
+  }
+  std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cout << "growing file: " << (int)(elapsed.count() / num_appends)
+            << " us/append" << std::endl;
+  close(fd);
+  remove("test.log");
+
+  // one pass to allocate the segments, truncated so the next one recycles
+  RemoveSegmentedLog("seg.log");
+  SegmentedLog *log =
+      new SegmentedLog("seg.log", segment_size,
+                       num_appends * data.size() / segment_size + 1);
+  for (size_t i = 0; i < num_appends; ++i) {
+    log->Append(data.data(), data.size());
+  }
+  log->Truncate(log->GetEnd());
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < num_appends; ++i) {
+    EXPECT_TRUE(log->Append(data.data(), data.size()));
+  }
+  elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << "recycled segments: " << (int)(elapsed.count() / num_appends)
+            << " us/append" << std::endl;
+  delete log;
+  RemoveSegmentedLog("seg.log");
+}
+
+} // namespace cmudb
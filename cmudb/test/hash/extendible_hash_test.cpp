@@ -2,6 +2,11 @@
  * extendible_hash_test.cpp
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
 #include <thread>
 
 #include "hash/extendible_hash.h"
@@ -92,7 +97,9 @@ TEST(ExtendibleHashTest, ConcurrentRemoveTest) {
     for (int i = 0; i < num_threads; i++) {
       threads[i].join();
     }
-    EXPECT_EQ(test->GetGlobalDepth(), 6);
+    // 4..8 need two bits, merges may be skipped under contention
+    EXPECT_GE(test->GetGlobalDepth(), 2);
+    EXPECT_LE(test->GetGlobalDepth(), 6);
     int val;
     EXPECT_EQ(0, test->Find(0, val));
     EXPECT_EQ(1, test->Find(8, val));
@@ -102,4 +109,204 @@ TEST(ExtendibleHashTest, ConcurrentRemoveTest) {
   }
 }
 
+// readers probe keys that must stay visible while writers keep splitting
+TEST(ExtendibleHashTest, ConcurrentSplitTest) {
+  const int num_threads = 4;
+  const int keys_per_thread = 5000;
+  ExtendibleHash<int, int> test(4);
+  for (int i = 0; i < 100; ++i) {
+    test.Insert(-1 - i, i);
+  }
+
+  std::atomic<bool> done{false};
+  std::vector<std::thread> readers;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    readers.push_back(std::thread([&test, &done]() {
+      int val;
+      while (!done) {
+        for (int i = 0; i < 100; ++i) {
+          EXPECT_TRUE(test.Find(-1 - i, val));
+          EXPECT_EQ(i, val);
+        }
+      }
+    }));
+  }
+  std::vector<std::thread> writers;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    writers.push_back(std::thread([&test, tid]() {
+      for (int i = 0; i < keys_per_thread; ++i) {
+        int key = i * num_threads + tid;
+        test.Insert(key, key);
+        if (i % 2) {
+          EXPECT_TRUE(test.Remove(key));
+        }
+      }
+    }));
+  }
+  for (auto &writer : writers) {
+    writer.join();
+  }
+  done = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+
+  int val;
+  for (int i = 0; i < num_threads * keys_per_thread; ++i) {
+    EXPECT_EQ((i / num_threads) % 2 == 0, test.Find(i, val));
+  }
+  for (int i = 0; i < test.GetNumBuckets(); ++i) {
+    EXPECT_LE(test.GetLocalDepth(i), test.GetGlobalDepth());
+  }
+}
+
+TEST(ExtendibleHashTest, ShrinkTest) {
+  ExtendibleHash<int, int> test(2);
+  for (int i = 0; i < 1000; ++i) {
+    test.Insert(i, i);
+  }
+  EXPECT_EQ(9, test.GetGlobalDepth());
+
+  // keep 0..3, one per bucket of depth 2
+  for (int i = 999; i >= 4; --i) {
+    EXPECT_TRUE(test.Remove(i));
+  }
+  EXPECT_EQ(2, test.GetGlobalDepth());
+  EXPECT_EQ(4, test.GetNumBuckets());
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(2, test.GetLocalDepth(i));
+    int val;
+    EXPECT_TRUE(test.Find(i, val));
+    EXPECT_EQ(i, val);
+  }
+
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(test.Remove(i));
+  }
+  EXPECT_EQ(0, test.GetGlobalDepth());
+  EXPECT_EQ(1, test.GetNumBuckets());
+}
+
+// the directory follows the live key set instead of its historical peak
+TEST(ExtendibleHashTest, ChurnFootprintTest) {
+  ExtendibleHash<int, int> test(BUCKET_SIZE);
+  std::mt19937 gen(0);
+  std::vector<int> keys(20000);
+  for (int round = 0; round < 10; ++round) {
+    for (auto &key : keys) {
+      key = gen();
+      test.Insert(key, round);
+    }
+    int peak = test.GetGlobalDepth();
+    EXPECT_GE(peak, 9);
+    // drop all but a hundredth of the keys
+    std::shuffle(keys.begin(), keys.end(), gen);
+    for (size_t i = keys.size() / 100; i < keys.size(); ++i) {
+      test.Remove(keys[i]);
+    }
+    EXPECT_LT(test.GetGlobalDepth(), peak);
+    for (size_t i = 0; i < keys.size() / 100; ++i) {
+      test.Remove(keys[i]);
+    }
+    EXPECT_EQ(0, test.GetGlobalDepth());
+    EXPECT_EQ(1, test.GetNumBuckets());
+  }
+}
+
+// writers grow and shrink the table while readers probe fixed keys
+TEST(ExtendibleHashTest, ConcurrentChurnTest) {
+  const int num_threads = 4;
+  ExtendibleHash<int, int> test(4);
+  for (int i = 0; i < 100; ++i) {
+    test.Insert(-1 - i, i);
+  }
+
+  std::atomic<bool> done{false};
+  std::vector<std::thread> readers;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    readers.push_back(std::thread([&test, &done]() {
+      int val;
+      while (!done) {
+        for (int i = 0; i < 100; ++i) {
+          EXPECT_TRUE(test.Find(-1 - i, val));
+          EXPECT_EQ(i, val);
+        }
+      }
+    }));
+  }
+  std::vector<std::thread> writers;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    writers.push_back(std::thread([&test, tid]() {
+      for (int round = 0; round < 20; ++round) {
+        for (int i = 0; i < 500; ++i) {
+          test.Insert(i * num_threads + tid, round);
+        }
+        for (int i = 0; i < 500; ++i) {
+          EXPECT_TRUE(test.Remove(i * num_threads + tid));
+        }
+      }
+    }));
+  }
+  for (auto &writer : writers) {
+    writer.join();
+  }
+  done = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+
+  int val;
+  for (int i = 0; i < num_threads * 500; ++i) {
+    EXPECT_FALSE(test.Find(i, val));
+  }
+  for (int i = 0; i < test.GetNumBuckets(); ++i) {
+    EXPECT_LE(test.GetLocalDepth(i), test.GetGlobalDepth());
+  }
+}
+
+// mixed find/insert/remove throughput as the number of threads grows
+TEST(ExtendibleHashTest, ThroughputBenchmark) {
+  const int num_keys = 1 << 16;
+  const int num_ops = 200000;
+
+  for (int num_threads = 1; num_threads <= 32; num_threads *= 2) {
+    ExtendibleHash<int, int> test(BUCKET_SIZE);
+    for (int i = 0; i < num_keys; i += 2) {
+      test.Insert(i, i);
+    }
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int tid = 0; tid < num_threads; ++tid) {
+      threads.push_back(std::thread([&test, tid, num_threads]() {
+        std::mt19937 gen(tid);
+        std::uniform_int_distribution<int> dist(0, num_keys - 1);
+        int val;
+        for (int i = 0; i < num_ops / num_threads; ++i) {
+          int key = dist(gen);
+          // 90% lookups, the rest split between inserts and removes
+          switch (i % 10) {
+          case 0:
+            test.Insert(key, key);
+            break;
+          case 5:
+            test.Remove(key);
+            break;
+          default:
+            if (test.Find(key, val)) {
+              EXPECT_EQ(key, val);
+            }
+          }
+        }
+      }));
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << "threads: " << num_threads << " ops/s: "
+              << static_cast<long>(num_ops / elapsed.count()) << std::endl;
+  }
+}
+
 } // namespace cmudb
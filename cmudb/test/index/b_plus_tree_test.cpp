@@ -3,6 +3,7 @@
  */
 
 #include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <iostream>
 #include <sstream>
@@ -397,4 +398,71 @@ TEST(BPlusTreeTests, ScaleTest) {
   remove("test.db");
   remove("test.log");
 }
+
+/*
+ * Benchmark: the same keys in trees built on different page sizes. Larger
+ * pages mean a higher fan-out and fewer levels to walk on every lookup.
+ */
+TEST(BPlusTreeTests, PageSizeBenchmark) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  const int64_t scale = 50000;
+  int last_depth = 0;
+
+  for (size_t page_size = MIN_PAGE_SIZE; page_size <= MAX_PAGE_SIZE;
+       page_size *= 2) {
+    DiskManager *disk_manager = new DiskManager("test.db", page_size);
+    BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                             comparator);
+    GenericKey<8> index_key;
+    RID rid;
+    Transaction *transaction = new Transaction(0);
+    page_id_t page_id;
+    bpm->NewPage(page_id);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int64_t key = 0; key < scale; key++) {
+      rid.Set((int32_t)(key >> 32), key & 0xFFFFFFFF);
+      index_key.SetFromInteger(key);
+      tree.Insert(index_key, rid, transaction);
+    }
+    auto inserted = std::chrono::steady_clock::now();
+    std::vector<RID> rids;
+    for (int64_t key = 0; key < scale; key++) {
+      rids.clear();
+      index_key.SetFromInteger((key * 7919) % scale);
+      tree.GetValue(index_key, rids);
+      EXPECT_EQ(rids.size(), 1);
+    }
+    auto looked_up = std::chrono::steady_clock::now();
+
+    int depth = tree.GetDepth();
+    if (last_depth != 0) {
+      EXPECT_LE(depth, last_depth);
+    }
+    last_depth = depth;
+    std::cout << "page size " << page_size << ": depth " << depth << ", "
+              << scale * 1000 /
+                     (std::chrono::duration_cast<std::chrono::milliseconds>(
+                          inserted - start)
+                          .count() +
+                      1)
+              << " inserts/s, "
+              << scale * 1000 /
+                     (std::chrono::duration_cast<std::chrono::milliseconds>(
+                          looked_up - inserted)
+                          .count() +
+                      1)
+              << " lookups/s" << std::endl;
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete transaction;
+    delete bpm;
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+  }
+  delete key_schema;
+}
 } // namespace cmudb
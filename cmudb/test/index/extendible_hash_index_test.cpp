@@ -0,0 +1,298 @@
+/**
+ * extendible_hash_index_test.cpp
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#include "buffer/buffer_pool_manager.h"
+#include "index/b_plus_tree.h"
+#include "index/extendible_hash_table.h"
+#include "page/header_page.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(ExtendibleHashIndexTests, InsertTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+
+  ExtendibleHashTable<GenericKey<8>, RID, GenericComparator<8>> table(
+      "foo_pk", bpm, comparator);
+  GenericKey<8> index_key;
+  RID rid;
+
+  std::vector<int64_t> keys = {1, 2, 3, 4, 5};
+  for (auto key : keys) {
+    rid.Set((int32_t)(key >> 32), key & 0xFFFFFFFF);
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(table.Insert(index_key, rid));
+  }
+  // unique key only
+  index_key.SetFromInteger(3);
+  EXPECT_FALSE(table.Insert(index_key, rid));
+
+  std::vector<RID> rids;
+  for (auto key : keys) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(table.GetValue(index_key, rids));
+    ASSERT_EQ(1, rids.size());
+    EXPECT_EQ(key, rids[0].GetSlotNum());
+  }
+  rids.clear();
+  index_key.SetFromInteger(6);
+  EXPECT_FALSE(table.GetValue(index_key, rids));
+  EXPECT_TRUE(rids.empty());
+
+  index_key.SetFromInteger(1);
+  EXPECT_TRUE(table.Remove(index_key));
+  EXPECT_FALSE(table.Remove(index_key));
+  EXPECT_FALSE(table.GetValue(index_key, rids));
+
+  // the directory page is recorded under the index name
+  auto header = static_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  page_id_t directory_page_id;
+  EXPECT_TRUE(header->GetRootId("foo_pk", directory_page_id));
+  EXPECT_EQ(table.GetDirectoryPageId(), directory_page_id);
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete bpm;
+  delete disk_manager;
+  delete key_schema;
+  remove("test.db");
+}
+
+// a pool far smaller than the table, so that buckets are read back from disk
+TEST(ExtendibleHashIndexTests, ScaleTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(page_id);
+
+  ExtendibleHashTable<GenericKey<8>, RID, GenericComparator<8>> table(
+      "foo_pk", bpm, comparator);
+  GenericKey<8> index_key;
+  RID rid;
+
+  const int64_t scale = 50000;
+  std::vector<int64_t> keys(scale);
+  for (int64_t i = 0; i < scale; ++i) {
+    keys[i] = i * 7919;
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+  for (auto key : keys) {
+    rid.Set((int32_t)(key >> 32), key & 0xFFFFFFFF);
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(table.Insert(index_key, rid));
+  }
+  EXPECT_GT(table.GetGlobalDepth(), 0);
+
+  // remove every other key
+  for (size_t i = 0; i < keys.size(); i += 2) {
+    index_key.SetFromInteger(keys[i]);
+    EXPECT_TRUE(table.Remove(index_key));
+  }
+  std::vector<RID> rids;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    rids.clear();
+    index_key.SetFromInteger(keys[i]);
+    EXPECT_EQ(i % 2 == 1, table.GetValue(index_key, rids));
+    if (i % 2 == 1) {
+      EXPECT_EQ(keys[i] & 0xFFFFFFFF, rids[0].GetSlotNum());
+    }
+  }
+
+  // reopen the table from its directory page
+  ExtendibleHashTable<GenericKey<8>, RID, GenericComparator<8>> reopened(
+      "foo_pk", bpm, comparator, table.GetDirectoryPageId());
+  for (size_t i = 1; i < keys.size(); i += 2) {
+    rids.clear();
+    index_key.SetFromInteger(keys[i]);
+    EXPECT_TRUE(reopened.GetValue(index_key, rids));
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete bpm;
+  delete disk_manager;
+  delete key_schema;
+  remove("test.db");
+}
+
+// wide keys fill the largest directory, buckets then chain overflow pages
+TEST(ExtendibleHashIndexTests, OverflowTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<64> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(page_id);
+
+  ExtendibleHashTable<GenericKey<64>, RID, GenericComparator<64>> table(
+      "foo_pk", bpm, comparator);
+  GenericKey<64> index_key;
+  RID rid;
+
+  const int64_t scale = 60000;
+  for (int64_t key = 0; key < scale; ++key) {
+    rid.Set(0, key);
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(table.Insert(index_key, rid));
+  }
+  auto directory = reinterpret_cast<HashTableDirectoryPage *>(
+      bpm->FetchPage(table.GetDirectoryPageId())->GetData());
+  EXPECT_EQ(directory->GetMaxDepth(), directory->GetGlobalDepth());
+  bpm->UnpinPage(table.GetDirectoryPageId(), false);
+
+  std::vector<RID> rids;
+  for (int64_t key = 0; key < scale; ++key) {
+    index_key.SetFromInteger(key);
+    EXPECT_FALSE(table.Insert(index_key, rid));
+    rids.clear();
+    EXPECT_TRUE(table.GetValue(index_key, rids));
+    EXPECT_EQ(key, rids[0].GetSlotNum());
+  }
+  for (int64_t key = 0; key < scale; ++key) {
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(table.Remove(index_key));
+  }
+  for (int64_t key = 0; key < scale; ++key) {
+    index_key.SetFromInteger(key);
+    EXPECT_FALSE(table.GetValue(index_key, rids));
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete bpm;
+  delete disk_manager;
+  delete key_schema;
+  remove("test.db");
+}
+
+TEST(ExtendibleHashIndexTests, ConcurrentTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(page_id);
+
+  ExtendibleHashTable<GenericKey<8>, RID, GenericComparator<8>> table(
+      "foo_pk", bpm, comparator);
+
+  const int num_threads = 4;
+  const int64_t keys_per_thread = 10000;
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([&table, tid]() {
+      GenericKey<8> index_key;
+      RID rid;
+      std::vector<RID> rids;
+      for (int64_t i = 0; i < keys_per_thread; ++i) {
+        int64_t key = i * num_threads + tid;
+        rid.Set(0, key);
+        index_key.SetFromInteger(key);
+        EXPECT_TRUE(table.Insert(index_key, rid));
+        rids.clear();
+        EXPECT_TRUE(table.GetValue(index_key, rids));
+        if (i % 2) {
+          EXPECT_TRUE(table.Remove(index_key));
+        }
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  GenericKey<8> index_key;
+  std::vector<RID> rids;
+  for (int64_t key = 0; key < num_threads * keys_per_thread; ++key) {
+    index_key.SetFromInteger(key);
+    rids.clear();
+    EXPECT_EQ((key / num_threads) % 2 == 0, table.GetValue(index_key, rids));
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete bpm;
+  delete disk_manager;
+  delete key_schema;
+  remove("test.db");
+}
+
+// page fetches per point lookup, against the b+ tree
+TEST(ExtendibleHashIndexTests, PageFetchTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(1000, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(page_id);
+
+  ExtendibleHashTable<GenericKey<8>, RID, GenericComparator<8>> table(
+      "foo_hash", bpm, comparator);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_tree", bpm,
+                                                           comparator);
+  GenericKey<8> index_key;
+  RID rid;
+  // few enough keys for the directory to need no overflow page
+  const int64_t scale = 50000;
+  for (int64_t key = 0; key < scale; ++key) {
+    rid.Set(0, key);
+    index_key.SetFromInteger(key);
+    table.Insert(index_key, rid);
+    tree.Insert(index_key, rid);
+  }
+
+  auto count_fetches = [&bpm]() {
+    auto stats = bpm->GetStats();
+    return stats.Get(BufferPoolCounter::FETCH_HIT) +
+           stats.Get(BufferPoolCounter::FETCH_MISS);
+  };
+  std::vector<RID> rids;
+  bpm->ResetStats();
+  for (int64_t key = 0; key < scale; ++key) {
+    index_key.SetFromInteger(key);
+    table.GetValue(index_key, rids);
+  }
+  uint64_t hash_fetches = count_fetches();
+  bpm->ResetStats();
+  for (int64_t key = 0; key < scale; ++key) {
+    index_key.SetFromInteger(key);
+    tree.GetValue(index_key, rids);
+  }
+  uint64_t tree_fetches = count_fetches();
+
+  // the directory and the bucket
+  EXPECT_EQ(2 * scale, hash_fetches);
+  EXPECT_LT(hash_fetches, tree_fetches);
+  std::cout << "page fetches per lookup: hash index "
+            << (double)hash_fetches / scale << ", b+ tree (depth "
+            << tree.GetDepth() << ") " << (double)tree_fetches / scale
+            << std::endl;
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete bpm;
+  delete disk_manager;
+  delete key_schema;
+  remove("test.db");
+}
+
+} // namespace cmudb
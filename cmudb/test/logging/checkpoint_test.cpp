@@ -0,0 +1,521 @@
+/**
+ * checkpoint_test.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "disk/segmented_log.h"
+#include "logging/common.h"
+#include "logging/log_recovery.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// the database, log, free space map and master record files, and the log
+// segments
+static std::vector<std::string> DatabaseFiles() {
+  std::vector<std::string> exts{".db", ".log", ".fsm", ".warm", ".master"};
+  for (int segment = 0; segment < 1024; ++segment) {
+    exts.push_back(".log." + std::to_string(segment));
+  }
+  return exts;
+}
+
+// the files of from, copied to to. A file from does not have is removed
+static void CopyDatabase(const std::string &from, const std::string &to) {
+  for (const std::string &ext : DatabaseFiles()) {
+    std::ifstream in(from + ext, std::ios::binary);
+    if (!in) {
+      remove((to + ext).c_str());
+      continue;
+    }
+    std::ofstream out(to + ext, std::ios::binary | std::ios::trunc);
+    out << in.rdbuf();
+  }
+}
+
+static void RemoveDatabase(const std::string &name) {
+  for (const std::string &ext : DatabaseFiles()) {
+    remove((name + ext).c_str());
+  }
+}
+
+// recover name, check the table against expected and return the recovery
+// time in seconds
+static double RecoverAndCheck(const std::string &name, size_t pool_size,
+                              size_t num_workers, page_id_t first_page_id,
+                              std::unordered_map<RID, std::string> &expected) {
+  StorageEngine *storage_engine = new StorageEngine(name + ".db", pool_size);
+  LogRecovery *log_recovery = new LogRecovery(
+      storage_engine->disk_manager_, storage_engine->buffer_pool_manager_);
+  auto start = std::chrono::steady_clock::now();
+  log_recovery->Redo(num_workers);
+  log_recovery->Undo();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  delete log_recovery;
+
+  Transaction *txn = storage_engine->transaction_manager_->Begin();
+  TableHeap *table = new TableHeap(storage_engine->buffer_pool_manager_,
+                                   storage_engine->lock_manager_,
+                                   storage_engine->log_manager_, first_page_id);
+  size_t num_tuples = 0;
+  for (auto itr = table->begin(txn); itr != table->end(); ++itr) {
+    ++num_tuples;
+    auto tuple = expected.find(itr->GetRid());
+    EXPECT_NE(expected.end(), tuple);
+    if (tuple == expected.end()) break;
+    EXPECT_EQ(tuple->second, std::string(itr->GetData(), itr->GetLength()));
+  }
+  EXPECT_EQ(expected.size(), num_tuples);
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+  delete table;
+  delete storage_engine;
+  return elapsed.count();
+}
+
+static Tuple MakeTuple(Schema *schema, int64_t key, const std::string &value) {
+  std::vector<Value> values{
+      Value(TypeId::BIGINT, key),
+      Value(TypeId::VARCHAR, value.c_str(), value.size() + 1, false)};
+  return Tuple(values, schema);
+}
+
+// checkpoints taken while transactions keep updating the table, and one
+// transaction that runs across them without committing. Recovery from the
+// last checkpoint gives the same table as recovery from the whole log.
+TEST(CheckpointTest, FuzzyCheckpointTest) {
+  const int num_threads = 4;
+  const int tuples_per_thread = 200;
+  const int loser_tuples = 50;
+  const size_t pool_size = 32;
+  StorageEngine *storage_engine = new StorageEngine("test.db", pool_size);
+  storage_engine->log_manager_->RunFlushThread();
+  Schema *schema = ParseCreateStatement("a bigint, b varchar(32)");
+  std::string padding(31, 'x');
+
+  Transaction *txn = storage_engine->transaction_manager_->Begin();
+  TableHeap *test_table = new TableHeap(storage_engine->buffer_pool_manager_,
+                                        storage_engine->lock_manager_,
+                                        storage_engine->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  std::unordered_map<RID, std::string> expected;
+  std::vector<RID> rids;
+  for (int i = 0; i < num_threads * tuples_per_thread + loser_tuples; ++i) {
+    RID rid;
+    Tuple tuple = MakeTuple(schema, i, padding);
+    EXPECT_TRUE(test_table->InsertTuple(tuple, rid, txn));
+    expected[rid] = std::string(tuple.GetData(), tuple.GetLength());
+    rids.push_back(rid);
+  }
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // a transaction that is active during every checkpoint, it changes the
+  // last tuples before and after them
+  Transaction *loser = storage_engine->transaction_manager_->Begin();
+  auto loser_updates = [&](int from, int to) {
+    for (int i = from; i < to; ++i) {
+      Tuple tuple = MakeTuple(schema, -i, padding);
+      EXPECT_TRUE(test_table->UpdateTuple(
+          tuple, rids[num_threads * tuples_per_thread + i], loser));
+    }
+  };
+  loser_updates(0, loser_tuples / 2);
+
+  storage_engine->checkpoint_manager_->RunCheckpointThread(
+      std::chrono::milliseconds(5), 4096);
+  std::mutex expected_latch;
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([&, tid] {
+      for (int round = 1; round <= 20; ++round) {
+        Transaction *txn = storage_engine->transaction_manager_->Begin();
+        std::vector<std::pair<RID, std::string>> updated;
+        for (int i = 0; i < tuples_per_thread; i += 1 + round % 3) {
+          RID rid = rids[tid * tuples_per_thread + i];
+          Tuple tuple = MakeTuple(schema, round * 1000 + i, padding);
+          EXPECT_TRUE(test_table->UpdateTuple(tuple, rid, txn));
+          updated.emplace_back(rid,
+                               std::string(tuple.GetData(), tuple.GetLength()));
+        }
+        storage_engine->transaction_manager_->Commit(txn);
+        delete txn;
+        std::lock_guard<std::mutex> guard(expected_latch);
+        for (auto &update : updated) {
+          expected[update.first] = update.second;
+        }
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  storage_engine->checkpoint_manager_->StopCheckpointThread();
+  EXPECT_NE(INVALID_LSN, storage_engine->checkpoint_manager_->Checkpoint());
+  EXPECT_LE(2u, storage_engine->checkpoint_manager_->GetNumCheckpoints());
+  loser_updates(loser_tuples / 2, loser_tuples);
+  storage_engine->log_manager_->Flush(loser->GetPrevLSN());
+  // crash, pages written back so far stay as they are
+  delete storage_engine;
+  delete test_table;
+  delete loser;
+  CopyDatabase("test", "crash");
+
+  for (size_t num_workers : {0, 4}) {
+    CopyDatabase("crash", "test");
+    RecoverAndCheck("test", pool_size, num_workers, first_page_id, expected);
+  }
+  // from the start of the log
+  remove("crash.master");
+  CopyDatabase("crash", "test");
+  RecoverAndCheck("test", pool_size, 0, first_page_id, expected);
+
+  delete schema;
+  RemoveDatabase("test");
+  RemoveDatabase("crash");
+}
+
+// lsns continue after recovery, a checkpoint of the next run and a crash
+// after it recover the changes of both runs
+TEST(CheckpointTest, RestartTest) {
+  Schema *schema = ParseCreateStatement("a bigint, b varchar(32)");
+  std::string padding(31, 'y');
+  std::unordered_map<RID, std::string> expected;
+  std::vector<RID> rids;
+  page_id_t first_page_id = INVALID_PAGE_ID;
+  for (int run = 0; run < 3; ++run) {
+    StorageEngine *storage_engine = new StorageEngine("test.db");
+    LogRecovery *log_recovery = new LogRecovery(
+        storage_engine->disk_manager_, storage_engine->buffer_pool_manager_);
+    log_recovery->Redo();
+    log_recovery->Undo();
+    storage_engine->log_manager_->SetNextLSN(log_recovery->GetNextLSN());
+    delete log_recovery;
+    storage_engine->log_manager_->RunFlushThread();
+
+    Transaction *txn = storage_engine->transaction_manager_->Begin();
+    TableHeap *test_table;
+    if (run == 0) {
+      test_table = new TableHeap(storage_engine->buffer_pool_manager_,
+                                 storage_engine->lock_manager_,
+                                 storage_engine->log_manager_, txn);
+      first_page_id = test_table->GetFirstPageId();
+      // a database file that is empty after a crash starts over with an
+      // empty free space map
+      storage_engine->buffer_pool_manager_->FlushAllPages();
+    } else {
+      test_table = new TableHeap(storage_engine->buffer_pool_manager_,
+                                 storage_engine->lock_manager_,
+                                 storage_engine->log_manager_, first_page_id);
+    }
+    for (int i = 0; i < 100; ++i) {
+      RID rid;
+      Tuple tuple = MakeTuple(schema, run * 100 + i, padding);
+      EXPECT_TRUE(test_table->InsertTuple(tuple, rid, txn));
+      expected[rid] = std::string(tuple.GetData(), tuple.GetLength());
+      rids.push_back(rid);
+    }
+    storage_engine->transaction_manager_->Commit(txn);
+    delete txn;
+    EXPECT_NE(INVALID_LSN, storage_engine->checkpoint_manager_->Checkpoint());
+
+    txn = storage_engine->transaction_manager_->Begin();
+    for (size_t i = run; i < rids.size(); i += 3) {
+      Tuple tuple = MakeTuple(schema, -run, padding);
+      EXPECT_TRUE(test_table->UpdateTuple(tuple, rids[i], txn));
+      expected[rids[i]] = std::string(tuple.GetData(), tuple.GetLength());
+    }
+    storage_engine->transaction_manager_->Commit(txn);
+    delete txn;
+    // crash
+    delete storage_engine;
+    delete test_table;
+  }
+  RecoverAndCheck("test", BUFFER_POOL_SIZE, REDO_WORKERS, first_page_id,
+                  expected);
+
+  delete schema;
+  RemoveDatabase("test");
+}
+
+// checkpoints truncate the log, its segment files are recycled and recovery
+// still finds the log it needs
+TEST(CheckpointTest, LogTruncationTest) {
+  const size_t segment_size = 1 << 20;
+  const int num_tuples = 512;
+  RemoveDatabase("test");
+  // a log with small segments, the storage engine keeps its segment size
+  SegmentedLog *log = new SegmentedLog("test.log", segment_size);
+  EXPECT_TRUE(log->Append(nullptr, 0));
+  delete log;
+
+  StorageEngine *storage_engine = new StorageEngine("test.db");
+  storage_engine->log_manager_->RunFlushThread();
+  Schema *schema = ParseCreateStatement("a bigint, b varchar(64)");
+  std::string padding(63, 'w');
+  Transaction *txn = storage_engine->transaction_manager_->Begin();
+  TableHeap *test_table = new TableHeap(storage_engine->buffer_pool_manager_,
+                                        storage_engine->lock_manager_,
+                                        storage_engine->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  std::unordered_map<RID, std::string> expected;
+  std::vector<RID> rids;
+  for (int i = 0; i < num_tuples; ++i) {
+    RID rid;
+    Tuple tuple = MakeTuple(schema, i, padding);
+    EXPECT_TRUE(test_table->InsertTuple(tuple, rid, txn));
+    expected[rid] = std::string(tuple.GetData(), tuple.GetLength());
+    rids.push_back(rid);
+  }
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // 16 MB of log, a checkpoint every segment
+  size_t next_checkpoint = segment_size;
+  for (int64_t i = 0; storage_engine->log_manager_->GetLogSize() < (16 << 20);
+       ++i) {
+    txn = storage_engine->transaction_manager_->Begin();
+    for (int j = 0; j < 64; ++j) {
+      RID rid = rids[(i * 64 + j) % num_tuples];
+      Tuple tuple = MakeTuple(schema, i * 64 + j, padding);
+      EXPECT_TRUE(test_table->UpdateTuple(tuple, rid, txn));
+      expected[rid] = std::string(tuple.GetData(), tuple.GetLength());
+    }
+    storage_engine->transaction_manager_->Commit(txn);
+    delete txn;
+    if (storage_engine->log_manager_->GetLogSize() >= next_checkpoint) {
+      EXPECT_NE(INVALID_LSN,
+                storage_engine->checkpoint_manager_->Checkpoint());
+      next_checkpoint += segment_size;
+    }
+  }
+  // the segments since the start of redo, which is found at the offset of an
+  // lsn the log manager remembers every RECOVERY_READ_SIZE, and the recycled
+  // ones are left
+  size_t num_segments = 0;
+  for (int segment = 0; segment < 64; ++segment) {
+    std::ifstream in("test.log." + std::to_string(segment));
+    if (in) ++num_segments;
+  }
+  EXPECT_GE(RECOVERY_READ_SIZE / segment_size + 3 + LOG_RECYCLED_SEGMENTS,
+            num_segments);
+  std::ifstream first_segment("test.log.0");
+  EXPECT_FALSE(first_segment);
+
+  // crash
+  storage_engine->buffer_pool_manager_->StopPageCleaner();
+  CopyDatabase("test", "crash");
+  storage_engine->buffer_pool_manager_->RunPageCleaner();
+  RecoverAndCheck("crash", BUFFER_POOL_SIZE, REDO_WORKERS, first_page_id,
+                  expected);
+  ENABLE_LOGGING = true;
+
+  delete storage_engine;
+  delete test_table;
+  delete schema;
+  RemoveDatabase("test");
+  RemoveDatabase("crash");
+}
+
+// the end of the log lies in a recycled segment, which still holds old log
+// records, and the zeros that mark it were torn off by the crash: an update
+// record of a transaction that committed long ago follows the last record.
+// Recovery must end the log there instead of undoing that update.
+TEST(CheckpointTest, TornTailTest) {
+  const size_t segment_size = 1 << 18;
+  const int num_tuples = 64;
+  RemoveDatabase("test");
+  SegmentedLog *log = new SegmentedLog("test.log", segment_size);
+  EXPECT_TRUE(log->Append(nullptr, 0));
+  delete log;
+
+  StorageEngine *storage_engine = new StorageEngine("test.db");
+  storage_engine->log_manager_->RunFlushThread();
+  Schema *schema = ParseCreateStatement("a bigint, b varchar(64)");
+  std::string padding(63, 'w');
+  Transaction *txn = storage_engine->transaction_manager_->Begin();
+  TableHeap *test_table = new TableHeap(storage_engine->buffer_pool_manager_,
+                                        storage_engine->lock_manager_,
+                                        storage_engine->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  std::unordered_map<RID, std::string> expected;
+  std::vector<RID> rids;
+  for (int i = 0; i < num_tuples; ++i) {
+    RID rid;
+    Tuple tuple = MakeTuple(schema, i, padding);
+    EXPECT_TRUE(test_table->InsertTuple(tuple, rid, txn));
+    expected[rid] = std::string(tuple.GetData(), tuple.GetLength());
+    rids.push_back(rid);
+  }
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // a checkpoint every segment. The log is first truncated once redo can
+  // start RECOVERY_READ_SIZE after the start, the next LOG_RECYCLED_SEGMENTS
+  // segments are recycled ones, the log ends in one of them
+  std::string old_record;
+  size_t next_checkpoint = segment_size;
+  for (int64_t i = 0; storage_engine->log_manager_->GetLogSize() <
+                      RECOVERY_READ_SIZE + 5 * segment_size / 2;
+       ++i) {
+    txn = storage_engine->transaction_manager_->Begin();
+    for (int j = 0; j < 64; ++j) {
+      RID rid = rids[(i * 64 + j) % num_tuples];
+      Tuple tuple = MakeTuple(schema, i * 64 + j + num_tuples, padding);
+      EXPECT_TRUE(test_table->UpdateTuple(tuple, rid, txn));
+      expected[rid] = std::string(tuple.GetData(), tuple.GetLength());
+    }
+    lsn_t update_lsn = txn->GetPrevLSN();
+    storage_engine->transaction_manager_->Commit(txn);
+    delete txn;
+    if (old_record.empty()) {
+      // the last update of the first transaction, as the old contents of
+      // a segment
+      LogRecovery log_recovery(storage_engine->disk_manager_,
+                               storage_engine->buffer_pool_manager_);
+      std::vector<char> buffer(1 << 16);
+      size_t offset = storage_engine->log_manager_->GetLogOffset(update_lsn);
+      ASSERT_TRUE(storage_engine->disk_manager_->ReadLog(
+          buffer.data(), buffer.size(), offset));
+      LogRecord log_record;
+      for (size_t pos = 0; log_recovery.DeserializeLogRecord(
+               buffer.data() + pos, buffer.size() - pos, log_record);
+           pos += log_record.GetSize()) {
+        if (log_record.GetLSN() == update_lsn) {
+          EXPECT_EQ(LogRecordType::UPDATE, log_record.GetLogRecordType());
+          old_record.assign(buffer.data() + pos, log_record.GetSize());
+          break;
+        }
+      }
+      ASSERT_FALSE(old_record.empty());
+    }
+    if (storage_engine->log_manager_->GetLogSize() >= next_checkpoint) {
+      EXPECT_NE(INVALID_LSN,
+                storage_engine->checkpoint_manager_->Checkpoint());
+      next_checkpoint += segment_size;
+    }
+  }
+
+  // crash, the old record takes the place of the end mark
+  storage_engine->buffer_pool_manager_->StopPageCleaner();
+  CopyDatabase("test", "crash");
+  storage_engine->buffer_pool_manager_->RunPageCleaner();
+  size_t end = storage_engine->log_manager_->GetLogSize();
+  ASSERT_LE(end % segment_size + old_record.size(), segment_size);
+  std::fstream segment("crash.log." + std::to_string(end / segment_size),
+                       std::ios::binary | std::ios::in | std::ios::out);
+  ASSERT_TRUE(segment.good());
+  // a recycled segment, old records are left where the end mark goes
+  std::string old_bytes(old_record.size(), '\0');
+  segment.seekg(end % segment_size);
+  segment.read(&old_bytes[0], old_bytes.size());
+  ASSERT_NE(std::string(old_bytes.size(), '\0'), old_bytes);
+  segment.seekp(end % segment_size);
+  segment.write(old_record.data(), old_record.size());
+  segment.close();
+  RecoverAndCheck("crash", BUFFER_POOL_SIZE, REDO_WORKERS, first_page_id,
+                  expected);
+  ENABLE_LOGGING = true;
+
+  delete storage_engine;
+  delete test_table;
+  delete schema;
+  RemoveDatabase("test");
+  RemoveDatabase("crash");
+}
+
+// restart time as the log grows, with a checkpoint every MB of log and
+// without the master record, the log is not truncated. The log grows to 32 MB, CMUDB_CHECKPOINT_LOG_MB
+// makes it bigger.
+TEST(CheckpointTest, RestartBenchmark) {
+  size_t log_size = 32 << 20;
+  if (const char *env = getenv("CMUDB_CHECKPOINT_LOG_MB")) {
+    log_size = strtoull(env, nullptr, 10) << 20;
+  }
+  const size_t pool_size = 256;
+  const int num_tuples = 4096;
+  StorageEngine *storage_engine = new StorageEngine("test.db", pool_size);
+  storage_engine->log_manager_->RunFlushThread();
+  // recovery from the start needs all of the log
+  storage_engine->checkpoint_manager_->SetTruncateLog(false);
+  Schema *schema = ParseCreateStatement("a bigint, b varchar(64)");
+  std::string padding(63, 'z');
+
+  Transaction *txn = storage_engine->transaction_manager_->Begin();
+  TableHeap *test_table = new TableHeap(storage_engine->buffer_pool_manager_,
+                                        storage_engine->lock_manager_,
+                                        storage_engine->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  std::unordered_map<RID, std::string> expected;
+  std::vector<RID> rids;
+  for (int i = 0; i < num_tuples; ++i) {
+    RID rid;
+    Tuple tuple = MakeTuple(schema, i, padding);
+    EXPECT_TRUE(test_table->InsertTuple(tuple, rid, txn));
+    expected[rid] = std::string(tuple.GetData(), tuple.GetLength());
+    rids.push_back(rid);
+  }
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+
+  srand(0);
+  size_t next_checkpoint = 1 << 20;
+  size_t next_restart = 8 << 20;
+  for (int64_t i = 0; storage_engine->log_manager_->GetLogSize() < log_size;
+       ++i) {
+    txn = storage_engine->transaction_manager_->Begin();
+    for (int j = 0; j < 1024; ++j) {
+      RID rid = rids[rand() % num_tuples];
+      Tuple tuple = MakeTuple(schema, i * 1024 + j, padding);
+      EXPECT_TRUE(test_table->UpdateTuple(tuple, rid, txn));
+      expected[rid] = std::string(tuple.GetData(), tuple.GetLength());
+    }
+    storage_engine->transaction_manager_->Commit(txn);
+    delete txn;
+    size_t logged = storage_engine->log_manager_->GetLogSize();
+    if (logged >= next_checkpoint) {
+      storage_engine->checkpoint_manager_->Checkpoint();
+      next_checkpoint = logged + (1 << 20);
+    }
+    if (logged < next_restart) continue;
+    next_restart *= 2;
+
+    // a crash now, without pages the cleaner is writing
+    storage_engine->buffer_pool_manager_->StopPageCleaner();
+    CopyDatabase("test", "crash");
+    storage_engine->buffer_pool_manager_->RunPageCleaner();
+    double checkpointed =
+        RecoverAndCheck("crash", pool_size, REDO_WORKERS, first_page_id,
+                        expected);
+    RemoveDatabase("crash");
+    CopyDatabase("test", "crash");
+    remove("crash.master");
+    double full = RecoverAndCheck("crash", pool_size, REDO_WORKERS,
+                                  first_page_id, expected);
+    RemoveDatabase("crash");
+    // a storage engine starts with logging off
+    ENABLE_LOGGING = true;
+    std::cout << (logged >> 20) << " MB of log: " << checkpointed
+              << " s from the last checkpoint, " << full
+              << " s from the start" << std::endl;
+  }
+
+  delete storage_engine;
+  delete test_table;
+  delete schema;
+  RemoveDatabase("test");
+}
+
+} // namespace cmudb
@@ -0,0 +1,161 @@
+/**
+ * group_commit_test.cpp
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "concurrency/transaction_manager.h"
+#include "logging/log_manager.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// records of every thread reach the log file once, in lsn order
+TEST(GroupCommitTest, AppendFlushTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+  log_manager->RunFlushThread();
+  EXPECT_TRUE(ENABLE_LOGGING);
+
+  // more than a log buffer, so that full buffers are flushed too
+  const int num_threads = 4;
+  const int records_per_thread = 5000;
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([log_manager, tid]() {
+      for (int i = 0; i < records_per_thread; ++i) {
+        LogRecord log_record(tid, INVALID_LSN, LogRecordType::NEWPAGE,
+                             INVALID_PAGE_ID, i);
+        lsn_t lsn = log_manager->AppendLogRecord(log_record);
+        EXPECT_EQ(lsn, log_record.GetLSN());
+        if (i % 100 == 0) {
+          log_manager->Flush(lsn);
+          EXPECT_LE(lsn, log_manager->GetPersistentLSN());
+        }
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  log_manager->StopFlushThread();
+  EXPECT_FALSE(ENABLE_LOGGING);
+  EXPECT_EQ(num_threads * records_per_thread - 1,
+            log_manager->GetPersistentLSN());
+
+  const int record_size = 28;
+  std::vector<char> log(num_threads * records_per_thread * record_size);
+  EXPECT_TRUE(disk_manager->ReadLog(log.data(), log.size(), 0));
+  std::vector<int> next_page(num_threads, 0);
+  for (int i = 0; i < num_threads * records_per_thread; ++i) {
+    const int32_t *fields =
+        reinterpret_cast<const int32_t *>(log.data() + i * record_size);
+    EXPECT_EQ(record_size, fields[0]);
+    EXPECT_EQ(i, fields[1]);
+    EXPECT_EQ(static_cast<int32_t>(LogRecordType::NEWPAGE), fields[4]);
+    // per thread, in append order
+    ASSERT_LT(fields[2], num_threads);
+    EXPECT_EQ(next_page[fields[2]]++, fields[6]);
+  }
+
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+  remove("test.fsm");
+}
+
+// commits per second, and how many commits share a log write
+TEST(GroupCommitTest, CommitBenchmark) {
+  const int num_commits = 1024;
+  for (int num_threads = 1; num_threads <= 64; num_threads *= 2) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    LogManager *log_manager = new LogManager(disk_manager);
+    LockManager *lock_manager = new LockManager(true);
+    TransactionManager *transaction_manager =
+        new TransactionManager(lock_manager, log_manager);
+    log_manager->RunFlushThread();
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_threads; ++tid) {
+      threads.push_back(std::thread([transaction_manager, log_manager,
+                                     num_threads]() {
+        for (int i = 0; i < num_commits / num_threads; ++i) {
+          Transaction *txn = transaction_manager->Begin();
+          transaction_manager->Commit(txn);
+          // the commit record is on disk
+          EXPECT_LE(txn->GetPrevLSN(), log_manager->GetPersistentLSN());
+          delete txn;
+        }
+      }));
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    int num_flushes = disk_manager->GetNumFlushes();
+    std::cout << num_threads << " threads: "
+              << (int)(num_commits / elapsed.count()) << " commits/s, "
+              << (double)num_commits / num_flushes << " commits per flush"
+              << std::endl;
+    if (num_threads >= 8) {
+      EXPECT_LT(num_flushes, num_commits);
+    }
+
+    log_manager->StopFlushThread();
+    delete transaction_manager;
+    delete lock_manager;
+    delete log_manager;
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+    remove("test.fsm");
+  }
+}
+
+// appended records per second, the log buffer is shared by all threads
+TEST(GroupCommitTest, AppendBenchmark) {
+  const int num_records = 1 << 20;
+  for (int num_threads = 1; num_threads <= 32; num_threads *= 2) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    LogManager *log_manager = new LogManager(disk_manager);
+    log_manager->RunFlushThread();
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_threads; ++tid) {
+      threads.push_back(std::thread([log_manager, num_threads, tid]() {
+        for (int i = 0; i < num_records / num_threads; ++i) {
+          LogRecord log_record(tid, INVALID_LSN, LogRecordType::NEWPAGE,
+                               INVALID_PAGE_ID, i);
+          log_manager->AppendLogRecord(log_record);
+        }
+      }));
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << num_threads << " threads: "
+              << (int)(num_records / elapsed.count()) << " appends/s"
+              << std::endl;
+
+    log_manager->StopFlushThread();
+    EXPECT_EQ(num_records - 1, log_manager->GetPersistentLSN());
+    delete log_manager;
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+    remove("test.fsm");
+  }
+}
+
+} // namespace cmudb
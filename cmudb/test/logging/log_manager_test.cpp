@@ -47,7 +47,7 @@ TEST(LogManagerTest, BasicLogging) {
   LOG_DEBUG("size  = %d", size);
   size = *reinterpret_cast<int32_t *>(buffer + 20);
   LOG_DEBUG("size  = %d", size);
-  size = *reinterpret_cast<int32_t *>(buffer + 44);
+  size = *reinterpret_cast<int32_t *>(buffer + 48);
   LOG_DEBUG("size  = %d", size);
 
   delete txn;
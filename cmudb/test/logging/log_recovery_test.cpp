@@ -0,0 +1,252 @@
+/**
+ * log_recovery_test.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "logging/common.h"
+#include "logging/log_recovery.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// the database, log and free space map files, and the log segments
+static std::vector<std::string> DatabaseFiles() {
+  std::vector<std::string> exts{".db", ".log", ".fsm", ".warm", ".master"};
+  for (int segment = 0; segment < 1024; ++segment) {
+    exts.push_back(".log." + std::to_string(segment));
+  }
+  return exts;
+}
+
+// the files of from, copied to to
+static void CopyDatabase(const std::string &from, const std::string &to) {
+  for (const std::string &ext : DatabaseFiles()) {
+    std::ifstream in(from + ext, std::ios::binary);
+    if (!in) {
+      remove((to + ext).c_str());
+      continue;
+    }
+    std::ofstream out(to + ext, std::ios::binary | std::ios::trunc);
+    out << in.rdbuf();
+  }
+}
+
+static void RemoveDatabase(const std::string &name) {
+  for (const std::string &ext : DatabaseFiles()) {
+    remove((name + ext).c_str());
+  }
+}
+
+// the same table comes back with serial and parallel redo, without the
+// changes of the transaction that did not commit
+TEST(LogRecoveryTest, ParallelRedoTest) {
+  StorageEngine *storage_engine = new StorageEngine("test.db");
+  storage_engine->log_manager_->RunFlushThread();
+  Schema *schema = ParseCreateStatement(
+      "a varchar, b smallint, c bigint, d bool, e varchar(16)");
+
+  Transaction *txn = storage_engine->transaction_manager_->Begin();
+  TableHeap *test_table = new TableHeap(storage_engine->buffer_pool_manager_,
+                                        storage_engine->lock_manager_,
+                                        storage_engine->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // committed inserts over several pages, then updates and deletes
+  std::unordered_map<RID, std::string> expected;
+  std::vector<RID> rids;
+  for (int i = 0; i < 20; ++i) {
+    txn = storage_engine->transaction_manager_->Begin();
+    for (int j = 0; j < 20; ++j) {
+      RID rid;
+      Tuple tuple = ConstructTuple(schema);
+      EXPECT_TRUE(test_table->InsertTuple(tuple, rid, txn));
+      expected[rid] = std::string(tuple.GetData(), tuple.GetLength());
+      rids.push_back(rid);
+    }
+    storage_engine->transaction_manager_->Commit(txn);
+    delete txn;
+  }
+  txn = storage_engine->transaction_manager_->Begin();
+  for (size_t i = 0; i < rids.size(); ++i) {
+    if (i % 11 == 3) {
+      EXPECT_TRUE(test_table->MarkDelete(rids[i], txn));
+      expected.erase(rids[i]);
+    } else if (i % 7 == 0) {
+      Tuple tuple = ConstructTuple(schema);
+      if (test_table->UpdateTuple(tuple, rids[i], txn))
+        expected[rids[i]] = std::string(tuple.GetData(), tuple.GetLength());
+    }
+  }
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // a transaction that is on disk, but never commits
+  txn = storage_engine->transaction_manager_->Begin();
+  for (int j = 0; j < 10; ++j) {
+    RID rid;
+    Tuple tuple = ConstructTuple(schema);
+    EXPECT_TRUE(test_table->InsertTuple(tuple, rid, txn));
+  }
+  for (size_t i = 1; i < rids.size(); i += 13) {
+    if (expected.count(rids[i]) == 0) continue;
+    Tuple tuple = ConstructTuple(schema);
+    if (i % 2 == 0)
+      test_table->UpdateTuple(tuple, rids[i], txn);
+    else
+      EXPECT_TRUE(test_table->MarkDelete(rids[i], txn));
+  }
+  storage_engine->log_manager_->Flush(txn->GetPrevLSN());
+  // crash, pages written back so far stay as they are
+  delete storage_engine;
+  delete test_table;
+  delete txn;
+  CopyDatabase("test", "crash");
+
+  for (size_t num_workers : {0, 1, 4}) {
+    CopyDatabase("crash", "test");
+    storage_engine = new StorageEngine("test.db");
+    LogRecovery *log_recovery = new LogRecovery(
+        storage_engine->disk_manager_, storage_engine->buffer_pool_manager_);
+    log_recovery->Redo(num_workers);
+    log_recovery->Undo();
+    delete log_recovery;
+
+    txn = storage_engine->transaction_manager_->Begin();
+    test_table = new TableHeap(storage_engine->buffer_pool_manager_,
+                               storage_engine->lock_manager_,
+                               storage_engine->log_manager_, first_page_id);
+    size_t num_tuples = 0;
+    for (auto itr = test_table->begin(txn); itr != test_table->end(); ++itr) {
+      ++num_tuples;
+      auto tuple = expected.find(itr->GetRid());
+      ASSERT_NE(expected.end(), tuple);
+      EXPECT_EQ(tuple->second, std::string(itr->GetData(), itr->GetLength()));
+    }
+    EXPECT_EQ(expected.size(), num_tuples);
+    storage_engine->transaction_manager_->Commit(txn);
+    delete txn;
+    delete test_table;
+    delete storage_engine;
+  }
+
+  delete schema;
+  RemoveDatabase("test");
+  RemoveDatabase("crash");
+}
+
+// time to redo a log of updates to pages that were never written back, by
+// the number of redo workers. The log is 64 MB, CMUDB_RECOVERY_LOG_MB makes
+// it bigger.
+TEST(LogRecoveryTest, RecoveryBenchmark) {
+  size_t log_size = 64 << 20;
+  if (const char *env = getenv("CMUDB_RECOVERY_LOG_MB")) {
+    log_size = strtoull(env, nullptr, 10) << 20;
+  }
+  const int num_pages = 1024;
+  const int tuples_per_page = 32;
+  Schema *schema = ParseCreateStatement("a bigint, b varchar(64)");
+  std::string padding(63, 'x');
+  auto make_tuple = [&schema, &padding](int64_t i) {
+    std::vector<Value> values{
+        Value(TypeId::BIGINT, i),
+        Value(TypeId::VARCHAR, padding.c_str(), padding.size() + 1, false)};
+    return Tuple(values, schema);
+  };
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+  size_t logged = 0;
+  txn_id_t txn_id = 0;
+  lsn_t prev_lsn = INVALID_LSN;
+  auto append = [&](LogRecord &&log_record) {
+    logged += log_record.GetSize();
+    prev_lsn = log_manager->AppendLogRecord(log_record);
+  };
+
+  // a table of num_pages, every page full of tuples, the pages are on disk
+  // without any of the changes
+  std::vector<page_id_t> page_ids;
+  std::vector<Tuple> tuples;
+  std::vector<char> zeros(disk_manager->GetPageSize(), 0);
+  for (int i = 0; i < num_pages; ++i) {
+    page_id_t page_id = disk_manager->AllocatePage();
+    disk_manager->WritePage(page_id, zeros.data());
+    append(LogRecord(++txn_id, INVALID_LSN, LogRecordType::BEGIN));
+    append(LogRecord(txn_id, prev_lsn, LogRecordType::NEWPAGE,
+                     page_ids.empty() ? INVALID_PAGE_ID : page_ids.back(),
+                     page_id));
+    for (int slot = 0; slot < tuples_per_page; ++slot) {
+      tuples.push_back(make_tuple(tuples.size()));
+      append(LogRecord(txn_id, prev_lsn, LogRecordType::INSERT,
+                       RID(page_id, slot), tuples.back()));
+    }
+    append(LogRecord(txn_id, prev_lsn, LogRecordType::COMMIT));
+    page_ids.push_back(page_id);
+  }
+  // then updates all over it
+  srand(0);
+  for (int64_t i = 0; logged < log_size; ++i) {
+    if (i % 64 == 0) {
+      if (i > 0) append(LogRecord(txn_id, prev_lsn, LogRecordType::COMMIT));
+      append(LogRecord(++txn_id, INVALID_LSN, LogRecordType::BEGIN));
+    }
+    int tuple = rand() % tuples.size();
+    Tuple new_tuple = make_tuple(i);
+    append(LogRecord(txn_id, prev_lsn, LogRecordType::UPDATE,
+                     RID(page_ids[tuple / tuples_per_page],
+                         tuple % tuples_per_page),
+                     tuples[tuple], new_tuple));
+    tuples[tuple] = new_tuple;
+  }
+  append(LogRecord(txn_id, prev_lsn, LogRecordType::COMMIT));
+  log_manager->Flush(prev_lsn);
+  delete log_manager;
+
+  // pages after a serial redo, the parallel ones must agree
+  std::vector<std::string> pages;
+  for (size_t num_workers : {0, 1, 2, 4, 8}) {
+    BufferPoolManager *buffer_pool_manager =
+        new BufferPoolManager(2 * num_pages, disk_manager);
+    LogRecovery *log_recovery =
+        new LogRecovery(disk_manager, buffer_pool_manager);
+    auto start = std::chrono::steady_clock::now();
+    log_recovery->Redo(num_workers);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << num_workers << " redo workers: " << elapsed.count() << " s, "
+              << (int)((logged >> 20) / elapsed.count()) << " MB/s"
+              << std::endl;
+    log_recovery->Undo();
+    delete log_recovery;
+
+    for (int i = 0; i < num_pages; ++i) {
+      Page *page = buffer_pool_manager->FetchPage(page_ids[i]);
+      std::string data(page->GetData(), disk_manager->GetPageSize());
+      if (num_workers == 0) {
+        pages.push_back(data);
+      } else {
+        EXPECT_EQ(pages[i], data);
+      }
+      buffer_pool_manager->UnpinPage(page_ids[i], false);
+    }
+    // nothing written back, the next run redoes everything again
+    delete buffer_pool_manager;
+  }
+
+  delete disk_manager;
+  delete schema;
+  RemoveDatabase("test");
+}
+
+} // namespace cmudb
@@ -1,7 +1,11 @@
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
 
 #include "buffer/buffer_pool_manager.h"
+#include "common/exception.h"
 #include "page/header_page.h"
 #include "gtest/gtest.h"
 
@@ -55,4 +59,122 @@ TEST(HeaderPageTest, UnitTest) {
   remove("test.db");
   remove("test.log");
 }
+
+TEST(HeaderPageTest, PageSizeTest) {
+  EXPECT_THROW(DiskManager("test.db", 1000), Exception);
+  EXPECT_THROW(DiskManager("test.db", MAX_PAGE_SIZE * 2), Exception);
+  remove("test.db");
+
+  DiskManager *disk_manager = new DiskManager("test.db", 16384);
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(20, disk_manager);
+  EXPECT_EQ(16384, buffer_pool_manager->GetPageSize());
+  page_id_t header_page_id;
+  HeaderPage *page =
+      static_cast<HeaderPage *>(buffer_pool_manager->NewPage(header_page_id));
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(16384, page->GetPageSize());
+  page->Init();
+  // more records than a default sized page can hold
+  for (int i = 1; i < 200; i++) {
+    EXPECT_EQ(page->InsertRecord(std::to_string(i), i), true);
+  }
+  buffer_pool_manager->UnpinPage(header_page_id, true);
+  buffer_pool_manager->FlushPage(header_page_id);
+  delete buffer_pool_manager;
+  delete disk_manager;
+
+  // the size recorded in the header page wins over the requested one
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(16384, disk_manager->GetPageSize());
+  buffer_pool_manager = new BufferPoolManager(20, disk_manager);
+  page = static_cast<HeaderPage *>(
+      buffer_pool_manager->FetchPage(HEADER_PAGE_ID));
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(199, page->GetRecordCount());
+  page_id_t root_id;
+  EXPECT_EQ(page->GetRootId("199", root_id), true);
+  EXPECT_EQ(199, root_id);
+  buffer_pool_manager->UnpinPage(HEADER_PAGE_ID, false);
+
+  delete buffer_pool_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// a file written before the header page recorded the page size: 512 byte
+// pages, no format marker, the records right after the record count
+TEST(HeaderPageTest, OldFormatTest) {
+  char data[3][OLD_FORMAT_PAGE_SIZE] = {};
+  int record_count = 2;
+  memcpy(data[0], &record_count, 4);
+  for (int i = 0; i < record_count; ++i) {
+    std::string name = "table" + std::to_string(i);
+    page_id_t root_id = 10 + i;
+    memcpy(data[0] + 4 + i * 36, name.c_str(), name.length() + 1);
+    memcpy(data[0] + 4 + i * 36 + 32, &root_id, 4);
+  }
+  strcpy(data[1], "page 1");
+  strcpy(data[2], "page 2");
+  EXPECT_EQ(0, HeaderPage::ReadPageSize(data[0]));
+  EXPECT_TRUE(HeaderPage::IsOlderFormat(data[0]));
+  EXPECT_FALSE(HeaderPage::IsOlderFormat(data[1]));
+  std::ofstream out("test.db", std::ios::binary | std::ios::trunc);
+  out.write(&data[0][0], sizeof(data));
+  out.close();
+
+  // the file keeps its page size whatever is asked for
+  DiskManager *disk_manager = new DiskManager("test.db", 16384);
+  EXPECT_EQ(OLD_FORMAT_PAGE_SIZE, disk_manager->GetPageSize());
+  EXPECT_EQ(3, disk_manager->GetNumPages());
+  delete disk_manager;
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(OLD_FORMAT_PAGE_SIZE, disk_manager->GetPageSize());
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(20, disk_manager);
+  for (page_id_t page_id : {2, 1}) {
+    Page *page = buffer_pool_manager->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_STREQ(data[page_id], page->GetData());
+    buffer_pool_manager->UnpinPage(page_id, false);
+  }
+  // a new page goes after the existing ones
+  page_id_t new_page_id;
+  ASSERT_NE(nullptr, buffer_pool_manager->NewPage(new_page_id));
+  EXPECT_EQ(3, new_page_id);
+  buffer_pool_manager->UnpinPage(new_page_id, false);
+
+  HeaderPage *page = static_cast<HeaderPage *>(
+      buffer_pool_manager->FetchPage(HEADER_PAGE_ID));
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(2, page->GetRecordCount());
+  page_id_t root_id;
+  EXPECT_TRUE(page->GetRootId("table1", root_id));
+  EXPECT_EQ(11, root_id);
+  // and stay in the older layout when changed
+  EXPECT_TRUE(page->InsertRecord("table2", 12));
+  EXPECT_TRUE(page->DeleteRecord("table0"));
+  EXPECT_TRUE(page->UpdateRecord("table1", 21));
+  EXPECT_STREQ("table1", page->GetData() + 4);
+  EXPECT_STREQ("table2", page->GetData() + 4 + 36);
+  EXPECT_TRUE(page->GetRootId("table2", root_id));
+  EXPECT_EQ(12, root_id);
+  EXPECT_TRUE(page->GetRootId("table1", root_id));
+  EXPECT_EQ(21, root_id);
+  buffer_pool_manager->UnpinPage(HEADER_PAGE_ID, true);
+  delete buffer_pool_manager;
+  delete disk_manager;
+
+  // still an older file once written back
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(OLD_FORMAT_PAGE_SIZE, disk_manager->GetPageSize());
+  char read[OLD_FORMAT_PAGE_SIZE];
+  disk_manager->ReadPage(1, read);
+  EXPECT_STREQ("page 1", read);
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+  remove("test.fsm");
+}
 } // namespace cmudb
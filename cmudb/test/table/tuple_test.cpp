@@ -3,9 +3,12 @@
  */
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "buffer/buffer_pool_manager.h"
@@ -47,6 +50,16 @@ TEST(TupleTest, TableHeapTest) {
     ++itr;
   }
 
+  // same scan through a buffer ring
+  int count = 0;
+  TableIterator bulk_itr = table->begin(transaction, true);
+  while (bulk_itr != table->end()) {
+    EXPECT_EQ(rid_v[count].Get(), bulk_itr->GetRid().Get());
+    ++count;
+    ++bulk_itr;
+  }
+  EXPECT_EQ(5000, count);
+
   // int i = 0;
   std::random_shuffle(rid_v.begin(), rid_v.end());
   for (auto rid : rid_v) {
@@ -61,4 +74,45 @@ TEST(TupleTest, TableHeapTest) {
   delete disk_manager;
 }
 
+
+// a read-ahead that has read a page stops here for a while before it goes
+// on to the next one
+static std::atomic<bool> read_ahead_stalled{false};
+static page_id_t StallReadAhead(const char *data) {
+  read_ahead_stalled = true;
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  return TablePage::ReadNextPageId(data);
+}
+
+// the database is closed while the read-ahead of a heap scan still reads
+// pages through the disk manager
+TEST(TupleTest, CloseDuringReadAheadTest) {
+  Schema *schema =
+      ParseCreateStatement("a varchar, b smallint, c bigint, d bool");
+  Tuple tuple = ConstructTuple(schema);
+  StorageEngine *storage_engine = new StorageEngine("test.db", 8);
+  Transaction *transaction = new Transaction(0);
+  TableHeap *table = new TableHeap(storage_engine->buffer_pool_manager_,
+                                   storage_engine->lock_manager_,
+                                   storage_engine->log_manager_, transaction);
+  RID rid;
+  for (int i = 0; i < 2000; ++i) {
+    ASSERT_TRUE(table->InsertTuple(tuple, rid, transaction));
+  }
+
+  // the first pages of the heap were evicted, the chain reads them back
+  storage_engine->buffer_pool_manager_->PrefetchChain(
+      table->GetFirstPageId(), READ_AHEAD_PAGES, StallReadAhead);
+  while (!read_ahead_stalled) {
+    std::this_thread::yield();
+  }
+  delete table;
+  delete storage_engine;
+
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+  remove("test.warm");
+}
 } // namespace cmudb
@@ -44,4 +44,91 @@ TEST(VtableTest, CreateTest) {
   remove("vtable.db");
   return;
 }
+
+TEST(VtableTest, StatsTableTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  sqlite3 *db;
+  int rc;
+  rc = sqlite3_open(db_file.c_str(), &db);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  rc = sqlite3_enable_load_extension(db, 1);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  char *zErrMsg = 0;
+  rc = sqlite3_load_extension(db, "libvtable", 0, &zErrMsg);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  EXPECT_TRUE(ExecSQL(
+      db, "CREATE VIRTUAL TABLE foo1 USING vtable ('a INT, b int', 'foo1_pk b')"));
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo1 VALUES(1, 2)"));
+  EXPECT_TRUE(ExecSQL(db, "SELECT * FROM foo1"));
+  EXPECT_TRUE(ExecSQL(db, "SELECT * FROM bpm_stats"));
+  EXPECT_TRUE(ExecSQL(db, "SELECT value FROM bpm_stats WHERE name = "
+                          "'fetch_hits'"));
+  EXPECT_TRUE(ExecSQL(db, "SELECT * FROM bpm_frames WHERE page_id >= 0"));
+  EXPECT_TRUE(ExecSQL(db, "SELECT bpm_stats_reset()"));
+  EXPECT_TRUE(ExecSQL(db, "SELECT durability_mode('batched')"));
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo1 VALUES(3, 4)"));
+  EXPECT_TRUE(ExecSQL(db, "SELECT durability_mode()"));
+  EXPECT_FALSE(ExecSQL(db, "SELECT durability_mode('always')"));
+  // read only
+  EXPECT_FALSE(ExecSQL(db, "DELETE FROM bpm_stats"));
+  EXPECT_TRUE(ExecSQL(db, "DROP TABLE foo1"));
+
+  rc = sqlite3_close(db);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  remove(db_file.c_str());
+  remove("vtable.db");
+}
+TEST(VtableTest, HashIndexTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  sqlite3 *db;
+  int rc;
+  rc = sqlite3_open(db_file.c_str(), &db);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  rc = sqlite3_enable_load_extension(db, 1);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  char *zErrMsg = 0;
+  rc = sqlite3_load_extension(db, "libvtable", 0, &zErrMsg);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo1 USING vtable ('a INT, b "
+                          "int, d varchar', 'foo1_pk b using hash')"));
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo1 VALUES(1, 2, 'hello')"));
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo1 VALUES(3, 4, 'Nihao')"));
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo1 VALUES(2, 3, 'world')"));
+
+  sqlite3_stmt *stmt;
+  // point lookups go through the index
+  rc = sqlite3_prepare_v2(db, "SELECT a FROM foo1 WHERE b = ?", -1, &stmt,
+                          nullptr);
+  EXPECT_EQ(rc, SQLITE_OK);
+  for (int b = 2; b <= 4; ++b) {
+    sqlite3_bind_int(stmt, 1, b);
+    EXPECT_EQ(SQLITE_ROW, sqlite3_step(stmt));
+    EXPECT_EQ(b == 2 ? 1 : b == 3 ? 2 : 3, sqlite3_column_int(stmt, 0));
+    EXPECT_EQ(SQLITE_DONE, sqlite3_step(stmt));
+    sqlite3_reset(stmt);
+  }
+  EXPECT_TRUE(ExecSQL(db, "DELETE FROM foo1 WHERE b = 2"));
+  sqlite3_bind_int(stmt, 1, 2);
+  EXPECT_EQ(SQLITE_DONE, sqlite3_step(stmt));
+  sqlite3_finalize(stmt);
+
+  EXPECT_TRUE(ExecSQL(db, "DROP TABLE foo1"));
+
+  rc = sqlite3_close(db);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  remove(db_file.c_str());
+  remove("vtable.db");
+}
 } // namespace cmudb